@@ -0,0 +1,44 @@
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> ALLOCATIONS(0);
+
+unsigned long bench_allocation_count() {
+    return ALLOCATIONS.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size) {
+    ALLOCATIONS.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t size) noexcept {
+    (void)size;
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t size) noexcept {
+    (void)size;
+    std::free(ptr);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#ifndef REMAC_BENCHALLOCATIONS
+#define REMAC_BENCHALLOCATIONS 1
+
+/**
+ * Count of calls to global operator new since program start. Benchmark
+    binary replaces global operator new, so bench_run() reports allocations
+    per item of any code. Counter is atomic, because fillParallel() allocates
+    from several threads.
+ */
+unsigned long bench_allocation_count();
+
+#endif // REMAC_BENCHALLOCATIONS
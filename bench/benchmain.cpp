@@ -0,0 +1,231 @@
+#include "benchmain.hpp"
+#include "allocations.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const double MIN_SECONDS = 1.0;
+// Version of JSON layout, increased on incompatible changes
+static const int RESULTS_VERSION = 1;
+
+/**
+ * Result of bench_run() or bench_memory(), kept for JSON output.
+ */
+struct BenchResult {
+    std::string module;
+    std::string name;
+    bool memory;
+    double bytesPerSecond;
+    double itemsPerSecond;
+    double allocationsPerItem;
+    unsigned long iterations;
+    unsigned long bytes;
+    unsigned long items;
+};
+
+static BenchOptions OPTIONS;
+static std::string MODULE;
+static std::vector<BenchResult> RESULTS;
+
+const BenchOptions &bench_options() {
+    return OPTIONS;
+}
+
+static bool isSelected(const std::string &name) {
+    return OPTIONS.filter.empty() || name.find(OPTIONS.filter) != std::string::npos || MODULE.find(OPTIONS.filter) != std::string::npos;
+}
+
+void bench_module(std::string name) {
+    MODULE = name;
+    std::printf("Benchmarking module '%s'\n", name.c_str());
+    std::fflush(stdout);
+}
+
+void bench_run(std::string name, unsigned long bytes, std::function<unsigned long()> iteration) {
+    using Clock = std::chrono::steady_clock;
+
+    if (!isSelected(name)) {
+        return;
+    }
+
+    unsigned long iterations = 0;
+    unsigned long items = 0;
+    unsigned long allocations = bench_allocation_count();
+    Clock::time_point start = Clock::now();
+    double seconds = 0.0;
+
+    while (seconds < MIN_SECONDS) {
+        items += iteration();
+        iterations++;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    allocations = bench_allocation_count() - allocations;
+    double megabytes = (double)bytes * (double)iterations / (1024.0 * 1024.0);
+    double allocationsPerItem = items > 0 ? (double)allocations / (double)items : 0.0;
+    std::printf(
+        "%-48s %10.2f MB/s %14.0f items/s %10.4f allocs/item (%lu iterations)\n",
+        name.c_str(),
+        megabytes / seconds,
+        (double)items / seconds,
+        allocationsPerItem,
+        iterations
+    );
+    std::fflush(stdout);
+    RESULTS.push_back(BenchResult {
+        .module = MODULE,
+        .name = name,
+        .memory = false,
+        .bytesPerSecond = (double)bytes * (double)iterations / seconds,
+        .itemsPerSecond = (double)items / seconds,
+        .allocationsPerItem = allocationsPerItem,
+        .iterations = iterations,
+        .bytes = bytes,
+        .items = items,
+    });
+}
+
+void bench_memory(std::string name, unsigned long bytes, unsigned long items) {
+    if (!isSelected(name)) {
+        return;
+    }
+
+    std::printf(
+        "%-48s %10.2f MB %16.2f bytes/item (%lu items)\n",
+        name.c_str(),
+        (double)bytes / (1024.0 * 1024.0),
+        (double)bytes / (double)items,
+        items
+    );
+    std::fflush(stdout);
+    RESULTS.push_back(BenchResult {
+        .module = MODULE,
+        .name = name,
+        .memory = true,
+        .bytesPerSecond = 0.0,
+        .itemsPerSecond = 0.0,
+        .allocationsPerItem = 0.0,
+        .iterations = 0,
+        .bytes = bytes,
+        .items = items,
+    });
+}
+
+static std::string quoteJson(const std::string &text) {
+    std::string quoted = "\"";
+
+    for (char chr : text) {
+        if (chr == '"' || chr == '\\') {
+            quoted += '\\';
+            quoted += chr;
+        } else if ((unsigned char)chr < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", chr);
+            quoted += escape;
+        } else {
+            quoted += chr;
+        }
+    }
+
+    return quoted + "\"";
+}
+
+/**
+ * Writes results as one JSON object: version, options and list of results,
+    one per line, so results of two runs are compared by simple tools too.
+ */
+static bool writeJson(const std::string &path) {
+    std::FILE *file = std::fopen(path.c_str(), "w");
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::fprintf(file, "{\"version\": %d, \"corpus_size\": %lu, \"results\": [\n", RESULTS_VERSION, OPTIONS.corpusSize);
+
+    for (unsigned long i = 0; i < RESULTS.size(); i++) {
+        const BenchResult &result = RESULTS[i];
+        std::fprintf(file, "  {\"module\": %s, \"name\": %s, ", quoteJson(result.module).c_str(), quoteJson(result.name).c_str());
+
+        if (result.memory) {
+            std::fprintf(file, "\"kind\": \"memory\", \"bytes\": %lu, \"items\": %lu}", result.bytes, result.items);
+        } else {
+            std::fprintf(
+                file,
+                "\"kind\": \"run\", \"bytes_per_second\": %.0f, \"items_per_second\": %.0f, \"allocations_per_item\": %.6f, \"iterations\": %lu}",
+                result.bytesPerSecond,
+                result.itemsPerSecond,
+                result.allocationsPerItem,
+                result.iterations
+            );
+        }
+
+        std::fprintf(file, i + 1 < RESULTS.size() ? ",\n" : "\n");
+    }
+
+    std::fprintf(file, "]}\n");
+    return std::fclose(file) == 0;
+}
+
+static bool parseOptions(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+
+        if (
+            std::strcmp(option, "--size") != 0 && std::strcmp(option, "--shape") != 0 &&
+            std::strcmp(option, "--filter") != 0 && std::strcmp(option, "--json") != 0
+        ) {
+            std::printf("Error: Unknown option '%s'\n", option);
+            return false;
+        }
+
+        if (i + 1 >= argc) {
+            std::printf("Error: Option '%s' needs a value\n", option);
+            return false;
+        }
+
+        const char *value = argv[++i];
+
+        if (std::strcmp(option, "--size") == 0) {
+            char *end;
+            OPTIONS.corpusSize = std::strtoul(value, &end, 10);
+
+            if (*end != '\0' || OPTIONS.corpusSize == 0) {
+                std::printf("Error: Size must be a positive count of bytes\n");
+                return false;
+            }
+        } else if (std::strcmp(option, "--shape") == 0) {
+            OPTIONS.shapes.push_back(value);
+        } else if (std::strcmp(option, "--filter") == 0) {
+            OPTIONS.filter = value;
+        } else {
+            OPTIONS.jsonPath = value;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (!parseOptions(argc, argv)) {
+        return 2;
+    }
+
+    try {
+        bench_main();
+    } catch (...) {
+        std::printf("*Interrupted with exception*\n");
+        return 1;
+    }
+
+    if (OPTIONS.jsonPath.has_value() && !writeJson(*OPTIONS.jsonPath)) {
+        std::printf("Error: Can't write results to '%s'\n", OPTIONS.jsonPath->c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef REMAC_BENCHMAIN
+#define REMAC_BENCHMAIN 1
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Options of benchmark run, parsed from command line:
+ *
+ *     --size <bytes>    size of each generated corpus (default 1 MiB)
+ *     --shape <name>    shape of corpus to run, may be repeated (default all)
+ *     --filter <text>   run only benchmarks, whose module or name contains text
+ *     --json <path>     also write results to file as JSON
+ */
+struct BenchOptions {
+    unsigned long corpusSize = 1 << 20;
+    std::vector<std::string> shapes;
+    std::string filter;
+    std::optional<std::string> jsonPath;
+};
+
+const BenchOptions &bench_options();
+
+void bench_module(std::string name);
+
+/**
+ * Calls `iteration` repeatedly for about a second and prints its throughput
+    and heap allocations per item.
+ * `iteration` must return count of items (tokens, chars, ...) it processed,
+    `bytes` is count of input bytes, processed by single call.
+ */
+void bench_run(std::string name, unsigned long bytes, std::function<unsigned long()> iteration);
+
+/**
+ * Prints heap memory in `bytes`, used to keep `items` items (tokens, nodes,
+    ...), and its size per item.
+ */
+void bench_memory(std::string name, unsigned long bytes, unsigned long items);
+
+void bench_main();
+
+#endif // REMAC_BENCHMAIN
@@ -0,0 +1,334 @@
+#include "corpus.hpp"
+
+#include <remac/lexer.hpp>
+#include <remac/tokens.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+/**
+ * Xorshift generator: the same sequence on any platform, unlike
+    distributions of <random>.
+ */
+class CorpusRandom {
+private:
+    std::uint64_t state;
+
+public:
+    explicit CorpusRandom(std::uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    std::uint64_t next() {
+        this->state ^= this->state << 13;
+        this->state ^= this->state >> 7;
+        this->state ^= this->state << 17;
+        return this->state;
+    }
+
+    /**
+     * Random number in [0, count).
+     */
+    unsigned long below(unsigned long count) {
+        return this->next() % count;
+    }
+
+    template<typename T, unsigned long N>
+    const T &pick(const T (&items)[N]) {
+        return items[this->below(N)];
+    }
+};
+
+const char *const WORDS[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "value", "result",
+    "error", "count", "index", "buffer", "token", "lexer", "parser", "program", "line", "end",
+};
+
+const char *const OPERATORS[] = { "+", "-", "*", "/", "%" };
+const char *const COMPARISONS[] = { ">", ">=", "<", "<=", "==", "!=" };
+const char *const ESCAPES[] = { "\\t", "\\n", "\\\"", "\\\\", "\\u0416", "\\u20AC" };
+const char *const UNICODE_LETTERS[] = {
+    "\xd0\xb0", "\xd0\xb1", "\xd0\xb2", "\xd0\xb3", "\xd0\xb4", "\xd0\xb5", "\xd0\xb6", "\xd0\xb7", "\xd1\x8f", "\xd1\x8e",
+    "\xce\xb1", "\xce\xb2", "\xce\xb3", "\xce\xb4", "\xce\xbb", "\xcf\x80", "\xcf\x83", "\xcf\x89",
+};
+const char *const UNICODE_TEXT[] = {
+    "\xe4\xbd\xa0\xe5\xa5\xbd", "\xe4\xb8\x96\xe7\x95\x8c", "\xd0\xbc\xd0\xb8\xd1\x80", "\xf0\x9f\x98\x80", "\xf0\x9d\x84\x9e",
+    "\xe2\x82\xac", "caf\xc3\xa9", "\xce\xbb\xcf\x8c\xce\xb3\xce\xbf\xcf\x82",
+};
+
+const unsigned long NAME_POOL_SIZE = 512;
+const unsigned long MAX_NESTING = 64;
+
+/**
+ * Pool of names: identifiers repeat in real code, which matters for
+    interning and caches.
+ */
+std::vector<std::string> makeNames(CorpusRandom *random) {
+    const char *first = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const char *rest = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    std::vector<std::string> names;
+
+    for (unsigned long i = 0; i < NAME_POOL_SIZE; i++) {
+        std::string name(1, first[random->below(52)]);
+        unsigned long length = 1 + random->below(16) + random->below(8);
+
+        for (unsigned long j = 0; j < length; j++) {
+            name += rest[random->below(63)];
+        }
+
+        names.push_back(name);
+    }
+
+    return names;
+}
+
+void appendNumber(std::string *program, CorpusRandom *random) {
+    *program += std::to_string(random->below(100000));
+
+    if (random->below(3) == 0) {
+        *program += "." + std::to_string(random->below(1000));
+    }
+}
+
+void appendIdentifiers(std::string *program, CorpusRandom *random, const std::vector<std::string> &names) {
+    unsigned long terms = 1 + random->below(4);
+
+    for (unsigned long i = 0; i < terms; i++) {
+        if (i > 0) {
+            *program += " ";
+            *program += random->pick(OPERATORS);
+            *program += " ";
+        }
+
+        *program += names[random->below(names.size())];
+
+        if (random->below(4) == 0) {
+            *program += "(" + names[random->below(names.size())] + ", " + names[random->below(names.size())] + ")";
+        }
+    }
+}
+
+void appendString(std::string *program, CorpusRandom *random) {
+    char quote = random->below(4) == 0 ? '\'' : '"';
+    bool escaped = random->below(8) == 0;
+    unsigned long words = 1 + random->below(12);
+    *program += quote;
+
+    for (unsigned long i = 0; i < words; i++) {
+        if (i > 0) {
+            *program += ' ';
+        }
+
+        *program += random->pick(WORDS);
+
+        if (escaped && random->below(3) == 0) {
+            *program += random->pick(ESCAPES);
+        }
+    }
+
+    *program += quote;
+}
+
+/**
+ * Nested call, list or parenthesized sum around value. Each kind may
+    follow each other, so any mix of them is valid.
+ */
+void appendNested(std::string *program, CorpusRandom *random, const std::vector<std::string> &names, unsigned long depth) {
+    if (depth == 0) {
+        if (random->below(2) == 0) {
+            *program += names[random->below(names.size())];
+        } else {
+            appendNumber(program, random);
+        }
+
+        return;
+    }
+
+    switch (random->below(3)) {
+        case 0:
+            *program += names[random->below(names.size())] + "(";
+            appendNested(program, random, names, depth - 1);
+            *program += ")";
+            break;
+        case 1:
+            *program += "[";
+            appendNested(program, random, names, depth - 1);
+            *program += ", " + names[random->below(names.size())] + "]";
+            break;
+        default:
+            *program += "(";
+            appendNested(program, random, names, depth - 1);
+            *program += " + 1)";
+            break;
+    }
+}
+
+void appendUnicode(std::string *program, CorpusRandom *random) {
+    unsigned long letters = 2 + random->below(10);
+
+    for (unsigned long i = 0; i < letters; i++) {
+        *program += random->pick(UNICODE_LETTERS);
+    }
+
+    *program += "_" + std::to_string(random->below(100)) + ", \"";
+    unsigned long words = 1 + random->below(6);
+
+    for (unsigned long i = 0; i < words; i++) {
+        *program += random->pick(UNICODE_TEXT);
+        *program += ' ';
+    }
+
+    *program += "\"";
+}
+
+void appendTerm(std::string *program, CorpusRandom *random, const std::vector<std::string> &names, unsigned long depth) {
+    unsigned long kind = random->below(depth < 4 ? 5 : 4);
+
+    if (kind == 4) {
+        *program += "(";
+        unsigned long terms = 2 + random->below(3);
+
+        for (unsigned long i = 0; i < terms; i++) {
+            if (i > 0) {
+                *program += " ";
+                *program += random->pick(OPERATORS);
+                *program += " ";
+            }
+
+            appendTerm(program, random, names, depth + 1);
+        }
+
+        *program += ")";
+    } else if (kind >= 2) {
+        appendNumber(program, random);
+    } else {
+        *program += names[random->below(names.size())];
+    }
+}
+
+void appendArithmetic(std::string *program, CorpusRandom *random, const std::vector<std::string> &names) {
+    appendTerm(program, random, names, 0);
+    *program += " ";
+    *program += random->below(3) == 0 ? random->pick(COMPARISONS) : random->pick(OPERATORS);
+    *program += " ";
+    appendTerm(program, random, names, 0);
+}
+
+unsigned long lexAll(const std::string &program) {
+    remac::Lexer lexer(program);
+    unsigned long count = 0;
+    std::optional<remac::Token> token = lexer.next();
+
+    while (token.has_value()) {
+        if (token->type == remac::TokenType::LEXER_ERROR) {
+            std::printf("%s\n", token->to_string(lexer.locate(token->offset)).c_str());
+            throw std::exception();
+        }
+
+        count++;
+        token = lexer.next();
+    }
+
+    return count;
+}
+
+}
+
+const char *corpusShapeName(CorpusShape shape) {
+    switch (shape) {
+        case CORPUS_IDENTIFIERS:
+            return "identifiers";
+        case CORPUS_STRINGS:
+            return "strings";
+        case CORPUS_NESTED:
+            return "nested";
+        case CORPUS_UNICODE:
+            return "unicode";
+        case CORPUS_ARITHMETIC:
+            return "arithmetic";
+    }
+
+    return "unknown";
+}
+
+std::optional<CorpusShape> findCorpusShape(std::string_view name) {
+    for (CorpusShape shape : CORPUS_SHAPES) {
+        if (name == corpusShapeName(shape)) {
+            return shape;
+        }
+    }
+
+    return {};
+}
+
+std::string generateCorpus(CorpusShape shape, unsigned long size, unsigned long seed) {
+    CorpusRandom random(seed);
+    std::vector<std::string> names = makeNames(&random);
+    std::string program = "Main(\n";
+    program.reserve(size + 256);
+
+    while (program.size() < size) {
+        switch (shape) {
+            case CORPUS_IDENTIFIERS:
+                appendIdentifiers(&program, &random, names);
+                break;
+            case CORPUS_STRINGS:
+                appendString(&program, &random);
+                break;
+            case CORPUS_NESTED:
+                appendNested(&program, &random, names, 1 + random.below(MAX_NESTING));
+                break;
+            case CORPUS_UNICODE:
+                appendUnicode(&program, &random);
+                break;
+            case CORPUS_ARITHMETIC:
+                appendArithmetic(&program, &random, names);
+                break;
+        }
+
+        program += ",\n";
+    }
+
+    program += "0)\n";
+    return program;
+}
+
+void bench_corpus() {
+    bench_module("Corpus");
+    const BenchOptions &options = bench_options();
+
+    for (const std::string &name : options.shapes) {
+        if (!findCorpusShape(name).has_value()) {
+            std::printf("Unknown corpus shape '%s'\n", name.c_str());
+            throw std::exception();
+        }
+    }
+
+    for (CorpusShape shape : CORPUS_SHAPES) {
+        std::string name = corpusShapeName(shape);
+        bool selected = options.shapes.empty();
+
+        for (const std::string &selectedName : options.shapes) {
+            selected = selected || selectedName == name;
+        }
+
+        if (!selected) {
+            continue;
+        }
+
+        std::string program = generateCorpus(shape, options.corpusSize);
+        bench_run("next() " + name, program.size(), [&]() { return lexAll(program); });
+        remac::PackedTokens tokens;
+        bench_run("fill() " + name, program.size(), [&]() {
+            remac::Lexer lexer(program);
+            lexer.fill(&tokens);
+            return tokens.size();
+        });
+        bench_memory("PackedTokens " + name, tokens.getByteSize(), tokens.size());
+    }
+}
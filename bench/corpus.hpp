@@ -0,0 +1,45 @@
+#pragma once
+#ifndef REMAC_BENCHCORPUS
+#define REMAC_BENCHCORPUS 1
+
+#include "benchmain.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+enum CorpusShape {
+    // Expressions and calls over a pool of repeated names
+    CORPUS_IDENTIFIERS,
+    // String literals of words, some with escape sequences
+    CORPUS_STRINGS,
+    // Calls, lists and parens nested up to 64 levels deep
+    CORPUS_NESTED,
+    // Cyrillic and Greek identifiers, strings with CJK and emoji
+    CORPUS_UNICODE,
+    // Arithmetic and comparisons over numbers and names
+    CORPUS_ARITHMETIC,
+};
+
+const CorpusShape CORPUS_SHAPES[] = {
+    CORPUS_IDENTIFIERS,
+    CORPUS_STRINGS,
+    CORPUS_NESTED,
+    CORPUS_UNICODE,
+    CORPUS_ARITHMETIC,
+};
+
+const char *corpusShapeName(CorpusShape shape);
+std::optional<CorpusShape> findCorpusShape(std::string_view name);
+
+/**
+ * Synthetic program of `shape`, at least `size` bytes long. The same seed
+    gives the same program, so results of different versions are comparable.
+ * Program is single function call, because lexer accepts only one top-level
+    statement at this moment, and it's valid for lexer.
+ */
+std::string generateCorpus(CorpusShape shape, unsigned long size, unsigned long seed = 1);
+
+void bench_corpus();
+
+#endif // REMAC_BENCHCORPUS
@@ -0,0 +1,465 @@
+#include "lexer.hpp"
+
+#include <remac/astformat.hpp>
+#include <remac/cpu.hpp>
+#include <remac/flatast.hpp>
+#include <remac/lexer.hpp>
+#include <remac/parser.hpp>
+#include <remac/symbols.hpp>
+#include <remac/tokens.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Builds single function call with `count` arguments, because lexer accepts
+    only one top-level statement at this moment.
+ */
+static std::string makeCallProgram(std::string argument, unsigned long count) {
+    std::string program = "Main(\n";
+
+    for (unsigned long i = 0; i < count; i++) {
+        program += argument;
+        program += ",\n";
+    }
+
+    program += "0)\n";
+    return program;
+}
+
+static unsigned long lexAll(const std::string &program) {
+    remac::Lexer lexer(program);
+    unsigned long count = 0;
+    std::optional<remac::Token> token = lexer.next();
+
+    while (token.has_value()) {
+        if (token->type == remac::TokenType::LEXER_ERROR) {
+            std::printf("%s\n", token->to_string(lexer.locate(token->offset)).c_str());
+            throw std::exception();
+        }
+
+        count++;
+        token = lexer.next();
+    }
+
+    return count;
+}
+
+static unsigned long lexStreamed(const std::string &program, unsigned long blockSize) {
+    std::istringstream input(program);
+    remac::Lexer lexer(remac::SourceStream(input, blockSize));
+    unsigned long count = 0;
+    std::optional<remac::Token> token = lexer.next();
+
+    while (token.has_value()) {
+        if (token->type == remac::TokenType::LEXER_ERROR) {
+            std::printf("%s\n", token->to_string(lexer.locate(token->offset)).c_str());
+            throw std::exception();
+        }
+
+        count++;
+        token = lexer.next();
+    }
+
+    return count;
+}
+
+static std::vector<remac::Token> collectTokens(remac::Lexer *lexer) {
+    std::vector<remac::Token> tokens;
+    std::optional<remac::Token> token = lexer->next();
+
+    while (token.has_value()) {
+        tokens.push_back(*token);
+        token = lexer->next();
+    }
+
+    return tokens;
+}
+
+/**
+ * Memory of the same tokens in vector and in packed buffer, and time to
+    collect them and to parse them from each.
+ */
+static void benchPackedTokens(const std::string &program) {
+    remac::Lexer lexer(program);
+    std::vector<remac::Token> tokens = collectTokens(&lexer);
+    remac::Lexer packingLexer(program);
+    remac::PackedTokens packed;
+    packingLexer.fill(&packed);
+    bench_memory("std::vector<Token>", tokens.capacity() * sizeof(remac::Token), tokens.size());
+    bench_memory("PackedTokens", packed.getByteSize(), packed.size());
+
+    bench_run("next() into std::vector<Token>", program.size(), [&]() {
+        remac::Lexer lexer(program);
+        return collectTokens(&lexer).size();
+    });
+    bench_run("fill() into PackedTokens", program.size(), [&]() {
+        remac::Lexer lexer(program);
+        lexer.fill(&packed);
+        return packed.size();
+    });
+
+    bench_run("TokenValidator::check()", program.size(), [&]() {
+        remac::TokenValidator validator;
+
+        for (const remac::Token &token : tokens) {
+            validator.check(token);
+        }
+
+        return tokens.size();
+    });
+
+    bench_run("parse() from std::vector<Token>", program.size(), [&]() {
+        remac::SymbolTable symbols;
+        // Parser takes tokens over, so each run parses a copy
+        remac::Parser parser(std::vector<remac::Token>(tokens), &symbols);
+        delete parser.parse();
+        return tokens.size();
+    });
+    bench_run("parse() from PackedTokens", program.size(), [&]() {
+        remac::SymbolTable symbols;
+        remac::Parser parser(&packed, &symbols);
+        delete parser.parse();
+        return packed.size();
+    });
+
+    // Node by node on heap, deleted by recursive destructors, against arena, freed by chunks
+    for (bool useArena : { false, true }) {
+        std::string suffix = useArena ? ", nodes in arena" : ", nodes on heap";
+        remac::SymbolTable symbols;
+        bench_run("parse() and delete" + suffix, program.size(), [&]() {
+            remac::Parser parser(&packed, &symbols);
+            parser.setArena(useArena);
+            delete parser.parse();
+            return packed.size();
+        });
+    }
+}
+
+/**
+ * Counts variable references in tree, walking it through virtual calls and
+    child pointers, like whole-program passes over class nodes do.
+ */
+static unsigned long countReferences(remac::AstNode *node) {
+    if (node == nullptr) {
+        return 0;
+    }
+
+    switch (node->getType()) {
+        case remac::AstNode::NodeType::NODE_VARIABLE_REFERENCE:
+            return 1;
+        case remac::AstNode::NodeType::NODE_PROGRAM:
+            return countReferences(static_cast<remac::ProgramNode *>(node)->getBody());
+        case remac::AstNode::NodeType::NODE_SEQUENCE: {
+            remac::SequenceNode *sequence = static_cast<remac::SequenceNode *>(node);
+            unsigned long count = 0;
+
+            for (unsigned long i = 0; i < sequence->getCount(); i++) {
+                count += countReferences(sequence->getNode(i));
+            }
+
+            return count;
+        }
+        case remac::AstNode::NodeType::NODE_FUNCTION_CALL:
+            return countReferences(static_cast<remac::FunctionCallNode *>(node)->getArgs());
+        case remac::AstNode::NodeType::NODE_LIST_DEFINITION:
+            return countReferences(static_cast<remac::ListDefinitionNode *>(node)->getArray());
+        case remac::AstNode::NodeType::NODE_OPERATION_ADD:
+        case remac::AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+        case remac::AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+        case remac::AstNode::NodeType::NODE_OPERATION_DIVIDE:
+        case remac::AstNode::NodeType::NODE_OPERATION_MOD:
+        case remac::AstNode::NodeType::NODE_OPERATION_EQUAL:
+        case remac::AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+        case remac::AstNode::NodeType::NODE_OPERATION_LESS:
+        case remac::AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+        case remac::AstNode::NodeType::NODE_OPERATION_GREATER:
+        case remac::AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL: {
+            // Operation nodes share layout, but not a base class
+            remac::OperationAddNode *operation = static_cast<remac::OperationAddNode *>(node);
+            return countReferences(operation->getLeft()) + countReferences(operation->getRight());
+        }
+        case remac::AstNode::NodeType::NODE_OPERATION_NEGATE:
+            return countReferences(static_cast<remac::OperationNegateNode *>(node)->getValue());
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Whole-program pass over class nodes against the same pass over flat tree,
+    and cost of converting between them.
+ */
+static void benchFlatAst(const std::string &program) {
+    remac::Lexer lexer(program);
+    remac::PackedTokens packed;
+    remac::SymbolTable symbols;
+    lexer.setSymbols(&symbols);
+    lexer.fill(&packed);
+    remac::Parser parser(&packed, &symbols);
+    remac::ProgramNode *tree = parser.parse();
+    remac::FlatAst flat(&symbols, tree);
+    const std::vector<std::uint8_t> &kinds = flat.getKinds();
+
+    bench_run("count references, walking class nodes", program.size(), [&]() {
+        return countReferences(tree);
+    });
+    bench_run("count references, scanning FlatAst", program.size(), [&]() {
+        return (unsigned long)std::count(kinds.begin(), kinds.end(), remac::AstNode::NodeType::NODE_VARIABLE_REFERENCE);
+    });
+    bench_run("parseFlat() from PackedTokens", program.size(), [&]() {
+        remac::Parser flatParser(&packed, &symbols);
+        delete flatParser.parseFlat();
+        return flat.size();
+    });
+    bench_run("FlatAst::toTree()", program.size(), [&]() {
+        delete flat.toTree();
+        return flat.size();
+    });
+    delete tree;
+}
+
+/**
+ * Loading saved program against lexing and parsing its source again. Load
+    interns names into a fresh table, as a new process, reading cache, does.
+ */
+static void benchAstFormat(const std::string &program) {
+    remac::Lexer lexer(program);
+    remac::PackedTokens packed;
+    remac::SymbolTable symbols;
+    lexer.setSymbols(&symbols);
+    lexer.fill(&packed);
+    remac::Parser parser(&packed, &symbols);
+    remac::ProgramNode *tree = parser.parse();
+    std::string bytes = remac::AstFormat::save(tree, &symbols);
+    // Items are tokens of source in all runs, so rates are comparable
+    unsigned long tokenCount = packed.size();
+    bench_memory("source", program.size(), tokenCount);
+    bench_memory("AstFormat::save() bytes", bytes.size(), tokenCount);
+
+    bench_run("lex and parse() source, fresh symbols", program.size(), [&]() {
+        remac::SymbolTable freshSymbols;
+        remac::Lexer freshLexer(program);
+        remac::PackedTokens freshPacked;
+        freshLexer.setSymbols(&freshSymbols);
+        freshLexer.fill(&freshPacked);
+        remac::Parser freshParser(&freshPacked, &freshSymbols);
+        delete freshParser.parse();
+        return tokenCount;
+    });
+    bench_run("AstFormat::load(), fresh symbols", bytes.size(), [&]() {
+        remac::SymbolTable freshSymbols;
+        delete remac::AstFormat::load(bytes, &freshSymbols);
+        return tokenCount;
+    });
+    bench_run("AstFormat::save()", bytes.size(), [&]() {
+        remac::AstFormat::save(tree, &symbols);
+        return tokenCount;
+    });
+    delete tree;
+}
+
+/**
+ * Call with few long expressions, like generated scripts have. Operators
+    cycle through priorities, so right operands nest too.
+ */
+static std::string makeLongExpressions(const std::vector<std::string> &operators, unsigned long operands) {
+    std::string program = "Main(";
+
+    for (unsigned long expression = 0; expression < 10; expression++) {
+        program += "x0";
+
+        for (unsigned long i = 1; i < operands; i++) {
+            program += " " + operators[i % operators.size()] + " x" + std::to_string(i);
+        }
+
+        program += expression < 9 ? ",\n" : ")\n";
+    }
+
+    return program;
+}
+
+static void benchExpressions() {
+    std::string arithmetic = makeLongExpressions({ "+", "*", "-", "/", "%" }, 10000);
+    std::string comparisons = makeLongExpressions({ "+", "<", "* -", "==", "-", ">=", "!=" }, 10000);
+
+    for (const std::string *program : { &arithmetic, &comparisons }) {
+        remac::Lexer lexer(*program);
+        remac::PackedTokens packed;
+        remac::SymbolTable symbols;
+        lexer.setSymbols(&symbols);
+        lexer.fill(&packed);
+        std::string name = program == &arithmetic ? "arithmetic" : "comparisons";
+
+        bench_run("parse() 10k-operand expressions, " + name, program->size(), [&]() {
+            remac::Parser parser(&packed, &symbols);
+            delete parser.parse();
+            return packed.size();
+        });
+    }
+}
+
+/**
+ * Cost of interning names by lexer, and of SymbolTable::intern() alone on
+    tokens, which are mostly repeated names.
+ */
+static void benchSymbols(const std::string &program) {
+    bench_run("fill() into PackedTokens, interning names", program.size(), [&]() {
+        remac::SymbolTable symbols;
+        remac::Lexer lexer(program);
+        remac::PackedTokens packed;
+        lexer.setSymbols(&symbols);
+        lexer.fill(&packed);
+        return packed.size();
+    });
+
+    remac::Lexer lexer(program);
+    std::vector<remac::Token> tokens = collectTokens(&lexer);
+    remac::SymbolTable symbols;
+    bench_run("SymbolTable::intern()", program.size(), [&]() {
+        unsigned long count = 0;
+
+        for (const remac::Token &token : tokens) {
+            if (token.type == remac::TokenType::IDENTIFIER || token.type == remac::TokenType::STRING) {
+                symbols.intern(token.content);
+                count++;
+            }
+        }
+
+        return count;
+    });
+}
+
+/**
+ * Keystroke in the middle of program: relex() of the edit against fill() of
+    the whole edited code.
+ */
+static void benchRelex(const std::string &program) {
+    remac::Lexer lexer(program);
+    remac::PackedTokens tokens;
+    lexer.fill(&tokens);
+    unsigned long offset = tokens.getOffset(tokens.size() / 2);
+    bool inserted = false;
+
+    bench_run("relex() of one char edit", program.size(), [&]() {
+        remac::TokenChange change;
+        // Char is typed and erased in turn, so code doesn't grow
+        remac::TextEdit edit = inserted ? remac::TextEdit { .offset = offset, .removed = 1, .inserted = "" } : remac::TextEdit { .offset = offset, .removed = 0, .inserted = "x" };
+        lexer.relex(&tokens, edit, &change);
+        inserted = !inserted;
+        return change.inserted;
+    });
+    bench_run("fill() of the same code", program.size(), [&]() {
+        remac::Lexer lexer(program);
+        lexer.fill(&tokens);
+        return tokens.size();
+    });
+}
+
+/**
+ * fill() against fillParallel() on 1, 2, 4, ... threads, up to count of
+    hardware threads (at least 4, so overhead is seen on small machines too).
+ */
+static void benchParallel(const std::string &program) {
+    remac::PackedTokens packed;
+    unsigned long maxThreads = std::max(4U, std::thread::hardware_concurrency());
+
+    bench_run("fill() into PackedTokens, " + std::to_string(program.size() >> 20) + " MiB", program.size(), [&]() {
+        remac::Lexer lexer(program);
+        lexer.fill(&packed);
+        return packed.size();
+    });
+
+    for (unsigned long threads = 1; threads <= maxThreads; threads *= 2) {
+        bench_run("fillParallel() on " + std::to_string(threads) + " threads", program.size(), [&]() {
+            remac::Lexer lexer(program);
+            lexer.fillParallel(&packed, threads);
+            return packed.size();
+        });
+    }
+}
+
+void bench_lexer() {
+    bench_module("Lexer");
+
+    std::string identifiers = makeCallProgram("alpha_1 + beta2 * (gamma_value - delta) / epsilon", 20000);
+    bench_run("next() identifier-heavy", identifiers.size(), [&]() { return lexAll(identifiers); });
+
+    std::string numbers = makeCallProgram("[1, 22, 333.5, 4444, 55555.125]", 20000);
+    bench_run("next() number-heavy", numbers.size(), [&]() { return lexAll(numbers); });
+
+    // Mostly skipWhitespaces(): long indentation and blank lines between few tokens
+    std::string whitespaces = makeCallProgram("\n\n" + std::string(60, ' ') + "x\t\t\t\n" + std::string(60, ' '), 20000);
+    std::string longIdentifiers = makeCallProgram("some_quite_long_identifier_name_42 + another_long_identifier_name", 20000);
+    remac::SimdLevel detected = remac::detectSimdLevel();
+
+    for (int level = remac::SimdLevel::SIMD_SCALAR; level <= detected; level++) {
+        remac::setSimdLevel((remac::SimdLevel)level);
+        std::string suffix = std::string(" [") + remac::simdLevelName(remac::getSimdLevel()) + "]";
+        bench_run("skipWhitespaces() whitespace-heavy" + suffix, whitespaces.size(), [&]() { return lexAll(whitespaces); });
+        bench_run("nextIdentifier() long identifiers" + suffix, longIdentifiers.size(), [&]() { return lexAll(longIdentifiers); });
+    }
+
+    remac::setSimdLevel(detected);
+
+    std::string mixed = makeCallProgram("Func(name, 42, \"text\", [x, 3.5]) % 7", 20000);
+    bench_run("next() mixed", mixed.size(), [&]() { return lexAll(mixed); });
+    // Errors are handled on cold path, so recovery mode costs nothing in valid code
+    bench_run("next() mixed, recovery mode", mixed.size(), [&]() {
+        remac::Lexer lexer(mixed);
+        lexer.setRecovering(true);
+        unsigned long count = 0;
+
+        while (lexer.next().has_value()) {
+            count++;
+        }
+
+        return count;
+    });
+    // Same program, read in blocks: only window of two blocks is kept in memory
+    bench_run("next() mixed, streamed in 4 KiB blocks", mixed.size(), [&]() { return lexStreamed(mixed, 4096); });
+    bench_run("next() mixed, streamed in 64 KiB blocks", mixed.size(), [&]() { return lexStreamed(mixed, 65536); });
+
+    std::string operators = makeCallProgram("a + b - c * d / e % f == g != h <= i >= j < k > l", 20000);
+    bench_run("next() operator-heavy", operators.size(), [&]() { return lexAll(operators); });
+
+    // One long "else if" chain, so keywords are a third of all words
+    std::string keywords = "if (x) { f(0) }";
+
+    for (unsigned long i = 0; i < 20000; i++) {
+        keywords += " else if (while_1) { for_each(iffy, 1) }\n";
+    }
+
+    bench_run("next() keyword-heavy", keywords.size(), [&]() { return lexAll(keywords); });
+
+    // Embedded templates and JSON blobs: one literal of 1 MiB, plain and with escapes every 64 bytes
+    std::string plainText;
+    std::string escapedText;
+
+    while (plainText.size() < (1 << 20)) {
+        plainText += "{'name': 'value', 'list': [1, 2, 3]}\n Lorem ipsum \xd0\xb6 dolor sit amet\t";
+        escapedText += "{\\\"name\\\": 'value', \\\"list\\\": [1, 2, 3]}\\n Lorem ipsum \\u0416 sit amet\\t";
+    }
+
+    std::string plainString = "Print(\"" + plainText + "\")";
+    std::string escapedString = "Print(\"" + escapedText + "\")";
+    bench_run("nextString() 1 MiB literal", plainString.size(), [&]() { return lexAll(plainString); });
+    bench_run("nextString() 1 MiB literal with escapes", escapedString.size(), [&]() { return lexAll(escapedString); });
+
+    benchPackedTokens(identifiers);
+    benchSymbols(identifiers);
+    benchRelex(identifiers);
+    benchFlatAst(identifiers);
+    benchAstFormat(identifiers);
+    benchExpressions();
+    benchParallel(makeCallProgram("Func(name, 42, \"text\", [x, 3.5]) % 7", 400000));
+
+    std::string unicode = makeCallProgram("\xd0\xb7\xd0\xbd\xd0\xb0\xd1\x87\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5_1 + \xce\xb1\xce\xb2\xce\xb3 * x", 20000);
+    bench_run("next() Unicode identifiers", unicode.size(), [&]() { return lexAll(unicode); });
+}
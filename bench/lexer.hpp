@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_BENCHLEXER
+#define REMAC_BENCHLEXER 1
+
+#include "benchmain.hpp"
+
+void bench_lexer();
+
+#endif // REMAC_BENCHLEXER
@@ -0,0 +1,10 @@
+#include "benchmain.hpp"
+#include "./corpus.hpp"
+#include "./lexer.hpp"
+#include "./utf8.hpp"
+
+void bench_main() {
+    bench_corpus();
+    bench_lexer();
+    bench_utf8();
+}
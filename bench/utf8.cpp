@@ -0,0 +1,91 @@
+#include "utf8.hpp"
+
+#include <remac/cpu.hpp>
+#include <remac/utf8.hpp>
+
+#include <string>
+
+/**
+ * Previous isValidUtf8(): one decoder call per char. Kept here as baseline
+    for comparison.
+ */
+static bool charByCharValid(const char *stringStart, const char *stringEnd) {
+    const char *ptr = stringStart;
+
+    while (ptr < stringEnd) {
+        remac::DecodedChar chr = remac::decodeUtf8(ptr);
+
+        if (chr.length == UTF8_INVALID) {
+            return false;
+        }
+
+        ptr += chr.length;
+    }
+
+    return ptr == stringEnd;
+}
+
+static std::string repeat(const std::string &part, unsigned long size) {
+    std::string result;
+
+    while (result.size() < size) {
+        result += part;
+    }
+
+    return result;
+}
+
+static void benchValidators(const std::string &name, const std::string &text) {
+    const char *start = text.data();
+    const char *end = start + text.size();
+
+    bench_run("char by char " + name, text.size(), [&]() { return charByCharValid(start, end) ? text.size() : 0; });
+
+    remac::SimdLevel detected = remac::detectSimdLevel();
+
+    for (int level = remac::SimdLevel::SIMD_SCALAR; level <= detected; level++) {
+        remac::setSimdLevel((remac::SimdLevel)level);
+        std::string suffix = std::string(" [") + remac::simdLevelName(remac::getSimdLevel()) + "]";
+        bench_run("isValidUtf8() " + name + suffix, text.size(), [&]() { return remac::isValidUtf8(start, end) ? text.size() : 0; });
+    }
+
+    remac::setSimdLevel(detected);
+}
+
+/**
+ * Returns count of decoded chars. Sum of code points is kept alive, so
+    decoding isn't optimized out.
+ */
+static unsigned long decodeAll(const std::string &text) {
+    const char *ptr = text.data();
+    const char *end = ptr + text.size();
+    unsigned long count = 0;
+    char32_t sum = 0;
+
+    while (ptr < end) {
+        remac::DecodedChar chr = remac::decodeUtf8(ptr);
+        sum += chr.codePoint;
+        ptr += chr.length;
+        count++;
+    }
+
+    asm volatile("" : : "r"(sum));
+    return count;
+}
+
+void bench_utf8() {
+    bench_module("UTF-8");
+
+    const unsigned long size = 4 * 1024 * 1024;
+    std::string ascii = repeat("Print(alpha_1 + beta2 * (gamma - 42), \"text\")\n", size);
+    std::string cyrillic = repeat("\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, \xd0\xbc\xd0\xb8\xd1\x80! ", size);
+    std::string mixed = repeat("Print(\"\xe2\x82\xac \xd0\xb6 \xf0\x9f\x98\x80\", x_1, 2.5)\n", size);
+
+    bench_run("decodeUtf8() ASCII", ascii.size(), [&]() { return decodeAll(ascii); });
+    bench_run("decodeUtf8() Cyrillic", cyrillic.size(), [&]() { return decodeAll(cyrillic); });
+    bench_run("decodeUtf8() mixed", mixed.size(), [&]() { return decodeAll(mixed); });
+
+    benchValidators("ASCII", ascii);
+    benchValidators("Cyrillic", cyrillic);
+    benchValidators("mixed", mixed);
+}
@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_BENCHUTF8
+#define REMAC_BENCHUTF8 1
+
+#include "benchmain.hpp"
+
+void bench_utf8();
+
+#endif // REMAC_BENCHUTF8
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef REMAC_ARENA
+#define REMAC_ARENA 1
+
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace remac {
+
+/**
+ * Bump allocator with chunked growth. Memory is released only all at once,
+    when arena is destroyed, so pointers to allocated memory stay valid
+    during whole lifetime of arena (even after it is moved).
+ */
+class Arena {
+private:
+    static const unsigned long DEFAULT_CHUNK_SIZE = 4096;
+
+    std::vector<char *> chunks;
+    char *current;
+    unsigned long left;
+    unsigned long chunkSize;
+
+public:
+    explicit Arena(unsigned long chunkSize = DEFAULT_CHUNK_SIZE);
+    Arena(const Arena &) = delete;
+    Arena(Arena &&other) noexcept;
+    Arena &operator=(const Arena &) = delete;
+    Arena &operator=(Arena &&other) noexcept;
+
+    void *allocate(unsigned long size, unsigned long alignment = alignof(std::max_align_t));
+    std::string_view copyString(std::string_view str);
+    /**
+     * Constructs object of `T` in arena. Its destructor is never called, so
+        it must not own memory outside of arena.
+     */
+    template<typename T, typename... Args>
+    T *make(Args &&...args) {
+        return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Count of chunks, allocated by this arena.
+     */
+    unsigned long getChunkCount();
+
+    ~Arena();
+
+private:
+    void release();
+};
+
+}
+
+#endif // REMAC_ARENA
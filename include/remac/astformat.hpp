@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef REMAC_ASTFORMAT
+#define REMAC_ASTFORMAT 1
+
+#include <remac/parser.hpp>
+#include <remac/symbols.hpp>
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace remac {
+
+/**
+ * Binary AST format, used to cache compiled programs. All numbers are
+    little-endian.
+ *
+ * File starts with header:
+ *  - magic "RMAC"
+ *  - u16 version, VERSION
+ *  - u16 flags, reserved, must be 0
+ *  - u32 count of names
+ *
+ * Then names follow, each is u32 length and UTF-8 bytes. Names are symbols
+    of file: their indexes are written instead of names.
+ *
+ * Then program node follows. Each node is u8 tag (AstNode::NodeType), its
+    payload and its children in order of fields. Missing child is single
+    NODE_EMPTY tag. Payloads:
+ *  - SEQUENCE: u32 count of children
+ *  - FUNCTION_CALL, VARIABLE_ASSIGNMENT, VARIABLE_REFERENCE,
+        STRING_CONSTANT: u32 name
+ *  - INT_CONSTANT: i64 value
+ *  - FLOAT_CONSTANT: IEEE 754 bits of double value
+ *
+ * AstNode::toBytes() writes node in this format without header, with
+    symbols of its own table as names.
+ *
+ * Trees are written and read with own stacks instead of recursion, because
+    chains of operators are as deep as they are long.
+ */
+class AstFormat {
+public:
+    static const std::uint16_t VERSION = 1;
+    static const unsigned long HEADER_SIZE = 12;
+
+private:
+    // Nodes of loaded program are allocated in chunks of this size
+    static const unsigned long NODE_CHUNK_SIZE = 64 * 1024;
+
+public:
+    /**
+     * Serializes program, whose names are symbols of `symbols`, with header.
+     */
+    static std::string save(ProgramNode *program, const SymbolTable *symbols);
+    /**
+     * Loads program, saved by save(), in one pass. Names are interned into
+        `symbols`, once each. Nodes are allocated in arena, owned by returned
+        ProgramNode. Throws AstFormatException *, if bytes aren't valid
+        program of this version, or have unknown flags.
+     */
+    static ProgramNode *load(std::string_view bytes, SymbolTable *symbols);
+
+    /**
+     * Byte length of node with its subtree, or of NODE_EMPTY tag, if node
+        is nullptr.
+     */
+    static unsigned long getNodeLength(AstNode *node);
+    /**
+     * Writes node with its subtree, or NODE_EMPTY tag, if node is nullptr.
+     */
+    static unsigned long writeNode(AstNode *node, void *buffer);
+    static void writeU32(void *buffer, std::uint32_t value);
+    static void writeU64(void *buffer, std::uint64_t value);
+    static std::uint32_t readU32(const void *buffer);
+    static std::uint64_t readU64(const void *buffer);
+};
+
+class AstFormatException : public std::exception {
+public:
+    std::string message;
+    // Offset in bytes, where error is found
+    unsigned long offset;
+
+public:
+    AstFormatException(std::string message, unsigned long offset);
+};
+
+}
+
+#endif // REMAC_ASTFORMAT
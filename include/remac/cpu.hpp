@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef REMAC_CPU
+#define REMAC_CPU 1
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/**
+ * Defined, when x86 SIMD kernels are compiled. They are enabled per function
+    with target attributes, so whole program doesn't require these extensions
+    and kernel is selected at runtime.
+ */
+#define REMAC_X86_SIMD 1
+#endif
+
+namespace remac {
+
+/**
+ * Instruction set extensions, that SIMD kernels can use. Each level includes
+    all previous ones.
+ */
+enum SimdLevel : unsigned char {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    /**
+     * SSSE3 and SSE4.1.
+     */
+    SIMD_SSE4,
+    SIMD_AVX2,
+};
+
+/**
+ * Best level, supported by CPU, on which program is running.
+ */
+SimdLevel detectSimdLevel();
+
+extern SimdLevel currentSimdLevel;
+
+/**
+ * Level, which kernels use now. Detected at program start.
+ */
+inline SimdLevel getSimdLevel() {
+    return currentSimdLevel;
+}
+
+/**
+ * Limits kernels to given level (e.g. to test or benchmark fallbacks). Level
+    above detected one is lowered to it.
+ */
+void setSimdLevel(SimdLevel level);
+
+const char *simdLevelName(SimdLevel level);
+
+}
+
+#endif // REMAC_CPU
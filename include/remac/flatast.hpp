@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef REMAC_FLATAST
+#define REMAC_FLATAST 1
+
+#include <remac/arena.hpp>
+#include <remac/parser.hpp>
+#include <remac/symbols.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+/**
+ * Flat, index-based form of program tree. Nodes are stored contiguously in
+    pre-order, so root is node 0, and children of node follow it. Each node
+    is its kind tag and two 32-bit operands; larger payloads and child lists
+    are kept in side arrays, which operands index. Whole-program passes are
+    loops over arrays instead of virtual calls and pointer chasing.
+ *
+ * Operands of each kind:
+ *  - PROGRAM, LIST_DEFINITION, OPERATION_NEGATE: body, array or value
+ *  - SEQUENCE: start of children in lists, count of children
+ *  - FUNCTION_CALL, VARIABLE_ASSIGNMENT: name symbol, args or value
+ *  - WHILE_STATEMENT: condition, body
+ *  - IF_STATEMENT: start of condition, body and else body in lists
+ *  - FOR_STATEMENT: start of initialization, condition, increment and body
+        in lists
+ *  - OPERATION_*, LIST_SLICE: left or array, right or value
+ *  - INT_CONSTANT, FLOAT_CONSTANT: index in ints or floats
+ *  - STRING_CONSTANT, VARIABLE_REFERENCE: symbol
+ *
+ * Missing child, like else body of "if" without "else", is NO_NODE.
+ */
+class FlatAst {
+public:
+    typedef std::uint32_t Index;
+
+    static const Index NO_NODE = UINT32_MAX;
+
+private:
+    // Nodes of tree, converted to arena, are allocated in chunks of this size
+    static const unsigned long NODE_CHUNK_SIZE = 64 * 1024;
+
+    /**
+     * Node, which is added after the current one, and operand, where its
+        index is written.
+     */
+    struct Pending {
+        AstNode *node;
+        std::vector<Index> *target;
+        Index position;
+    };
+
+    SymbolTable *symbols;
+    // AstNode::NodeType of each node
+    std::vector<std::uint8_t> kinds;
+    std::vector<Index> firsts;
+    std::vector<Index> seconds;
+    // Child lists of sequences and statements
+    std::vector<Index> lists;
+    std::vector<long long> ints;
+    std::vector<double> floats;
+
+public:
+    /**
+     * Converts `program`. Names and string constants of its nodes must be
+        symbols of `symbols`, which must outlive FlatAst.
+     */
+    FlatAst(SymbolTable *symbols, ProgramNode *program);
+
+    /**
+     * Count of nodes.
+     */
+    unsigned long size() const;
+    /**
+     * Kind of each node, indexed by node.
+     */
+    const std::vector<std::uint8_t> &getKinds() const;
+    AstNode::NodeType getKind(Index node) const;
+    unsigned long getChildCount(Index node) const;
+    /**
+     * Child of node, or NO_NODE, if it's missing. Children are in order of
+        fields of the same class node.
+     */
+    Index getChild(Index node, unsigned long index) const;
+    /**
+     * Symbol of FUNCTION_CALL, VARIABLE_ASSIGNMENT, VARIABLE_REFERENCE or
+        STRING_CONSTANT node.
+     */
+    Symbol getSymbol(Index node) const;
+    std::string_view getName(Index node) const;
+    long long getInt(Index node) const;
+    double getFloat(Index node) const;
+    SymbolTable *getSymbols() const;
+
+    /**
+     * Converts back to class nodes. They are allocated in arena, owned by
+        returned ProgramNode.
+     */
+    ProgramNode *toTree() const;
+
+private:
+    Index add(AstNode::NodeType kind, Index first, Index second);
+    Index reserveList(unsigned long count);
+    Index addNode(AstNode *node, std::vector<Pending> *pending);
+    Index addChildren(AstNode::NodeType kind, AstNode *first, AstNode *second, std::vector<Pending> *pending);
+    AstNode *build(Index node, Arena *arena, const std::vector<AstNode *> &built) const;
+    static AstNode *getBuilt(const std::vector<AstNode *> &built, Index node);
+    static SequenceNode *getBuiltSequence(const std::vector<AstNode *> &built, Index node);
+};
+
+}
+
+#endif // REMAC_FLATAST
@@ -3,15 +3,20 @@
 #ifndef REMAC_LEXER
 #define REMAC_LEXER 1
 
+#include <remac/arena.hpp>
+#include <remac/source.hpp>
+#include <remac/symbols.hpp>
 #include <remac/utf8.hpp>
 
-#include <stack>
 #include <cctype>
 #include <clocale>
+#include <cstdint>
 #include <locale>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <vector>
 
 namespace remac {
 
@@ -47,7 +52,7 @@ enum TokenType : unsigned char {
     FLOAT_NUMBER,
 
     /**
-     * Same as IDENTIFIER.
+     * Identifier, listed in KEYWORDS. Token::keyword tells, which one.
      */
     KEYWORD,
 
@@ -128,28 +133,179 @@ enum TokenType : unsigned char {
     LEXER_ERROR,
 };
 
+enum Keyword : unsigned char {
+    /**
+     * Token isn't a keyword.
+     */
+    KEYWORD_NONE,
+    KEYWORD_IF,
+    KEYWORD_ELSE,
+    KEYWORD_WHILE,
+    KEYWORD_FOR,
+};
+
+struct KeywordSpelling {
+    std::string_view text;
+    Keyword keyword = Keyword::KEYWORD_NONE;
+};
+
+/**
+ * All keywords of language. Lexer builds perfect hash table of them at
+    compile time, so adding keyword here is all, that is needed.
+ */
+constexpr KeywordSpelling KEYWORDS[] = {
+    { "if", Keyword::KEYWORD_IF },
+    { "else", Keyword::KEYWORD_ELSE },
+    { "while", Keyword::KEYWORD_WHILE },
+    { "for", Keyword::KEYWORD_FOR },
+};
+
+enum Operator : unsigned char {
+    /**
+     * Token isn't an operator.
+     */
+    OPERATOR_NONE,
+    OPERATOR_ASSIGN,
+    OPERATOR_ADD,
+    OPERATOR_SUBTRACT,
+    OPERATOR_MULTIPLY,
+    OPERATOR_DIVIDE,
+    OPERATOR_MOD,
+    OPERATOR_NOT_EQUAL,
+    OPERATOR_EQUAL,
+    OPERATOR_GREATER,
+    OPERATOR_GREATER_EQUAL,
+    OPERATOR_LESS,
+    OPERATOR_LESS_EQUAL,
+};
+
+struct OperatorSpelling {
+    std::string_view text;
+    Operator oper = Operator::OPERATOR_NONE;
+};
+
+/**
+ * All operators of language, one or two ASCII chars long. Lexer builds
+    longest-match table of them, keyed on the first char, at compile time.
+ */
+constexpr OperatorSpelling OPERATORS[] = {
+    { "=", Operator::OPERATOR_ASSIGN },
+    { "+", Operator::OPERATOR_ADD },
+    { "-", Operator::OPERATOR_SUBTRACT },
+    { "*", Operator::OPERATOR_MULTIPLY },
+    { "/", Operator::OPERATOR_DIVIDE },
+    { "%", Operator::OPERATOR_MOD },
+    { "!=", Operator::OPERATOR_NOT_EQUAL },
+    { "==", Operator::OPERATOR_EQUAL },
+    { ">", Operator::OPERATOR_GREATER },
+    { ">=", Operator::OPERATOR_GREATER_EQUAL },
+    { "<", Operator::OPERATOR_LESS },
+    { "<=", Operator::OPERATOR_LESS_EQUAL },
+};
+
+class PackedTokens;
+
+/**
+ * Content of token doesn't own its chars. It points to Source of Lexer,
+    which produced it, to decoded string literals arena of that Lexer, or to
+    static error message. So Lexer must outlive all of its tokens.
+ *
+ * Lexer, which reads SourceStream, keeps only window of text, so content of
+    its tokens is valid only until the next call of Lexer::next().
+ */
 struct Token {
     TokenType type;
-    std::string content;
-    unsigned long line;
-    unsigned long column;
+    std::string_view content;
+    // Byte offset of token in code (of content for STRING tokens). Line and
+    // column are found from it only when needed, see Lexer::locate().
+    unsigned long offset;
+    // Set for KEYWORD tokens, so keywords are compared without their text
+    Keyword keyword = Keyword::KEYWORD_NONE;
+    // Set for OPERATOR tokens
+    Operator oper = Operator::OPERATOR_NONE;
+    // Set for IDENTIFIER and STRING tokens, if Lexer interns them
+    Symbol symbol = NO_SYMBOL;
+
+    std::string to_string(SourcePosition position);
+};
 
-    std::string to_string();
+/**
+ * Change of code: `removed` bytes from `offset` are replaced with `inserted`
+    text.
+ */
+struct TextEdit {
+    unsigned long offset;
+    unsigned long removed;
+    std::string_view inserted;
+};
+
+/**
+ * Change of token buffer, made by Lexer::relex(): `removed` tokens from
+    `start` are replaced with `inserted` tokens. Tokens after them are the
+    same, only their offsets are moved by the edit.
+ */
+struct TokenChange {
+    unsigned long start;
+    unsigned long removed;
+    unsigned long inserted;
+};
+
+/**
+ * Stack of open parens and braces. First INLINE_CAPACITY of them are kept
+    inside of object, deeper ones in heap, so usual nesting never allocates.
+ */
+class ParenStack {
+private:
+    static const unsigned long INLINE_CAPACITY = 32;
+
+    TokenType inlineItems[INLINE_CAPACITY];
+    std::vector<TokenType> overflow;
+    unsigned long depth = 0;
+
+public:
+    void push(TokenType type);
+    /**
+     * Removes the top item and returns it, or returns PROGRAM_START, if stack
+        is empty.
+     */
+    TokenType pop();
+    /**
+     * Returns the top item, or PROGRAM_START, if stack is empty.
+     */
+    TokenType top() const;
+    unsigned long size() const;
+};
+
+/**
+ * Checks order of tokens: which token may follow which (see TokenType), and
+    that parens and braces are closed by their own kind. Lexer checks each
+    token in next(), parallel lexing checks all of them in one pass, after
+    chunks are joined.
+ *
+ * Which token may follow which is one load from transition table, built at
+    compile time from the rules in lexer.cpp.
+ */
+class TokenValidator {
+private:
+    TokenType prevType = TokenType::PROGRAM_START;
+    Keyword prevKeyword = Keyword::KEYWORD_NONE;
+    ParenStack parens;
+
+public:
+    /**
+     * Returns LEXER_ERROR token, if token can't follow the previous ones.
+        Otherwise remembers it as the previous one.
+     */
+    std::optional<Token> check(const Token &token);
+    /**
+     * Remembers token as the previous one, even if it's invalid there, so
+        validation continues after error. Unmatched closing paren is dropped.
+     */
+    void accept(const Token &token);
 };
 
 class Lexer {
 private:
-    enum PendingType {
-        UNKNOWN,
-        IDENTIFIER,
-        NUMBER,
-        OPERATOR,
-    };
-
-    const std::string LETTERS = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    const std::string DIGITS = "0123456789";
-    const std::string IDENTIFIER_CHARS_START = LETTERS;
-    const std::string IDENTIFIER_CHARS = LETTERS + DIGITS + "_";
     const char FLOATING_POINT = '.';
     const char LPAREN = '(';
     const char RPAREN = ')';
@@ -159,37 +315,157 @@ private:
     const char RBRACKET = ']';
     const char ARG_SEPARATOR = ',';
     const char ESCAPE = '\\';
-    const std::string OPERATORS[12] = {
-        "=",
-        "+", "-", "*", "/", "%",
-        "!=", "==", ">", ">=", "<", "<=",
-    };
-    const std::string WHITESPACE_CHARS = "\n\t ";
-
-    std::string code;
+
+    /**
+     * Streaming: bytes, which are kept in window after the cursor, before
+        token is lexed. Token, that ends closer than half of it to the end of
+        window, may continue in the next block.
+     */
+    static const unsigned long STREAM_LOOKAHEAD = 32;
+
+    Source source;
+    std::optional<SourceStream> stream;
+    // Streaming: offset of window in code and its position, which is moved
+    // over text, when text is dropped from window
+    unsigned long windowOffset;
+    SourcePosition windowPosition;
+    std::optional<SourceMap> map;
+    std::string_view code;
+    Arena strings;
+    // Decoded strings of chunks, lexed by fillParallel()
+    std::vector<Arena> chunkStrings;
+    std::string stringBuffer;
     unsigned long index;
-    PendingType type;
-    unsigned long line;
-    unsigned long column;
-    std::stack<TokenType> parens;
-    TokenType prevType = TokenType::PROGRAM_START;
+    // Decoded char at this->index, so each char is decoded only once
+    char32_t current;
+    unsigned char currentLength;
+    TokenValidator validator;
+    // Code is cut at invalid UTF-8, which is reported after the last token
+    bool invalidUtf8;
+    bool recovering = false;
+    SymbolTable *symbols = nullptr;
+    // Tokens of the last fill() or relex() reach the end of code, so relex()
+    // may keep tokens after edit
+    bool filledWhole = false;
+    // Order error right after lexer error is its consequence, so it isn't reported
+    bool afterError = false;
+    std::vector<Token> diagnostics;
 
 public:
-    explicit Lexer(std::string input);
+    // Parallel lexing: bytes of code per chunk
+    static const unsigned long DEFAULT_CHUNK_SIZE = 1 << 20;
 
-    std::optional<Token> next();
-    Token findKeyword(Token token);
+    /**
+     * Copies input into own padded Source. Use Source::fromPadded() to lex
+        caller's buffer in place.
+     */
+    explicit Lexer(std::string_view input);
+    /**
+     * Lexes code of source in place. Source padding is a sentinel for the end
+        of code, so decoding and scanning chars never check bounds.
+     */
+    explicit Lexer(Source source);
+    /**
+     * Lexes code, read from stream block by block. Only text of current
+        token (and the rest of block) is kept in memory, so tokens must be
+        copied, if they are needed after the next call of next().
+     */
+    explicit Lexer(SourceStream stream);
 
+    std::optional<Token> next();
+    /**
+     * In recovery mode next() doesn't return LEXER_ERROR tokens. Errors are
+        recorded into diagnostics, and lexer skips to the next whitespace or
+        delimiter (or the end of invalid UTF-8) and continues. Token, which
+        can't follow the previous one, is reported and returned anyway.
+     *
+     * Streamed code isn't read after invalid UTF-8, and fillParallel() lexes
+        in one thread in this mode.
+     */
+    void setRecovering(bool recovering);
+    /**
+     * LEXER_ERROR tokens, recorded in recovery mode, in order of offsets.
+     */
+    const std::vector<Token> &getDiagnostics() const;
+    /**
+     * Interns content of IDENTIFIER and STRING tokens into `symbols`, which
+        must outlive tokens, and sets their Token::symbol. Nothing is
+        interned, if it's nullptr (default).
+     */
+    void setSymbols(SymbolTable *symbols);
+    SymbolTable *getSymbols() const;
+    /**
+     * Lexes the rest of code into packed buffer, which is reset for code of
+        this lexer (so lexer must outlive it). Returns LEXER_ERROR token, if
+        lexing stopped at error. SourceStream doesn't keep code, so streaming
+        lexer can't fill buffer.
+     */
+    std::optional<Token> fill(PackedTokens *tokens);
+    /**
+     * Same as fill(), but code is split into chunks of about `chunkSize`
+        bytes, which are lexed by `threadCount` threads (including calling
+        one), and joined in order. Then all tokens are validated in one pass.
+     *
+     * Chunk starts at the beginning of line, assuming that it's outside of
+        string literal. If it isn't, tokens of chunk are wrong until they
+        meet tokens of previous chunk, so that part of chunk is lexed again,
+        when chunks are joined.
+     */
+    std::optional<Token> fillParallel(PackedTokens *tokens, unsigned long threadCount, unsigned long chunkSize = DEFAULT_CHUNK_SIZE);
+    /**
+     * Line and column of `offset` in code (e.g. offset of token). SourceMap
+        of code is built on the first call. Streaming lexer doesn't keep code,
+        so it locates only offsets in its window: of the last token or after
+        it.
+     */
+    SourcePosition locate(unsigned long offset);
+    /**
+     * Applies `edit` to own code and updates `tokens`, filled by the last
+        fill(), fillParallel() or relex() of this lexer. Only tokens from the
+        last ones before edit are lexed again, until they meet the old
+        tokens after edit (at the same offset, moved by edit), so cost of
+        lexing is proportional to the edit, not to code. Code is still
+        copied and validated as UTF-8 as a whole, which is much faster.
+     *
+     * Returns LEXER_ERROR token, if lexing stopped at error (tokens after it
+        are dropped). Order of tokens isn't checked, errors aren't recovered
+        and streaming lexer can't relex. If tokens don't reach the end of
+        code, all of them are lexed again.
+     */
+    std::optional<Token> relex(PackedTokens *tokens, const TextEdit &edit, TokenChange *change);
 
 private:
-    Utf8Char peekChar();
-    Utf8Char advanceChar();
+    /**
+     * Lexer of chunk: lexes `code` from `start`, which must be start of
+        char. Code isn't validated again.
+     */
+    Lexer(std::string_view code, unsigned long start, bool invalidUtf8);
+
+    void loadCode();
+    void intern(Token *token);
+    std::optional<Token> nextToken();
+    std::optional<Token> nextStreamed();
+    void recordError(const Token &error);
+    void skipToDelimiter();
+    bool resumeAfterInvalidUtf8();
+    unsigned long lexChunk(unsigned long end, PackedTokens *tokens, std::vector<std::uint32_t> *boundaries, std::optional<Token> *error);
+    void refill();
+    bool reachesBlockEnd();
+    void rewind(unsigned long index);
+    void decodeCurrent();
+    char32_t peekChar();
+    void appendCurrent(std::string *string);
+    std::optional<Token> finish();
+    char32_t advanceChar();
+    void jumpTo(const char *ptr);
     void skipWhitespaces();
     Token nextIdentifier();
     Token nextNumber();
-    Token nextString(Utf8Char closingChar);
-    std::optional<std::string> find_operator();
-    std::optional<std::string> get_operator(std::string str, short depth);
+    Token nextString(char32_t closingChar);
+    static unsigned long appendEscaped(const char *escape, std::string *buffer);
+    std::string_view slice(unsigned long start);
+    unsigned long offsetOf(unsigned long index);
+    Operator findOperator();
 };
 
 }
@@ -3,30 +3,48 @@
 #define REMAC_PARSER 1
 
 #include <remac/utf8.hpp>
+#include <remac/arena.hpp>
 #include <remac/lexer.hpp>
+#include <remac/symbols.hpp>
+#include <remac/tokens.hpp>
 
 #include <exception>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
 namespace remac {
 
+class FlatAst;
+
 class Printable {
 public:
     virtual std::string toString() = 0;
     virtual void print();
 };
 
+/**
+ * Node, written in binary AST format (see AstFormat). Nodes are read back by
+    AstFormat::load() in one pass, which needs symbol table and knows types of
+    children from their tags, so there's no reading counterpart here.
+ */
 class Serializable {
 public:
     virtual unsigned long getByteLength() = 0;
+    /**
+     * Writes getByteLength() bytes into buffer and returns their count.
+     */
     virtual unsigned long toBytes(void *buffer) = 0;
-    virtual unsigned long fromBytes(void *buffer) = 0;
 };
 
 class AstNode : public Serializable, public Printable {
 public:
+    /**
+     * Values are tags of nodes in binary AST format, so new types are added
+        to the end, or AstFormat::VERSION is changed.
+     */
     enum NodeType {
         NODE_EMPTY,
         NODE_FUNCTION_CALL,
@@ -40,6 +58,13 @@ public:
         NODE_OPERATION_MULTIPLY,
         NODE_OPERATION_DIVIDE,
         NODE_OPERATION_MOD,
+        NODE_OPERATION_EQUAL,
+        NODE_OPERATION_NOT_EQUAL,
+        NODE_OPERATION_LESS,
+        NODE_OPERATION_LESS_EQUAL,
+        NODE_OPERATION_GREATER,
+        NODE_OPERATION_GREATER_EQUAL,
+        NODE_OPERATION_NEGATE,
         NODE_INT_CONSTANT,
         NODE_FLOAT_CONSTANT,
         NODE_STRING_CONSTANT,
@@ -49,9 +74,11 @@ public:
         NODE_VARIABLE_REFERENCE,
     };
 
-    // unsigned long getByteLength() override;
-    // unsigned long toBytes(void *buffer) override;
-    // unsigned long fromBytes(void *buffer) override;
+    /**
+     * Whole subtree of node in AstFormat, written by AstFormat::writeNode().
+     */
+    unsigned long getByteLength() override;
+    unsigned long toBytes(void *buffer) override;
 
     virtual NodeType getType();
 
@@ -64,20 +91,34 @@ public:
 
 class SequenceNode : public AstNode {
 private:
-    std::vector<AstNode *> nodes;
+    AstNode **nodes;
+    unsigned long count;
 
 public:
-    explicit SequenceNode(std::vector<AstNode *> nodes);
+    explicit SequenceNode(const std::vector<AstNode *> &nodes);
+    /**
+     * Takes `nodes` array without copying. Array of heap sequence is
+        allocated by new[] and deleted with it; array of sequence in Parser
+        arena is in the same arena, and is freed with it.
+     */
+    SequenceNode(AstNode **nodes, unsigned long count);
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
+    /**
+     * Copy of nodes. Sequence itself may be iterated, or accessed by index,
+        without copying.
+     */
     std::vector<AstNode *> getSequence();
+    /**
+     * Count and nodes of sequence, accessed without copying.
+     */
+    unsigned long getCount();
+    AstNode *getNode(unsigned long index);
+    AstNode *const *begin();
+    AstNode *const *end();
 
     bool equalTo(AstNode *node) override;
 
@@ -90,21 +131,19 @@ public:
  */
 class FunctionCallNode : public AstNode {
 private:
-    std::string name;
+    const SymbolTable *symbols;
+    Symbol name;
     SequenceNode *args;
 
 public:
-    FunctionCallNode(std::string name, SequenceNode *args);
+    FunctionCallNode(const SymbolTable *symbols, Symbol name, SequenceNode *args);
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
-    std::string getName();
+    std::string_view getName();
+    Symbol getSymbol();
     SequenceNode *getArgs();
 
     bool equalTo(AstNode *node) override;
@@ -118,16 +157,20 @@ public:
 class ProgramNode : public AstNode {
 private:
     SequenceNode *body;
+    // Arena of all other nodes of program, if they are in arena
+    Arena *nodes;
 
 public:
     explicit ProgramNode(SequenceNode *body);
+    /**
+     * Takes ownership of arena `nodes`, which holds all nodes of `body`. They
+        are freed with arena at once, when program is deleted, instead of
+        deleting them one by one.
+     */
+    ProgramNode(SequenceNode *body, Arena *nodes);
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     SequenceNode *getBody();
@@ -152,10 +195,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getCondition();
@@ -181,10 +220,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getCondition();
@@ -222,10 +257,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     SequenceNode *getInitializationBody();
@@ -244,21 +275,19 @@ public:
  */
 class VariableAssignmentNode : public AstNode {
 private:
-    std::string name;
+    const SymbolTable *symbols;
+    Symbol name;
     AstNode *value;
 
 public:
-    VariableAssignmentNode(std::string name, AstNode *value);
+    VariableAssignmentNode(const SymbolTable *symbols, Symbol name, AstNode *value);
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
-    std::string getName();
+    std::string_view getName();
+    Symbol getSymbol();
     AstNode *getValue();
 
     bool equalTo(AstNode *node) override;
@@ -279,10 +308,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     SequenceNode *getArray();
@@ -302,10 +327,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getArray();
@@ -318,20 +339,18 @@ public:
 
 class VariableReferenceNode : public AstNode {
 private:
-    std::string name;
+    const SymbolTable *symbols;
+    Symbol name;
 
 public:
-    explicit VariableReferenceNode(std::string name);
+    VariableReferenceNode(const SymbolTable *symbols, Symbol name);
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
-    std::string getName();
+    std::string_view getName();
+    Symbol getSymbol();
 
     bool equalTo(AstNode *node) override;
 
@@ -354,10 +373,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getLeft();
@@ -382,10 +397,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getLeft();
@@ -410,10 +421,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getLeft();
@@ -438,10 +445,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getLeft();
@@ -466,10 +469,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     AstNode *getLeft();
@@ -480,6 +479,172 @@ public:
     ~OperationModNode() override;
 };
 
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Arg><Operator "=="><Arg>
+ */
+class OperationEqualNode : public AstNode {
+private:
+    AstNode *left;
+    AstNode *right;
+
+public:
+    OperationEqualNode(AstNode *left, AstNode *right);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getLeft();
+    AstNode *getRight();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationEqualNode() override;
+};
+
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Arg><Operator "!="><Arg>
+ */
+class OperationNotEqualNode : public AstNode {
+private:
+    AstNode *left;
+    AstNode *right;
+
+public:
+    OperationNotEqualNode(AstNode *left, AstNode *right);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getLeft();
+    AstNode *getRight();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationNotEqualNode() override;
+};
+
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Arg><Operator "<"><Arg>
+ */
+class OperationLessNode : public AstNode {
+private:
+    AstNode *left;
+    AstNode *right;
+
+public:
+    OperationLessNode(AstNode *left, AstNode *right);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getLeft();
+    AstNode *getRight();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationLessNode() override;
+};
+
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Arg><Operator "<="><Arg>
+ */
+class OperationLessEqualNode : public AstNode {
+private:
+    AstNode *left;
+    AstNode *right;
+
+public:
+    OperationLessEqualNode(AstNode *left, AstNode *right);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getLeft();
+    AstNode *getRight();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationLessEqualNode() override;
+};
+
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Arg><Operator ">"><Arg>
+ */
+class OperationGreaterNode : public AstNode {
+private:
+    AstNode *left;
+    AstNode *right;
+
+public:
+    OperationGreaterNode(AstNode *left, AstNode *right);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getLeft();
+    AstNode *getRight();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationGreaterNode() override;
+};
+
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Arg><Operator ">="><Arg>
+ */
+class OperationGreaterEqualNode : public AstNode {
+private:
+    AstNode *left;
+    AstNode *right;
+
+public:
+    OperationGreaterEqualNode(AstNode *left, AstNode *right);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getLeft();
+    AstNode *getRight();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationGreaterEqualNode() override;
+};
+
+/**
+ * Let Arg = Identifier|IntNumber|FloatNumber|Lparen|Lbracket|String;
+ * Consist of <Operator "-"><Arg>
+ */
+class OperationNegateNode : public AstNode {
+private:
+    AstNode *value;
+
+public:
+    explicit OperationNegateNode(AstNode *value);
+
+    std::string toString() override;
+
+    NodeType getType() override;
+
+    AstNode *getValue();
+
+    bool equalTo(AstNode *node) override;
+
+    ~OperationNegateNode() override;
+};
+
 /**
  * Consist of <IntNumber>
  */
@@ -492,10 +657,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     long long getValue();
@@ -517,10 +678,6 @@ public:
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
     double getValue();
@@ -535,20 +692,18 @@ public:
  */
 class StringConstantNode : public AstNode {
 private:
-    std::string value;
+    const SymbolTable *symbols;
+    Symbol value;
 
 public:
-    explicit StringConstantNode(std::string value);
+    StringConstantNode(const SymbolTable *symbols, Symbol value);
 
     std::string toString() override;
 
-    unsigned long getByteLength() override;
-    unsigned long toBytes(void *buffer) override;
-    unsigned long fromBytes(void *buffer) override;
-
     NodeType getType() override;
 
-    std::string getValue();
+    std::string_view getValue();
+    Symbol getSymbol();
 
     bool equalTo(AstNode *node) override;
 
@@ -563,21 +718,130 @@ struct PrioritizedOperator {
 class ParserException : public std::exception {
 public:
     std::string message;
+    // Offset of token, where error is found, if it's known. Line and column
+    // are found from it by catcher (see Lexer::locate()).
+    std::optional<unsigned long> offset;
 
 public:
     explicit ParserException(std::string message);
+    ParserException(std::string message, unsigned long offset);
 };
 
-class Parser {
+/**
+ * Tokens of Parser, addressed by index from the start of program. Either
+    holds all tokens of program, unpacks them from PackedTokens one by one,
+    or pulls them from Lexer on demand into ring buffer. Parser releases tokens of each parsed top-level statement, so ring
+    holds only tokens of the largest statement (and ring grows to it, if
+    needed). Ring copies token contents into own strings, because content of
+    streamed token lives only until the next token is lexed. Content of
+    interned token is taken from symbol table of lexer instead.
+ *
+ * Reference to token is valid only until the next call of has() or at().
+ */
+class TokenWindow {
+public:
+    static const unsigned long DEFAULT_CAPACITY = 64;
+
 private:
     std::vector<Token> tokens;
+    // Ring only: contents of tokens with the same indexes
+    std::vector<std::string> contents;
+    Lexer *lexer;
+    // Index of the first held token in program, and its slot in ring
+    unsigned long first;
+    unsigned long head;
+    unsigned long count;
+    // Packed only: buffer and the token, which was unpacked last
+    PackedTokens *packed;
+    Token unpacked;
+    unsigned long unpackedIndex;
+
+public:
+    explicit TokenWindow(std::vector<Token> &&tokens);
+    /**
+     * Reads tokens from `tokens`, which must outlive window.
+     */
+    explicit TokenWindow(PackedTokens *tokens);
+    /**
+     * Pulls tokens from `lexer`, which must outlive window. Throws
+        ParserException *, when lexer returns LEXER_ERROR.
+     */
+    explicit TokenWindow(Lexer *lexer, unsigned long capacity = DEFAULT_CAPACITY);
+
+    /**
+     * True, if program has token with this index.
+     */
+    bool has(unsigned long index);
+    /**
+     * Throws ParserException *, if program ends before this index.
+     */
+    Token &at(unsigned long index);
+    /**
+     * Tokens before this index are never accessed again (ignored, if all
+        tokens of program are held).
+     */
+    void release(unsigned long index);
+    /**
+     * Count of tokens, which window may hold without growing.
+     */
+    unsigned long getCapacity();
+
+private:
+    bool pull();
+    void grow();
+};
+
+/**
+ * Names and string constants of nodes are symbols of `symbols` table, which
+    must outlive nodes. Tokens, interned by lexer, must be interned into the
+    same table.
+ */
+class Parser {
+private:
+    // Chunk of node arena: about a thousand of nodes per allocation
+    static const unsigned long NODE_CHUNK_SIZE = 64 * 1024;
+
+    TokenWindow tokens;
+    SymbolTable *symbols;
     std::vector<AstNode *> programNodes;
+    bool useArena = true;
+    // Arena of program, which is parsed now
+    Arena *nodes = nullptr;
+    // Stack of nodes of sequences, which are parsed now. Nested sequence is
+    // collected on top of its parent and popped, when it's created, so one
+    // buffer serves all sequences of program.
+    std::vector<AstNode *> pending;
 
 private:
     std::vector<AstNode *> parseTokens();
+    Symbol intern(const Token &token);
+    template<typename T, typename... Args>
+    T *create(Args &&...args);
+    /**
+     * Sequence of pending nodes from `start`, which are popped.
+     */
+    SequenceNode *createSequence(unsigned long start);
+    AstNode *createOperation(AstNode::NodeType type, AstNode *left, AstNode *right);
 
 public:
-    explicit Parser(std::vector<Token> tokens);
+    Parser(std::vector<Token> &&tokens, SymbolTable *symbols);
+    /**
+     * Parses tokens, streamed from `lexer`, which must outlive Parser, keeping
+        only tokens of the current statement in memory. Lexer interns tokens
+        into `symbols`, so their content isn't copied.
+     */
+    Parser(Lexer *lexer, SymbolTable *symbols);
+    /**
+     * Parses packed tokens, which must outlive Parser.
+     */
+    Parser(PackedTokens *tokens, SymbolTable *symbols);
+
+    /**
+     * By default nodes of program are allocated in arena, owned by
+        ProgramNode. Without arena each node is allocated on heap and deletes
+        its children, so nodes of tree may be replaced one by one.
+     */
+    void setArena(bool useArena);
 
     /*
         if (x)
@@ -589,6 +853,11 @@ public:
         if (x + 5 > y)
     */
     ProgramNode *parse();
+    /**
+     * Parses program into flat form. Tree is parsed first, in arena by
+        default, and flattened in one pass, then it's freed.
+     */
+    FlatAst *parseFlat();
 
     std::tuple<SequenceNode *, unsigned long> parseSequence(unsigned long index, TokenType stop);
     /*
@@ -597,11 +866,15 @@ public:
     std::tuple<AstNode *, unsigned long> parseStatement(unsigned long index);
     std::tuple<ListDefinitionNode *, unsigned long> parseListDefinition(unsigned long index);
     std::tuple<AstNode *, unsigned long> parseExpression(unsigned long index);
+    std::tuple<AstNode *, unsigned long> parseOperation(unsigned long index, unsigned short minPriority);
+    /**
+     * Operand of operator: term with optional unary minuses before it.
+     */
+    std::tuple<AstNode *, unsigned long> parseUnary(unsigned long index);
     std::tuple<AstNode *, unsigned long> parseTerm(unsigned long index);
     std::tuple<FunctionCallNode *, unsigned long> parseFunctionCall(unsigned long index);
     std::tuple<SequenceNode *, unsigned long> parseEnclosed(unsigned long index, TokenType stop);
-    std::vector<PrioritizedOperator> getPriorities(std::vector<Token> tokens);
-    // AstNode *parseMath(std::vector<AstNode *> values, std::vector<PrioritizedOperator> operators);
+    static PrioritizedOperator getPriority(const Token &token);
 };
 
 }
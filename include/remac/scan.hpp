@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef REMAC_SCAN
+#define REMAC_SCAN 1
+
+#include <vector>
+
+namespace remac {
+
+/**
+ * Kernels, which skip whole runs of chars of the same class at once. They use
+    widest SIMD extension, allowed by getSimdLevel(), and fall back to simple
+    loops on other CPUs.
+ *
+ * Kernels read input in blocks of up to 32 bytes, so they may read up to 32
+    bytes after the end of run. Run must be terminated by a char out of class
+    before the end of readable memory: Source padding guarantees it.
+ */
+
+/**
+ * Finds the end of run of whitespace chars ('\n', '\t' and ' ', same as in
+    Lexer), which starts at `ptr`.
+ */
+const char *scanWhitespaces(const char *ptr);
+
+/**
+ * Finds the end of run of ASCII identifier chars (`[A-Za-z0-9_]`), which
+    starts at `ptr`.
+ */
+const char *scanIdentifierChars(const char *ptr);
+
+/**
+ * Finds the first `quote` or '\\' in [ptr, end), or returns `end`: end of
+    run of plain string literal chars. Like scanLineStarts(), it never reads
+    at or after `end`, so long literals are scanned without padding.
+ */
+const char *scanStringChars(const char *ptr, const char *end, char quote);
+
+/**
+ * Appends offsets (from `begin`) of lines, which start inside of text
+    [begin, end), to `lineStarts`: line starts after LF, CRLF and lone CR.
+    Unlike run kernels, it never reads at or after `end`.
+ */
+void scanLineStarts(const char *begin, const char *end, std::vector<unsigned long> *lineStarts);
+
+}
+
+#endif // REMAC_SCAN
@@ -0,0 +1,194 @@
+#pragma once
+
+#ifndef REMAC_SOURCE
+#define REMAC_SOURCE 1
+
+#include <exception>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+/**
+ * Count of zero bytes, which always follow source code in memory. Lexer may
+    read them freely (e.g. as lookahead of last char), so it never needs to
+    check for the end of buffer, while decoding chars.
+ */
+const unsigned long SOURCE_PADDING = 64;
+
+class SourceException : public std::exception {
+public:
+    std::string message;
+
+public:
+    explicit SourceException(std::string message);
+};
+
+/**
+ * Read-only program text, followed by SOURCE_PADDING zero bytes. Either owns
+    heap copy of text, maps file into memory without copying it, or borrows
+    buffer of caller, which is already padded. Text never moves in memory,
+    even if Source itself is moved.
+ */
+class Source {
+private:
+    const char *data;
+    unsigned long size;
+    char *buffer;
+    void *mapping;
+    unsigned long mappingSize;
+
+    Source();
+
+public:
+    /**
+     * Copies code into own padded buffer.
+     */
+    explicit Source(std::string_view code);
+    Source(const Source &) = delete;
+    Source(Source &&other) noexcept;
+    Source &operator=(const Source &) = delete;
+    Source &operator=(Source &&other) noexcept;
+
+    /**
+     * Maps file into memory read-only (where supported, otherwise reads it).
+        Pipes and other files, which aren't regular, are read up to their end.
+     *
+     * Throws SourceException *, if file can't be read.
+     */
+    static Source fromFile(const std::string &path);
+    /**
+     * Uses `code` in place, without copying. It must be followed by at least
+        SOURCE_PADDING zero bytes (e.g. appended to std::string), and buffer
+        must outlive Source and everything, that is lexed from it.
+     *
+     * Throws SourceException *, if padding isn't zeroed.
+     */
+    static Source fromPadded(std::string_view code);
+
+    const char *getData() const;
+    unsigned long getSize() const;
+    std::string_view getCode() const;
+
+    ~Source();
+
+private:
+    void release();
+    /**
+     * Reads file, which can't be mapped, and whose size isn't known, up to
+        its end into padded buffer. Closes `fd`.
+     */
+    static Source readUnmapped(int fd, const std::string &path);
+};
+
+struct SourcePosition {
+    unsigned long line;
+    unsigned long column;
+};
+
+/**
+ * Index of offsets, where lines of code start. Maps byte offset in code to
+    line and column, as Lexer counts them: lines end with LF, CRLF or lone CR,
+    and column is count of chars (not bytes) from the start of line, from 1.
+ */
+class SourceMap {
+private:
+    std::string_view code;
+    std::vector<unsigned long> lineStarts;
+
+public:
+    /**
+     * Scans code for line ends once. Code must outlive SourceMap.
+     */
+    explicit SourceMap(std::string_view code);
+
+    /**
+     * Binary search of line, then count of chars before offset in it.
+     */
+    SourcePosition locate(unsigned long offset) const;
+    unsigned long getLineCount() const;
+
+    /**
+     * Position after `text`, which starts at `position`. Used, where code
+        isn't kept whole (see SourceStream). Byte after text must be readable
+        (e.g. Source padding), because it decides, if CR ends line.
+     */
+    static SourcePosition advance(SourcePosition position, std::string_view text);
+};
+
+/**
+ * Program text, read sequentially from file descriptor or std::istream in
+    blocks, for inputs too big to be kept in memory at once. Only window of
+    text is buffered: Lexer drops text before current token, when it reads
+    the next block. Window is followed by SOURCE_PADDING zero bytes, like
+    Source.
+ *
+ * Window always ends at the boundary of UTF-8 char: bytes of char, which is
+    split between blocks, are held back until the rest of it is read. Each
+    block is validated, when it's read, and window is cut at the first
+    invalid sequence (see isInvalid()).
+ */
+class SourceStream {
+public:
+    static const unsigned long DEFAULT_BLOCK_SIZE = 65536;
+
+private:
+    std::istream *stream;
+    int fd;
+    char *buffer;
+    unsigned long capacity;
+    unsigned long size;
+    unsigned long blockSize;
+    // Leading bytes of UTF-8 char, which is split by the end of last block
+    char tail[4];
+    unsigned long tailSize;
+    bool ended;
+    bool invalid;
+
+    explicit SourceStream(unsigned long blockSize);
+
+public:
+    /**
+     * Reads from `stream`, which must outlive SourceStream.
+     */
+    explicit SourceStream(std::istream &stream, unsigned long blockSize = DEFAULT_BLOCK_SIZE);
+    /**
+     * Reads from file descriptor `fd`, which isn't closed by SourceStream.
+     */
+    explicit SourceStream(int fd, unsigned long blockSize = DEFAULT_BLOCK_SIZE);
+    SourceStream(const SourceStream &) = delete;
+    SourceStream(SourceStream &&other) noexcept;
+    SourceStream &operator=(const SourceStream &) = delete;
+    SourceStream &operator=(SourceStream &&other) noexcept;
+
+    /**
+     * Drops text before `keepFrom` offset of window, and appends next block
+        (at least as big, as the rest of window, so text of long token is read
+        in O(length) time). Does nothing but dropping, after the input ended.
+     *
+     * Throws SourceException *, if input can't be read.
+     */
+    void advance(unsigned long keepFrom);
+
+    std::string_view getCode() const;
+    /**
+     * True, if window contains the rest of input.
+     */
+    bool isEnded() const;
+    /**
+     * True, if window was cut at invalid UTF-8 (then it's also ended).
+     */
+    bool isInvalid() const;
+
+    ~SourceStream();
+
+private:
+    unsigned long read(char *into, unsigned long count);
+    void release();
+};
+
+}
+
+#endif // REMAC_SOURCE
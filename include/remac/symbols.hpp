@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef REMAC_SYMBOLS
+#define REMAC_SYMBOLS 1
+
+#include <remac/arena.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+/**
+ * Small integer ID of interned name. IDs are given in order of interning,
+    from 0, so they may index arrays of per-name data.
+ */
+typedef std::uint32_t Symbol;
+
+/**
+ * Not a symbol: set for tokens and nodes, which weren't interned.
+ */
+const Symbol NO_SYMBOL = UINT32_MAX;
+
+/**
+ * Interning table of one compilation. Each distinct identifier or string
+    literal is copied into it once and gets a Symbol, so names are compared
+    as integers, and equal names share memory.
+ *
+ * Table is open addressing with linear probing over symbol IDs, and keeps
+    hash of each name, so probing and growing never compare or rehash text
+    of other names. Names live in arena, so views, returned by getName(),
+    are valid during whole lifetime of table.
+ */
+class SymbolTable {
+private:
+    static const unsigned long INITIAL_CAPACITY = 64;
+
+    Arena names;
+    std::vector<std::string_view> symbols;
+    std::vector<std::uint64_t> hashes;
+    // Symbol of each slot, or NO_SYMBOL, if slot is empty. Size is power of 2.
+    std::vector<Symbol> slots;
+
+public:
+    SymbolTable();
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    /**
+     * Symbol of `name`. Name is copied into table, when it's met first time.
+     */
+    Symbol intern(std::string_view name);
+    /**
+     * Symbol of `name`, or NO_SYMBOL, if it wasn't interned.
+     */
+    Symbol find(std::string_view name) const;
+    std::string_view getName(Symbol symbol) const;
+    /**
+     * Count of distinct names.
+     */
+    unsigned long size() const;
+
+private:
+    static std::uint64_t hash(std::string_view name);
+    unsigned long findSlot(std::string_view name, std::uint64_t hash) const;
+    void grow();
+};
+
+}
+
+#endif // REMAC_SYMBOLS
@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef REMAC_TOKENS
+#define REMAC_TOKENS 1
+
+#include <remac/lexer.hpp>
+#include <remac/source.hpp>
+#include <remac/symbols.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+/**
+ * Compact buffer of tokens, kept as struct of arrays: 10 bytes per token,
+    instead of sizeof(Token). Type and keyword (or operator) are bytes, and
+    content is offset and length in code of Lexer, which filled the buffer.
+    Positions aren't stored: line and column of token are found from its
+    offset by SourceMap, which is built on first request.
+ *
+ * Only strings with escape sequences have content outside of code. They
+    are marked in details, and their length is an index in the list of
+    decoded contents.
+ *
+ * Symbols of interned tokens take 4 more bytes per token. Their array is
+    allocated only when the first token with symbol is pushed.
+ */
+class PackedTokens {
+private:
+    static const std::uint8_t STRING_DECODED = 1;
+
+    std::string_view code;
+    std::vector<std::uint8_t> types;
+    // Keyword of KEYWORD token, operator of OPERATOR token, otherwise 0
+    std::vector<std::uint8_t> details;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+    std::vector<std::string_view> decoded;
+    // Empty, if no token has symbol, otherwise it's sized up to the last one with symbol
+    std::vector<Symbol> symbols;
+    std::optional<SourceMap> map;
+
+public:
+    PackedTokens();
+
+    /**
+     * Forgets tokens and starts buffer for another code. Memory of arrays is
+        kept for reuse.
+     */
+    void reset(std::string_view code);
+    /**
+     * Reserves arrays for `count` tokens, when their count is known ahead.
+     */
+    void reserve(unsigned long count);
+    /**
+     * Appends token. Its content must be either inside of code, or live as
+        long as buffer.
+     */
+    void push(const Token &token);
+    /**
+     * Appends tokens of `other` buffer (for the same code) from `from`.
+     */
+    void append(const PackedTokens &other, unsigned long from);
+    /**
+     * Drops tokens from `size`.
+     */
+    void truncate(unsigned long size);
+    /**
+     * Moves buffer to changed `code`: replaces `count` tokens from `start`
+        with tokens of `other` buffer (for the new code), and moves offsets
+        of tokens after them by `shift`.
+     */
+    void replace(std::string_view code, unsigned long start, unsigned long count, const PackedTokens &other, long shift);
+    void setSymbol(unsigned long index, Symbol symbol);
+
+    unsigned long size() const;
+    TokenType getType(unsigned long index) const;
+    Keyword getKeyword(unsigned long index) const;
+    Operator getOperator(unsigned long index) const;
+    std::string_view getContent(unsigned long index) const;
+    unsigned long getOffset(unsigned long index) const;
+    Symbol getSymbol(unsigned long index) const;
+    SourcePosition getPosition(unsigned long index);
+    Token get(unsigned long index) const;
+
+    /**
+     * Bytes of heap memory, reserved by arrays of buffer (without SourceMap).
+     */
+    unsigned long getByteSize() const;
+
+private:
+    bool isDecoded(unsigned long index) const;
+};
+
+}
+
+#endif // REMAC_TOKENS
@@ -8,35 +8,79 @@
 
 #define UTF8_INVALID ((unsigned char)0)
 
-/*
-Possible UTF-8 chars (CORRECT(x)):
-1. Single-byte: 0xxxxxxx
-2. Two-byte:    110xxxxx 10xxxxxx
-3. Three-byte:  1110xxxx 10xxxxxx 10xxxxxx
-4. Four-byte:   11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-
-Impossible UTF-8 chars (INCORRECT(x)):
-1. 1xxxxxxx 0xxxxxxx
-2. 1xxxxxxx 11xxxxxx
-3. 11111xxx
-4. 10xxxxxx
-*/
-
 namespace remac {
 
-union Utf8Char {
+/**
+ * Decoded Unicode scalar value. `bytes` keep its UTF-8 encoding, padded with
+    zeros.
+ */
+struct Utf8Char {
     char bytes[4];
-    unsigned int codePoint;
+    char32_t codePoint;
+};
+
+/**
+ * Result of decodeUtf8(). `length` is UTF8_INVALID for invalid sequences.
+ */
+struct DecodedChar {
+    char32_t codePoint;
+    unsigned char length;
 };
 
+/**
+ * Decodes multibyte char. Two byte chars take a shortcut, longer ones go
+    through DFA with one table lookup per byte. Never reads at or after `end`.
+ */
+DecodedChar decodeUtf8Multibyte(const char *bytes, const char *end);
+
+/**
+ * Decodes one char, which starts before `end`. Sequence, truncated by `end`,
+    is invalid. ASCII chars are decoded inline with a single branch.
+ */
+inline DecodedChar decodeUtf8(const char *bytes, const char *end) {
+    unsigned char byte = (unsigned char)bytes[0];
+
+    if (byte < 0x80) {
+        return DecodedChar { .codePoint = byte, .length = 1 };
+    }
+
+    return decodeUtf8Multibyte(bytes, end);
+}
+
+/**
+ * Decodes one char without end of buffer. Decoding stops at the first byte,
+    which can't continue sequence (e.g. '\0'), so it is safe on NUL-terminated
+    and zero-padded buffers (see SOURCE_PADDING).
+ */
+inline DecodedChar decodeUtf8(const char *bytes) {
+    return decodeUtf8(bytes, bytes + 4);
+}
+
+/**
+ * Writes UTF-8 encoding of `codePoint` to `bytes` (up to 4 bytes) and returns
+    its length, or UTF8_INVALID for surrogates and values above U+10FFFF.
+ */
+unsigned char encodeUtf8(char32_t codePoint, char *bytes);
+
 std::tuple<unsigned char, Utf8Char> getNextUnicode(const char *inputBytes);
-Utf8Char utfFromCodePoint(unsigned int codePoint);
+std::tuple<unsigned char, Utf8Char> getNextUnicode(const char *inputBytes, const char *inputEnd);
+Utf8Char utfFromCodePoint(char32_t codePoint);
 Utf8Char fromAsciiChar(char chr);
 Utf8Char fromCharArray(char chr[4]);
 void utfStringAppend(std::string *string, Utf8Char chr);
 bool utfCharInString(const char *stringStart, const char *stringEnd, Utf8Char chr);
 bool utfCompareSingle(const char *string, Utf8Char chr2);
+/**
+ * Checks, that string is valid UTF-8 by RFC 3629: no overlong encodings,
+    surrogates, code points above U+10FFFF or truncated sequences. Uses SIMD
+    kernels (see getSimdLevel()), so it validates whole buffers at GB/s.
+ */
 bool isValidUtf8(const char *stringStart, const char *stringEnd);
+/**
+ * Returns pointer to the first byte of the first invalid sequence, or
+    `stringEnd`, if string is valid. Scalar, so meant for error reporting.
+ */
+const char *findInvalidUtf8(const char *stringStart, const char *stringEnd);
 std::string utfCharToString(Utf8Char chr);
 
 std::string charToString(char chr);
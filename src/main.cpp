@@ -1,18 +1,109 @@
 #include <remac/lexer.hpp>
 #include <remac/parser.hpp>
+#include <remac/source.hpp>
+#include <remac/symbols.hpp>
+#include <remac/tokens.hpp>
 
+#include <fstream>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <cstdio>
+#include <cstdlib>
+#include <utility>
 
 #define VERSION_MAJOR 0
 #define VERSION_MINOR 0
 #define VERSION_PATCH 0
 #define VERSION_TAG " (dev)"
 
-int main() {
+static void printUsage(const char *program) {
+    std::printf("Usage: %s [-f|--file <path>] [-s|--stream] [-j|--jobs <count>] [-k|--keep-going]\n", program);
+    std::printf("Without file, program is read as one line from standard input.\n");
+    std::printf("With --stream, program (or whole standard input) is read in blocks and parsed\n");
+    std::printf("without keeping all of its tokens in memory. Tokens aren't printed then.\n");
+    std::printf("With --jobs, big program is lexed in chunks by that count of threads.\n");
+    std::printf("With --keep-going, lexer reports all errors instead of stopping at the first one.\n");
+}
+
+/**
+ * Prints errors, recorded by lexer in recovery mode. Returns true, if there
+    are any.
+ */
+static bool printDiagnostics(remac::Lexer *lexer) {
+    for (remac::Token error : lexer->getDiagnostics()) {
+        std::cout << error.to_string(lexer->locate(error.offset)) << std::endl;
+    }
+
+    return !lexer->getDiagnostics().empty();
+}
+
+static void printParserException(remac::ParserException *exc, remac::Lexer *lexer) {
+    if (!exc->offset.has_value()) {
+        std::cout << "Exception: " << exc->message << std::endl;
+        return;
+    }
+
+    remac::SourcePosition position = lexer->locate(*exc->offset);
+    std::cout << "Exception on line " << position.line << ":" << position.column << ": " << exc->message << std::endl;
+}
+
+static int parseStreamed(remac::SourceStream stream, bool keepGoing) {
+    remac::SymbolTable symbols;
+    std::optional<remac::Lexer> lexer;
+
+    try {
+        lexer.emplace(std::move(stream));
+        lexer->setRecovering(keepGoing);
+        remac::Parser parser = remac::Parser(&*lexer, &symbols);
+        std::cout << "Parser output:" << std::endl;
+        remac::ProgramNode *program = parser.parse();
+
+        if (printDiagnostics(&*lexer)) {
+            delete program;
+            return 1;
+        }
+
+        program->print();
+        delete program;
+    } catch (remac::SourceException *exc) {
+        std::cout << "Error: " << exc->message << std::endl;
+        delete exc;
+        return 1;
+    } catch (remac::ParserException *exc) {
+        printDiagnostics(&*lexer);
+        printParserException(exc, &*lexer);
+        delete exc;
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
     std::string input;// = "Print([21, 5 * (2 + 1)])";
+    std::optional<std::string> filePath;
+    bool streamed = false;
+    unsigned long jobs = 1;
+    bool keepGoing = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if ((arg == "-f" || arg == "--file") && i + 1 < argc) {
+            filePath = argv[++i];
+        } else if (arg == "-s" || arg == "--stream") {
+            streamed = true;
+        } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            jobs = std::atoi(argv[++i]);
+        } else if (arg == "-k" || arg == "--keep-going") {
+            keepGoing = true;
+        } else {
+            printUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 2;
+        }
+    }
 
     std::printf(
         "Remac v.%u.%u.%u%s by Pakul Yauheni Stanislavovich\n",
@@ -21,39 +112,77 @@ int main() {
         VERSION_PATCH,
         VERSION_TAG
     );
-    std::printf(">> ");
-    std::fflush(stdout);
-    // std::cout << "WARNING: Debug mode, so input automatically filled" << std::endl;
-    std::getline(std::cin, input);
-    // std::cin >> input;
-    std::cout << "Command: '" << input << "'" << std::endl;
-    remac::Lexer lexer = remac::Lexer(input);
-    std::vector<remac::Token> tokens;
-
-    std::optional<remac::Token> last_token = lexer.next();
-    unsigned long i = 0;
-    std::cout << "Lexical analyzer output:" << std::endl;
 
-    while (last_token.has_value()) {
-        last_token = lexer.findKeyword(*last_token);
-        std::cout << i++ << ". ";
-        std::cout << last_token->to_string() << std::endl;
+    if (streamed) {
+        if (!filePath.has_value()) {
+            return parseStreamed(remac::SourceStream(std::cin), keepGoing);
+        }
+
+        std::ifstream file(*filePath, std::ios::binary);
+
+        if (!file.is_open()) {
+            std::cout << "Error: Can't open file '" << *filePath << "'" << std::endl;
+            return 1;
+        }
+
+        return parseStreamed(remac::SourceStream(file), keepGoing);
+    }
+
+    remac::Source source = remac::Source(std::string_view());
 
-        if (last_token->type == remac::TokenType::LEXER_ERROR) {
+    if (filePath.has_value()) {
+        try {
+            // File is mapped into memory and lexed in place, not read and copied
+            source = remac::Source::fromFile(*filePath);
+        } catch (remac::SourceException *exc) {
+            std::cout << "Error: " << exc->message << std::endl;
+            delete exc;
             return 1;
         }
 
-        tokens.push_back(*last_token);
-        last_token = lexer.next();
+        std::cout << "File: '" << *filePath << "' (" << source.getSize() << " bytes)" << std::endl;
+    } else {
+        std::printf(">> ");
+        std::fflush(stdout);
+        // std::cout << "WARNING: Debug mode, so input automatically filled" << std::endl;
+        std::getline(std::cin, input);
+        // std::cin >> input;
+        std::cout << "Command: '" << input << "'" << std::endl;
+        // Padding is appended to line itself, so it is lexed without copy
+        unsigned long size = input.size();
+        input.append(remac::SOURCE_PADDING, '\0');
+        source = remac::Source::fromPadded(std::string_view(input.data(), size));
+    }
+
+    remac::SymbolTable symbols;
+    remac::Lexer lexer = remac::Lexer(std::move(source));
+    remac::PackedTokens tokens;
+    lexer.setRecovering(keepGoing);
+    lexer.setSymbols(&symbols);
+    std::optional<remac::Token> error = lexer.fillParallel(&tokens, jobs);
+    std::cout << "Lexical analyzer output:" << std::endl;
+
+    for (unsigned long i = 0; i < tokens.size(); i++) {
+        std::cout << i << ". " << tokens.get(i).to_string(tokens.getPosition(i)) << std::endl;
+    }
+
+    if (error.has_value()) {
+        std::cout << tokens.size() << ". " << error->to_string(lexer.locate(error->offset)) << std::endl;
+        return 1;
+    }
+
+    if (printDiagnostics(&lexer)) {
+        return 1;
     }
 
     std::cout << "\nParser output:" << std::endl;
 
     try {
-        remac::Parser parser = remac::Parser(tokens);
+        remac::Parser parser = remac::Parser(&tokens, &symbols);
         parser.parse()->print();
     } catch (remac::ParserException *exc) {
-        std::cout << "Exception: " << exc->message << std::endl;
+        printParserException(exc, &lexer);
+        delete exc;
     }
 
     return 0;
@@ -0,0 +1,97 @@
+#include <remac/arena.hpp>
+
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace remac {
+
+Arena::Arena(unsigned long chunkSize) {
+    this->current = nullptr;
+    this->left = 0;
+    this->chunkSize = chunkSize;
+}
+
+Arena::Arena(Arena &&other) noexcept {
+    this->chunks = std::move(other.chunks);
+    this->current = other.current;
+    this->left = other.left;
+    this->chunkSize = other.chunkSize;
+    other.chunks.clear();
+    other.current = nullptr;
+    other.left = 0;
+}
+
+Arena &Arena::operator=(Arena &&other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->chunks = std::move(other.chunks);
+        this->current = other.current;
+        this->left = other.left;
+        this->chunkSize = other.chunkSize;
+        other.chunks.clear();
+        other.current = nullptr;
+        other.left = 0;
+    }
+
+    return *this;
+}
+
+static unsigned long alignmentPadding(char *ptr, unsigned long alignment) {
+    return (alignment - ((std::size_t)ptr & (alignment - 1))) & (alignment - 1);
+}
+
+void *Arena::allocate(unsigned long size, unsigned long alignment) {
+    if (size + alignment > this->chunkSize) {
+        // Oversized allocations get their own chunk, so rest of current one is still used
+        char *chunk = new char[size + alignment];
+        this->chunks.push_back(chunk);
+        return chunk + alignmentPadding(chunk, alignment);
+    }
+
+    unsigned long padding = alignmentPadding(this->current, alignment);
+
+    if (this->current == nullptr || padding + size > this->left) {
+        char *chunk = new char[this->chunkSize];
+        this->chunks.push_back(chunk);
+        this->current = chunk;
+        this->left = this->chunkSize;
+        padding = alignmentPadding(this->current, alignment);
+    }
+
+    char *result = this->current + padding;
+    this->current = result + size;
+    this->left -= padding + size;
+    return result;
+}
+
+std::string_view Arena::copyString(std::string_view str) {
+    if (str.empty()) {
+        return std::string_view();
+    }
+
+    char *data = (char *)this->allocate(str.size(), 1);
+    std::memcpy(data, str.data(), str.size());
+    return std::string_view(data, str.size());
+}
+
+unsigned long Arena::getChunkCount() {
+    return this->chunks.size();
+}
+
+void Arena::release() {
+    for (auto itr = this->chunks.cbegin(); itr != this->chunks.cend(); ++itr) {
+        delete[] (*itr);
+    }
+
+    this->chunks.clear();
+    this->current = nullptr;
+    this->left = 0;
+}
+
+Arena::~Arena() {
+    this->release();
+}
+
+}
@@ -0,0 +1,629 @@
+#include <remac/astformat.hpp>
+
+#include <remac/arena.hpp>
+#include <remac/parser.hpp>
+#include <remac/symbols.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+namespace {
+
+const char MAGIC[4] = { 'R', 'M', 'A', 'C' };
+// Tag and the longest payload
+const unsigned long MAX_HEAD_LENGTH = 1 + sizeof(std::uint64_t);
+
+template<typename T>
+void pushOperands(AstNode *node, std::vector<AstNode *> *pending) {
+    pending->push_back(static_cast<T *>(node)->getRight());
+    pending->push_back(static_cast<T *>(node)->getLeft());
+}
+
+void writePayload(char *bytes, std::uint32_t payload) {
+    if (bytes != nullptr) {
+        AstFormat::writeU32(bytes + 1, payload);
+    }
+}
+
+/**
+ * Writes tag and payload of node, unless `bytes` is nullptr, and returns
+    their length. Children of node are pushed to `pending` in reverse, so
+    they are popped in order of fields. Each node is visited by one switch,
+    so it's measured and written with one virtual call.
+ */
+unsigned long visitNode(AstNode *node, char *bytes, std::vector<AstNode *> *pending) {
+    AstNode::NodeType type = node != nullptr ? node->getType() : AstNode::NodeType::NODE_EMPTY;
+
+    if (bytes != nullptr) {
+        bytes[0] = type;
+    }
+
+    switch (type) {
+        case AstNode::NodeType::NODE_SEQUENCE: {
+            SequenceNode *sequence = static_cast<SequenceNode *>(node);
+            writePayload(bytes, sequence->getCount());
+
+            for (unsigned long i = sequence->getCount(); i > 0; i--) {
+                pending->push_back(sequence->getNode(i - 1));
+            }
+
+            return 1 + sizeof(std::uint32_t);
+        }
+        case AstNode::NodeType::NODE_PROGRAM:
+            pending->push_back(static_cast<ProgramNode *>(node)->getBody());
+            return 1;
+        case AstNode::NodeType::NODE_FUNCTION_CALL:
+            writePayload(bytes, static_cast<FunctionCallNode *>(node)->getSymbol());
+            pending->push_back(static_cast<FunctionCallNode *>(node)->getArgs());
+            return 1 + sizeof(std::uint32_t);
+        case AstNode::NodeType::NODE_IF_STATEMENT: {
+            IfStatementNode *statement = static_cast<IfStatementNode *>(node);
+            pending->push_back(statement->getElseBody());
+            pending->push_back(statement->getBody());
+            pending->push_back(statement->getCondition());
+            return 1;
+        }
+        case AstNode::NodeType::NODE_WHILE_STATEMENT: {
+            WhileStatementNode *statement = static_cast<WhileStatementNode *>(node);
+            pending->push_back(statement->getBody());
+            pending->push_back(statement->getCondition());
+            return 1;
+        }
+        case AstNode::NodeType::NODE_FOR_STATEMENT: {
+            ForStatementNode *statement = static_cast<ForStatementNode *>(node);
+            pending->push_back(statement->getBody());
+            pending->push_back(statement->getIncrementBody());
+            pending->push_back(statement->getCondition());
+            pending->push_back(statement->getInitializationBody());
+            return 1;
+        }
+        case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT:
+            writePayload(bytes, static_cast<VariableAssignmentNode *>(node)->getSymbol());
+            pending->push_back(static_cast<VariableAssignmentNode *>(node)->getValue());
+            return 1 + sizeof(std::uint32_t);
+        case AstNode::NodeType::NODE_OPERATION_ADD:
+            pushOperands<OperationAddNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+            pushOperands<OperationSubtractNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+            pushOperands<OperationMultiplyNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+            pushOperands<OperationDivideNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_MOD:
+            pushOperands<OperationModNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_EQUAL:
+            pushOperands<OperationEqualNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+            pushOperands<OperationNotEqualNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_LESS:
+            pushOperands<OperationLessNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+            pushOperands<OperationLessEqualNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_GREATER:
+            pushOperands<OperationGreaterNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+            pushOperands<OperationGreaterEqualNode>(node, pending);
+            return 1;
+        case AstNode::NodeType::NODE_OPERATION_NEGATE:
+            pending->push_back(static_cast<OperationNegateNode *>(node)->getValue());
+            return 1;
+        case AstNode::NodeType::NODE_LIST_DEFINITION:
+            pending->push_back(static_cast<ListDefinitionNode *>(node)->getArray());
+            return 1;
+        case AstNode::NodeType::NODE_LIST_SLICE:
+            pending->push_back(static_cast<ListSliceNode *>(node)->getValue());
+            pending->push_back(static_cast<ListSliceNode *>(node)->getArray());
+            return 1;
+        case AstNode::NodeType::NODE_INT_CONSTANT:
+            if (bytes != nullptr) {
+                AstFormat::writeU64(bytes + 1, static_cast<IntConstantNode *>(node)->getValue());
+            }
+
+            return 1 + sizeof(std::uint64_t);
+        case AstNode::NodeType::NODE_FLOAT_CONSTANT:
+            if (bytes != nullptr) {
+                double value = static_cast<FloatConstantNode *>(node)->getValue();
+                std::uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                AstFormat::writeU64(bytes + 1, bits);
+            }
+
+            return 1 + sizeof(std::uint64_t);
+        case AstNode::NodeType::NODE_STRING_CONSTANT:
+            writePayload(bytes, static_cast<StringConstantNode *>(node)->getSymbol());
+            return 1 + sizeof(std::uint32_t);
+        case AstNode::NodeType::NODE_VARIABLE_REFERENCE:
+            writePayload(bytes, static_cast<VariableReferenceNode *>(node)->getSymbol());
+            return 1 + sizeof(std::uint32_t);
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Reads nodes in pre-order with own stack, so depth of tree is limited only
+    by memory. Node is built by one switch on its tag, when all its children
+    are read, so bytes are read once, and nodes are never changed after
+    construction.
+ */
+class AstReader {
+private:
+    /**
+     * Node, whose children are being read.
+     */
+    struct Frame {
+        AstNode::NodeType tag;
+        // Name of node, or count of children of sequence
+        std::uint32_t payload;
+        // Children, which are still to be read
+        unsigned long remaining;
+        // Start of children of node in values
+        unsigned long start;
+    };
+
+    // Stacks are reserved for this depth, which most programs don't exceed
+    static const unsigned long INITIAL_DEPTH = 256;
+
+    std::string_view bytes;
+    unsigned long offset = 0;
+    const SymbolTable *symbols;
+    // Symbol in `symbols` of each name of file
+    std::vector<Symbol> names;
+    Arena *arena;
+    std::vector<Frame> frames;
+    // Children of nodes in frames, which are read already
+    std::vector<AstNode *> values;
+
+public:
+    AstReader(std::string_view bytes, Arena *arena) : bytes(bytes), symbols(nullptr), arena(arena) {}
+
+    void readHeader(SymbolTable *symbols) {
+        this->need(AstFormat::HEADER_SIZE);
+
+        if (std::memcmp(this->bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            throw new AstFormatException("Not an AST", 0);
+        }
+
+        std::uint16_t version = (std::uint8_t)this->bytes[4] | (std::uint8_t)this->bytes[5] << 8;
+
+        if (version != AstFormat::VERSION) {
+            throw new AstFormatException("Unsupported version of AST: " + std::to_string(version), 4);
+        }
+
+        std::uint16_t flags = (std::uint8_t)this->bytes[6] | (std::uint8_t)this->bytes[7] << 8;
+
+        // No flags are defined yet, so any set flag means unknown extension
+        if (flags != 0) {
+            throw new AstFormatException("Unsupported flags of AST: " + std::to_string(flags), 6);
+        }
+
+        std::uint32_t count = AstFormat::readU32(this->bytes.data() + 8);
+        this->offset = AstFormat::HEADER_SIZE;
+        this->symbols = symbols;
+        // Each name takes at least its length
+        this->need((unsigned long)count * sizeof(std::uint32_t));
+        this->names.reserve(count);
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::uint32_t length = this->readU32();
+            this->need(length);
+            this->names.push_back(symbols->intern(this->bytes.substr(this->offset, length)));
+            this->offset += length;
+        }
+    }
+
+    ProgramNode *readProgram() {
+        if (this->readTag() != AstNode::NodeType::NODE_PROGRAM) {
+            throw new AstFormatException("Expected program", this->offset - 1);
+        }
+
+        this->frames.reserve(AstReader::INITIAL_DEPTH);
+        this->values.reserve(AstReader::INITIAL_DEPTH);
+        // Node, whose children are read, is kept out of frames, so the hot loop works on locals
+        Frame top = { .tag = AstNode::NodeType::NODE_PROGRAM, .payload = 0, .remaining = 1, .start = 0 };
+
+        while (top.remaining > 0 || !this->frames.empty()) {
+            if (top.remaining > 0) {
+                this->readChild(&top);
+                continue;
+            }
+
+            // Node is built, when its last child is read
+            AstNode *node = this->build(top);
+            top = this->frames.back();
+            this->frames.pop_back();
+            this->values.push_back(node);
+            top.remaining--;
+        }
+
+        if (this->offset != this->bytes.size()) {
+            throw new AstFormatException("Unexpected bytes after program", this->offset);
+        }
+
+        return new ProgramNode(static_cast<SequenceNode *>(this->values[0]), this->arena);
+    }
+
+private:
+    /**
+     * Reads the next child of `top`. Leaf is added to values, node with
+        children becomes the new top, and the old one is pushed to frames.
+     */
+    void readChild(Frame *top) {
+        AstNode::NodeType tag = this->readTag();
+
+        if (tag != AstNode::NodeType::NODE_SEQUENCE) {
+            this->checkField(*top, tag);
+        }
+
+        switch (tag) {
+            case AstNode::NodeType::NODE_EMPTY:
+                this->addValue(top, nullptr);
+                break;
+            case AstNode::NodeType::NODE_INT_CONSTANT:
+                this->addValue(top, this->arena->make<IntConstantNode>((long long)this->readU64()));
+                break;
+            case AstNode::NodeType::NODE_FLOAT_CONSTANT: {
+                std::uint64_t bits = this->readU64();
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                this->addValue(top, this->arena->make<FloatConstantNode>(value));
+                break;
+            }
+            case AstNode::NodeType::NODE_STRING_CONSTANT:
+                this->addValue(top, this->arena->make<StringConstantNode>(this->symbols, this->readName()));
+                break;
+            case AstNode::NodeType::NODE_VARIABLE_REFERENCE:
+                this->addValue(top, this->arena->make<VariableReferenceNode>(this->symbols, this->readName()));
+                break;
+            case AstNode::NodeType::NODE_SEQUENCE: {
+                std::uint32_t count = this->readU32();
+                // Each node takes at least its tag, so wrong count can't allocate much
+                this->need(count);
+                this->pushFrame(top, tag, count, count);
+                break;
+            }
+            case AstNode::NodeType::NODE_FUNCTION_CALL:
+            case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT:
+                this->pushFrame(top, tag, this->readName(), 1);
+                break;
+            case AstNode::NodeType::NODE_IF_STATEMENT:
+                this->pushFrame(top, tag, 0, 3);
+                break;
+            case AstNode::NodeType::NODE_FOR_STATEMENT:
+                this->pushFrame(top, tag, 0, 4);
+                break;
+            case AstNode::NodeType::NODE_WHILE_STATEMENT:
+            case AstNode::NodeType::NODE_OPERATION_ADD:
+            case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+            case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+            case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+            case AstNode::NodeType::NODE_OPERATION_MOD:
+            case AstNode::NodeType::NODE_OPERATION_EQUAL:
+            case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+            case AstNode::NodeType::NODE_OPERATION_LESS:
+            case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+            case AstNode::NodeType::NODE_OPERATION_GREATER:
+            case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+            case AstNode::NodeType::NODE_LIST_SLICE:
+                this->pushFrame(top, tag, 0, 2);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_NEGATE:
+            case AstNode::NodeType::NODE_LIST_DEFINITION:
+                this->pushFrame(top, tag, 0, 1);
+                break;
+            default:
+                throw new AstFormatException("Unexpected node tag " + std::to_string(tag), this->offset - 1);
+        }
+    }
+
+    /**
+     * Builds node of frame from its children, which are the top of values,
+        and removes them.
+     */
+    AstNode *build(const Frame &frame) {
+        AstNode **children = this->values.data() + frame.start;
+        AstNode *node = nullptr;
+
+        switch (frame.tag) {
+            case AstNode::NodeType::NODE_SEQUENCE: {
+                AstNode **nodes = (AstNode **)this->arena->allocate(frame.payload * sizeof(AstNode *), alignof(AstNode *));
+                std::copy(children, children + frame.payload, nodes);
+                node = this->arena->make<SequenceNode>(nodes, frame.payload);
+                break;
+            }
+            case AstNode::NodeType::NODE_FUNCTION_CALL:
+                node = this->arena->make<FunctionCallNode>(this->symbols, frame.payload, static_cast<SequenceNode *>(children[0]));
+                break;
+            case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT:
+                node = this->arena->make<VariableAssignmentNode>(this->symbols, frame.payload, children[0]);
+                break;
+            case AstNode::NodeType::NODE_IF_STATEMENT:
+                node = this->arena->make<IfStatementNode>(
+                    children[0], static_cast<SequenceNode *>(children[1]), static_cast<SequenceNode *>(children[2])
+                );
+                break;
+            case AstNode::NodeType::NODE_WHILE_STATEMENT:
+                node = this->arena->make<WhileStatementNode>(children[0], static_cast<SequenceNode *>(children[1]));
+                break;
+            case AstNode::NodeType::NODE_FOR_STATEMENT:
+                node = this->arena->make<ForStatementNode>(
+                    static_cast<SequenceNode *>(children[0]), children[1],
+                    static_cast<SequenceNode *>(children[2]), static_cast<SequenceNode *>(children[3])
+                );
+                break;
+            case AstNode::NodeType::NODE_OPERATION_ADD:
+                node = this->arena->make<OperationAddNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+                node = this->arena->make<OperationSubtractNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+                node = this->arena->make<OperationMultiplyNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+                node = this->arena->make<OperationDivideNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_MOD:
+                node = this->arena->make<OperationModNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_EQUAL:
+                node = this->arena->make<OperationEqualNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+                node = this->arena->make<OperationNotEqualNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_LESS:
+                node = this->arena->make<OperationLessNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+                node = this->arena->make<OperationLessEqualNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_GREATER:
+                node = this->arena->make<OperationGreaterNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+                node = this->arena->make<OperationGreaterEqualNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_LIST_SLICE:
+                node = this->arena->make<ListSliceNode>(children[0], children[1]);
+                break;
+            case AstNode::NodeType::NODE_OPERATION_NEGATE:
+                node = this->arena->make<OperationNegateNode>(children[0]);
+                break;
+            case AstNode::NodeType::NODE_LIST_DEFINITION:
+                node = this->arena->make<ListDefinitionNode>(static_cast<SequenceNode *>(children[0]));
+                break;
+            default:
+                break;
+        }
+
+        this->values.resize(frame.start);
+        return node;
+    }
+
+    /**
+     * Checks, that node with `tag`, which isn't sequence, may be the next
+        child of `parent`.
+     */
+    void checkField(const Frame &parent, AstNode::NodeType tag) {
+        if (parent.tag == AstNode::NodeType::NODE_PROGRAM && tag == AstNode::NodeType::NODE_EMPTY) {
+            throw new AstFormatException("Expected body of program", this->offset - 1);
+        }
+
+        if (tag != AstNode::NodeType::NODE_EMPTY && AstReader::isSequenceField(parent.tag, this->values.size() - parent.start)) {
+            throw new AstFormatException("Expected sequence", this->offset - 1);
+        }
+    }
+
+    /**
+     * Tells, if field of node at `position` is sequence, or missing.
+     */
+    static bool isSequenceField(AstNode::NodeType tag, unsigned long position) {
+        switch (tag) {
+            case AstNode::NodeType::NODE_PROGRAM:
+            case AstNode::NodeType::NODE_FUNCTION_CALL:
+            case AstNode::NodeType::NODE_LIST_DEFINITION:
+                return true;
+            case AstNode::NodeType::NODE_IF_STATEMENT:
+                return position != 0;
+            case AstNode::NodeType::NODE_FOR_STATEMENT:
+                return position != 1;
+            case AstNode::NodeType::NODE_WHILE_STATEMENT:
+                return position == 1;
+            default:
+                return false;
+        }
+    }
+
+    void pushFrame(Frame *top, AstNode::NodeType tag, std::uint32_t payload, unsigned long count) {
+        this->frames.push_back(*top);
+        *top = Frame { .tag = tag, .payload = payload, .remaining = count, .start = this->values.size() };
+    }
+
+    /**
+     * Adds node as the next child of `top`.
+     */
+    void addValue(Frame *top, AstNode *node) {
+        this->values.push_back(node);
+        top->remaining--;
+    }
+
+    Symbol readName() {
+        std::uint32_t name = this->readU32();
+
+        if (name >= this->names.size()) {
+            throw new AstFormatException("Unknown name " + std::to_string(name), this->offset - sizeof(std::uint32_t));
+        }
+
+        return this->names[name];
+    }
+
+    AstNode::NodeType readTag() {
+        this->need(1);
+        return (AstNode::NodeType)(std::uint8_t)this->bytes[this->offset++];
+    }
+
+    std::uint32_t readU32() {
+        this->need(sizeof(std::uint32_t));
+        std::uint32_t value = AstFormat::readU32(this->bytes.data() + this->offset);
+        this->offset += sizeof(std::uint32_t);
+        return value;
+    }
+
+    std::uint64_t readU64() {
+        this->need(sizeof(std::uint64_t));
+        std::uint64_t value = AstFormat::readU64(this->bytes.data() + this->offset);
+        this->offset += sizeof(std::uint64_t);
+        return value;
+    }
+
+    void need(unsigned long length) {
+        if (this->bytes.size() - this->offset < length) {
+            throw new AstFormatException("Unexpected end of AST", this->offset);
+        }
+    }
+};
+
+}
+
+std::string AstFormat::save(ProgramNode *program, const SymbolTable *symbols) {
+    unsigned long length = AstFormat::HEADER_SIZE;
+
+    for (Symbol symbol = 0; symbol < symbols->size(); symbol++) {
+        length += sizeof(std::uint32_t) + symbols->getName(symbol).size();
+    }
+
+    std::string bytes(length, '\0');
+    char *ptr = bytes.data();
+    std::memcpy(ptr, MAGIC, sizeof(MAGIC));
+    ptr[4] = AstFormat::VERSION & 0xFF;
+    ptr[5] = AstFormat::VERSION >> 8;
+    AstFormat::writeU32(ptr + 8, symbols->size());
+    ptr += AstFormat::HEADER_SIZE;
+
+    for (Symbol symbol = 0; symbol < symbols->size(); symbol++) {
+        std::string_view name = symbols->getName(symbol);
+        AstFormat::writeU32(ptr, name.size());
+        std::memcpy(ptr + sizeof(std::uint32_t), name.data(), name.size());
+        ptr += sizeof(std::uint32_t) + name.size();
+    }
+
+    // Tree is written in one walk, unlike toBytes(), which measures it first
+    std::vector<AstNode *> pending = { program };
+    unsigned long offset = length;
+
+    while (!pending.empty()) {
+        if (bytes.size() - offset < MAX_HEAD_LENGTH) {
+            bytes.resize(bytes.size() * 2 + MAX_HEAD_LENGTH);
+        }
+
+        AstNode *next = pending.back();
+        pending.pop_back();
+        offset += visitNode(next, bytes.data() + offset, &pending);
+    }
+
+    bytes.resize(offset);
+    return bytes;
+}
+
+ProgramNode *AstFormat::load(std::string_view bytes, SymbolTable *symbols) {
+    Arena *arena = new Arena(AstFormat::NODE_CHUNK_SIZE);
+
+    try {
+        AstReader reader(bytes, arena);
+        reader.readHeader(symbols);
+        return reader.readProgram();
+    } catch (...) {
+        // Nodes of unfinished program are freed with arena
+        delete arena;
+        throw;
+    }
+}
+
+unsigned long AstFormat::getNodeLength(AstNode *node) {
+    std::vector<AstNode *> pending = { node };
+    unsigned long length = 0;
+
+    while (!pending.empty()) {
+        AstNode *next = pending.back();
+        pending.pop_back();
+        length += visitNode(next, nullptr, &pending);
+    }
+
+    return length;
+}
+
+unsigned long AstFormat::writeNode(AstNode *node, void *buffer) {
+    char *bytes = (char *)buffer;
+    std::vector<AstNode *> pending = { node };
+    unsigned long offset = 0;
+
+    while (!pending.empty()) {
+        AstNode *next = pending.back();
+        pending.pop_back();
+        offset += visitNode(next, bytes + offset, &pending);
+    }
+
+    return offset;
+}
+
+void AstFormat::writeU32(void *buffer, std::uint32_t value) {
+    unsigned char *bytes = (unsigned char *)buffer;
+
+    for (unsigned long i = 0; i < sizeof(value); i++) {
+        bytes[i] = value >> (8 * i);
+    }
+}
+
+void AstFormat::writeU64(void *buffer, std::uint64_t value) {
+    unsigned char *bytes = (unsigned char *)buffer;
+
+    for (unsigned long i = 0; i < sizeof(value); i++) {
+        bytes[i] = value >> (8 * i);
+    }
+}
+
+std::uint32_t AstFormat::readU32(const void *buffer) {
+    const unsigned char *bytes = (const unsigned char *)buffer;
+    std::uint32_t value = 0;
+
+    for (unsigned long i = 0; i < sizeof(value); i++) {
+        value |= (std::uint32_t)bytes[i] << (8 * i);
+    }
+
+    return value;
+}
+
+std::uint64_t AstFormat::readU64(const void *buffer) {
+    const unsigned char *bytes = (const unsigned char *)buffer;
+    std::uint64_t value = 0;
+
+    for (unsigned long i = 0; i < sizeof(value); i++) {
+        value |= (std::uint64_t)bytes[i] << (8 * i);
+    }
+
+    return value;
+}
+
+AstFormatException::AstFormatException(std::string message, unsigned long offset) {
+    this->message = message;
+    this->offset = offset;
+}
+
+}
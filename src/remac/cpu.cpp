@@ -0,0 +1,43 @@
+#include <remac/cpu.hpp>
+
+namespace remac {
+
+SimdLevel detectSimdLevel() {
+#ifdef REMAC_X86_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::SIMD_AVX2;
+    }
+
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SIMD_SSE4;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SIMD_SSE2;
+    }
+#endif
+
+    return SimdLevel::SIMD_SCALAR;
+}
+
+SimdLevel currentSimdLevel = detectSimdLevel();
+
+void setSimdLevel(SimdLevel level) {
+    SimdLevel detected = detectSimdLevel();
+    currentSimdLevel = level > detected ? detected : level;
+}
+
+const char *simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SIMD_SCALAR: return "scalar";
+        case SimdLevel::SIMD_SSE2: return "SSE2";
+        case SimdLevel::SIMD_SSE4: return "SSE4";
+        case SimdLevel::SIMD_AVX2: return "AVX2";
+    }
+
+    return "unknown";
+}
+
+}
@@ -0,0 +1,337 @@
+#include <remac/flatast.hpp>
+
+#include <remac/arena.hpp>
+#include <remac/parser.hpp>
+#include <remac/symbols.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+const FlatAst::Index FlatAst::NO_NODE;
+
+FlatAst::FlatAst(SymbolTable *symbols, ProgramNode *program) : symbols(symbols) {
+    // Chains of operators are as deep as they are long, so tree is walked with own stack
+    std::vector<Pending> pending;
+    pending.push_back(Pending { .node = program, .target = nullptr, .position = 0 });
+
+    while (!pending.empty()) {
+        Pending item = pending.back();
+        pending.pop_back();
+
+        if (item.node == nullptr) {
+            continue;
+        }
+
+        Index index = this->addNode(item.node, &pending);
+
+        if (item.target != nullptr) {
+            (*item.target)[item.position] = index;
+        }
+    }
+}
+
+unsigned long FlatAst::size() const {
+    return this->kinds.size();
+}
+
+const std::vector<std::uint8_t> &FlatAst::getKinds() const {
+    return this->kinds;
+}
+
+AstNode::NodeType FlatAst::getKind(Index node) const {
+    return (AstNode::NodeType)this->kinds[node];
+}
+
+unsigned long FlatAst::getChildCount(Index node) const {
+    switch (this->getKind(node)) {
+        case AstNode::NodeType::NODE_SEQUENCE:
+            return this->seconds[node];
+        case AstNode::NodeType::NODE_IF_STATEMENT:
+            return 3;
+        case AstNode::NodeType::NODE_FOR_STATEMENT:
+            return 4;
+        case AstNode::NodeType::NODE_PROGRAM:
+        case AstNode::NodeType::NODE_LIST_DEFINITION:
+        case AstNode::NodeType::NODE_OPERATION_NEGATE:
+        case AstNode::NodeType::NODE_FUNCTION_CALL:
+        case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT:
+            return 1;
+        case AstNode::NodeType::NODE_WHILE_STATEMENT:
+        case AstNode::NodeType::NODE_OPERATION_ADD:
+        case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+        case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+        case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+        case AstNode::NodeType::NODE_OPERATION_MOD:
+        case AstNode::NodeType::NODE_OPERATION_EQUAL:
+        case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+        case AstNode::NodeType::NODE_OPERATION_LESS:
+        case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+        case AstNode::NodeType::NODE_OPERATION_GREATER:
+        case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+        case AstNode::NodeType::NODE_LIST_SLICE:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+FlatAst::Index FlatAst::getChild(Index node, unsigned long index) const {
+    switch (this->getKind(node)) {
+        case AstNode::NodeType::NODE_SEQUENCE:
+        case AstNode::NodeType::NODE_IF_STATEMENT:
+        case AstNode::NodeType::NODE_FOR_STATEMENT:
+            return this->lists[this->firsts[node] + index];
+        case AstNode::NodeType::NODE_FUNCTION_CALL:
+        case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT:
+            return this->seconds[node];
+        default:
+            return index == 0 ? this->firsts[node] : this->seconds[node];
+    }
+}
+
+Symbol FlatAst::getSymbol(Index node) const {
+    return this->firsts[node];
+}
+
+std::string_view FlatAst::getName(Index node) const {
+    return this->symbols->getName(this->firsts[node]);
+}
+
+long long FlatAst::getInt(Index node) const {
+    return this->ints[this->firsts[node]];
+}
+
+double FlatAst::getFloat(Index node) const {
+    return this->floats[this->firsts[node]];
+}
+
+SymbolTable *FlatAst::getSymbols() const {
+    return this->symbols;
+}
+
+ProgramNode *FlatAst::toTree() const {
+    Arena *arena = new Arena(FlatAst::NODE_CHUNK_SIZE);
+    std::vector<AstNode *> built(this->size(), nullptr);
+
+    // Children follow their parent, so nodes, built from the last one, find their children built
+    for (Index node = this->size() - 1; node > 0; node--) {
+        built[node] = this->build(node, arena, built);
+    }
+
+    return new ProgramNode(static_cast<SequenceNode *>(built[this->firsts[0]]), arena);
+}
+
+FlatAst::Index FlatAst::add(AstNode::NodeType kind, Index first, Index second) {
+    this->kinds.push_back(kind);
+    this->firsts.push_back(first);
+    this->seconds.push_back(second);
+    return this->kinds.size() - 1;
+}
+
+/**
+ * Start of `count` children in lists. They are reserved before children are
+    added, because children add their own lists.
+ */
+FlatAst::Index FlatAst::reserveList(unsigned long count) {
+    Index start = this->lists.size();
+    this->lists.resize(start + count, FlatAst::NO_NODE);
+    return start;
+}
+
+/**
+ * Adds node with its payload. Its children are pushed to `pending` in reverse,
+    so they are added right after it in pre-order, and their indexes are
+    written to operands of node, when they are added.
+ */
+FlatAst::Index FlatAst::addNode(AstNode *node, std::vector<Pending> *pending) {
+    AstNode::NodeType kind = node->getType();
+
+    switch (kind) {
+        case AstNode::NodeType::NODE_SEQUENCE: {
+            SequenceNode *sequence = static_cast<SequenceNode *>(node);
+            unsigned long count = sequence->getCount();
+            Index start = this->reserveList(count);
+
+            for (unsigned long i = count; i > 0; i--) {
+                pending->push_back(Pending { .node = sequence->getNode(i - 1), .target = &this->lists, .position = (Index)(start + i - 1) });
+            }
+
+            return this->add(kind, start, count);
+        }
+        case AstNode::NodeType::NODE_PROGRAM:
+            return this->addChildren(kind, static_cast<ProgramNode *>(node)->getBody(), nullptr, pending);
+        case AstNode::NodeType::NODE_LIST_DEFINITION:
+            return this->addChildren(kind, static_cast<ListDefinitionNode *>(node)->getArray(), nullptr, pending);
+        case AstNode::NodeType::NODE_FUNCTION_CALL: {
+            FunctionCallNode *call = static_cast<FunctionCallNode *>(node);
+            Index index = this->add(kind, call->getSymbol(), FlatAst::NO_NODE);
+            pending->push_back(Pending { .node = call->getArgs(), .target = &this->seconds, .position = index });
+            return index;
+        }
+        case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT: {
+            VariableAssignmentNode *assignment = static_cast<VariableAssignmentNode *>(node);
+            Index index = this->add(kind, assignment->getSymbol(), FlatAst::NO_NODE);
+            pending->push_back(Pending { .node = assignment->getValue(), .target = &this->seconds, .position = index });
+            return index;
+        }
+        case AstNode::NodeType::NODE_IF_STATEMENT: {
+            IfStatementNode *statement = static_cast<IfStatementNode *>(node);
+            Index start = this->reserveList(3);
+            pending->push_back(Pending { .node = statement->getElseBody(), .target = &this->lists, .position = start + 2 });
+            pending->push_back(Pending { .node = statement->getBody(), .target = &this->lists, .position = start + 1 });
+            pending->push_back(Pending { .node = statement->getCondition(), .target = &this->lists, .position = start });
+            return this->add(kind, start, FlatAst::NO_NODE);
+        }
+        case AstNode::NodeType::NODE_WHILE_STATEMENT: {
+            WhileStatementNode *statement = static_cast<WhileStatementNode *>(node);
+            return this->addChildren(kind, statement->getCondition(), statement->getBody(), pending);
+        }
+        case AstNode::NodeType::NODE_FOR_STATEMENT: {
+            ForStatementNode *statement = static_cast<ForStatementNode *>(node);
+            Index start = this->reserveList(4);
+            pending->push_back(Pending { .node = statement->getBody(), .target = &this->lists, .position = start + 3 });
+            pending->push_back(Pending { .node = statement->getIncrementBody(), .target = &this->lists, .position = start + 2 });
+            pending->push_back(Pending { .node = statement->getCondition(), .target = &this->lists, .position = start + 1 });
+            pending->push_back(Pending { .node = statement->getInitializationBody(), .target = &this->lists, .position = start });
+            return this->add(kind, start, FlatAst::NO_NODE);
+        }
+        case AstNode::NodeType::NODE_OPERATION_ADD:
+            return this->addChildren(kind, static_cast<OperationAddNode *>(node)->getLeft(), static_cast<OperationAddNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+            return this->addChildren(kind, static_cast<OperationSubtractNode *>(node)->getLeft(), static_cast<OperationSubtractNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+            return this->addChildren(kind, static_cast<OperationMultiplyNode *>(node)->getLeft(), static_cast<OperationMultiplyNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+            return this->addChildren(kind, static_cast<OperationDivideNode *>(node)->getLeft(), static_cast<OperationDivideNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_MOD:
+            return this->addChildren(kind, static_cast<OperationModNode *>(node)->getLeft(), static_cast<OperationModNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_EQUAL:
+            return this->addChildren(kind, static_cast<OperationEqualNode *>(node)->getLeft(), static_cast<OperationEqualNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+            return this->addChildren(kind, static_cast<OperationNotEqualNode *>(node)->getLeft(), static_cast<OperationNotEqualNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_LESS:
+            return this->addChildren(kind, static_cast<OperationLessNode *>(node)->getLeft(), static_cast<OperationLessNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+            return this->addChildren(kind, static_cast<OperationLessEqualNode *>(node)->getLeft(), static_cast<OperationLessEqualNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_GREATER:
+            return this->addChildren(kind, static_cast<OperationGreaterNode *>(node)->getLeft(), static_cast<OperationGreaterNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+            return this->addChildren(kind, static_cast<OperationGreaterEqualNode *>(node)->getLeft(), static_cast<OperationGreaterEqualNode *>(node)->getRight(), pending);
+        case AstNode::NodeType::NODE_OPERATION_NEGATE:
+            return this->addChildren(kind, static_cast<OperationNegateNode *>(node)->getValue(), nullptr, pending);
+        case AstNode::NodeType::NODE_LIST_SLICE:
+            return this->addChildren(kind, static_cast<ListSliceNode *>(node)->getArray(), static_cast<ListSliceNode *>(node)->getValue(), pending);
+        case AstNode::NodeType::NODE_INT_CONSTANT:
+            this->ints.push_back(static_cast<IntConstantNode *>(node)->getValue());
+            return this->add(kind, this->ints.size() - 1, FlatAst::NO_NODE);
+        case AstNode::NodeType::NODE_FLOAT_CONSTANT:
+            this->floats.push_back(static_cast<FloatConstantNode *>(node)->getValue());
+            return this->add(kind, this->floats.size() - 1, FlatAst::NO_NODE);
+        case AstNode::NodeType::NODE_STRING_CONSTANT:
+            return this->add(kind, static_cast<StringConstantNode *>(node)->getSymbol(), FlatAst::NO_NODE);
+        case AstNode::NodeType::NODE_VARIABLE_REFERENCE:
+            return this->add(kind, static_cast<VariableReferenceNode *>(node)->getSymbol(), FlatAst::NO_NODE);
+        default:
+            return this->add(kind, FlatAst::NO_NODE, FlatAst::NO_NODE);
+    }
+}
+
+/**
+ * Adds node, whose children, if any, are its first and second operands.
+ */
+FlatAst::Index FlatAst::addChildren(AstNode::NodeType kind, AstNode *first, AstNode *second, std::vector<Pending> *pending) {
+    Index index = this->add(kind, FlatAst::NO_NODE, FlatAst::NO_NODE);
+    pending->push_back(Pending { .node = second, .target = &this->seconds, .position = index });
+    pending->push_back(Pending { .node = first, .target = &this->firsts, .position = index });
+    return index;
+}
+
+/**
+ * Builds node, whose children are already built.
+ */
+AstNode *FlatAst::build(Index node, Arena *arena, const std::vector<AstNode *> &built) const {
+    Index first = this->firsts[node];
+    Index second = this->seconds[node];
+
+    switch (this->getKind(node)) {
+        case AstNode::NodeType::NODE_SEQUENCE: {
+            AstNode **array = (AstNode **)arena->allocate(second * sizeof(AstNode *), alignof(AstNode *));
+
+            for (unsigned long i = 0; i < second; i++) {
+                array[i] = FlatAst::getBuilt(built, this->lists[first + i]);
+            }
+
+            return arena->make<SequenceNode>(array, second);
+        }
+        case AstNode::NodeType::NODE_LIST_DEFINITION:
+            return arena->make<ListDefinitionNode>(FlatAst::getBuiltSequence(built, first));
+        case AstNode::NodeType::NODE_FUNCTION_CALL:
+            return arena->make<FunctionCallNode>(this->symbols, first, FlatAst::getBuiltSequence(built, second));
+        case AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT:
+            return arena->make<VariableAssignmentNode>(this->symbols, first, FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_IF_STATEMENT:
+            return arena->make<IfStatementNode>(
+                FlatAst::getBuilt(built, this->lists[first]),
+                FlatAst::getBuiltSequence(built, this->lists[first + 1]),
+                FlatAst::getBuiltSequence(built, this->lists[first + 2])
+            );
+        case AstNode::NodeType::NODE_WHILE_STATEMENT:
+            return arena->make<WhileStatementNode>(FlatAst::getBuilt(built, first), FlatAst::getBuiltSequence(built, second));
+        case AstNode::NodeType::NODE_FOR_STATEMENT:
+            return arena->make<ForStatementNode>(
+                FlatAst::getBuiltSequence(built, this->lists[first]),
+                FlatAst::getBuilt(built, this->lists[first + 1]),
+                FlatAst::getBuiltSequence(built, this->lists[first + 2]),
+                FlatAst::getBuiltSequence(built, this->lists[first + 3])
+            );
+        case AstNode::NodeType::NODE_OPERATION_ADD:
+            return arena->make<OperationAddNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+            return arena->make<OperationSubtractNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+            return arena->make<OperationMultiplyNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+            return arena->make<OperationDivideNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_MOD:
+            return arena->make<OperationModNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_EQUAL:
+            return arena->make<OperationEqualNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+            return arena->make<OperationNotEqualNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_LESS:
+            return arena->make<OperationLessNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+            return arena->make<OperationLessEqualNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_GREATER:
+            return arena->make<OperationGreaterNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+            return arena->make<OperationGreaterEqualNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_OPERATION_NEGATE:
+            return arena->make<OperationNegateNode>(FlatAst::getBuilt(built, first));
+        case AstNode::NodeType::NODE_LIST_SLICE:
+            return arena->make<ListSliceNode>(FlatAst::getBuilt(built, first), FlatAst::getBuilt(built, second));
+        case AstNode::NodeType::NODE_INT_CONSTANT:
+            return arena->make<IntConstantNode>(this->ints[first]);
+        case AstNode::NodeType::NODE_FLOAT_CONSTANT:
+            return arena->make<FloatConstantNode>(this->floats[first]);
+        case AstNode::NodeType::NODE_STRING_CONSTANT:
+            return arena->make<StringConstantNode>(this->symbols, first);
+        case AstNode::NodeType::NODE_VARIABLE_REFERENCE:
+            return arena->make<VariableReferenceNode>(this->symbols, first);
+        default:
+            return nullptr;
+    }
+}
+
+AstNode *FlatAst::getBuilt(const std::vector<AstNode *> &built, Index node) {
+    return node != FlatAst::NO_NODE ? built[node] : nullptr;
+}
+
+SequenceNode *FlatAst::getBuiltSequence(const std::vector<AstNode *> &built, Index node) {
+    return static_cast<SequenceNode *>(FlatAst::getBuilt(built, node));
+}
+
+}
@@ -1,508 +1,1363 @@
 #include <remac/lexer.hpp>
 
+#include <remac/scan.hpp>
+#include <remac/tokens.hpp>
 #include <remac/utf8.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <clocale>
+#include <cstdint>
 #include <cstdio>
 #include <locale>
 #include <map>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <cstring>
-#include <stack>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <thread>
 #include <vector>
 
 namespace remac {
 
-Lexer::Lexer(std::string input) {
-    this->code = input;
-    this->index = 0;
-    this->type = PendingType::UNKNOWN;
-    this->line = 1;
-    this->column = 1;
-}
+namespace {
 
-std::optional<Token> Lexer::next() {
-    if (this->index >= this->code.size()) {
-        return {};
+const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const char DIGITS[] = "0123456789";
+const char IDENTIFIER_EXTRA_CHARS[] = "_";
+const char WHITESPACE_CHARS[] = "\n\t ";
+
+enum CharClass : unsigned char {
+    CHAR_NONE = 0,
+    CHAR_WHITESPACE = 1 << 0,
+    CHAR_DIGIT = 1 << 1,
+    CHAR_IDENTIFIER_START = 1 << 2,
+    CHAR_IDENTIFIER = 1 << 3,
+};
+
+/**
+ * Classes of all ASCII chars, indexed by first byte of UTF-8 char. Built at
+    compile time from the char sets above, so classifying a char is one load
+    instead of decoding whole char set with utfCharInString.
+ */
+struct CharClassTable {
+    unsigned char classes[256];
+
+    constexpr CharClassTable() : classes() {
+        for (unsigned long i = 0; i < sizeof(LETTERS) - 1; i++) {
+            this->classes[(unsigned char)LETTERS[i]] |= CHAR_IDENTIFIER_START | CHAR_IDENTIFIER;
+        }
+
+        for (unsigned long i = 0; i < sizeof(DIGITS) - 1; i++) {
+            this->classes[(unsigned char)DIGITS[i]] |= CHAR_DIGIT | CHAR_IDENTIFIER;
+        }
+
+        for (unsigned long i = 0; i < sizeof(IDENTIFIER_EXTRA_CHARS) - 1; i++) {
+            this->classes[(unsigned char)IDENTIFIER_EXTRA_CHARS[i]] |= CHAR_IDENTIFIER;
+        }
+
+        for (unsigned long i = 0; i < sizeof(WHITESPACE_CHARS) - 1; i++) {
+            this->classes[(unsigned char)WHITESPACE_CHARS[i]] |= CHAR_WHITESPACE;
+        }
     }
+};
 
-    this->skipWhitespaces();
+constexpr CharClassTable CHAR_CLASSES;
 
-    if (this->index >= this->code.size()) {
-        return {};
+static_assert(CHAR_CLASSES.classes[(unsigned char)'a'] == (CHAR_IDENTIFIER_START | CHAR_IDENTIFIER));
+static_assert(CHAR_CLASSES.classes[(unsigned char)'_'] == CHAR_IDENTIFIER);
+static_assert(CHAR_CLASSES.classes[(unsigned char)'7'] == (CHAR_DIGIT | CHAR_IDENTIFIER));
+static_assert(CHAR_CLASSES.classes[(unsigned char)' '] == CHAR_WHITESPACE);
+static_assert(CHAR_CLASSES.classes[0x80] == CHAR_NONE);
+
+/**
+ * Non-ASCII identifier chars: compact approximation of Unicode XID_Start and
+    XID_Continue for common scripts. Sorted by code point, so it's searched
+    binary and ASCII code never touches it.
+ */
+struct UnicodeRange {
+    char32_t first;
+    char32_t last;
+    unsigned char classes;
+};
+
+const unsigned char UNICODE_LETTER = CHAR_IDENTIFIER_START | CHAR_IDENTIFIER;
+const unsigned char UNICODE_MARK = CHAR_IDENTIFIER; // Combining marks and digits
+
+const UnicodeRange UNICODE_IDENTIFIER_RANGES[] = {
+    { 0x00AA, 0x00AA, UNICODE_LETTER }, { 0x00B5, 0x00B5, UNICODE_LETTER }, { 0x00BA, 0x00BA, UNICODE_LETTER },
+    { 0x00C0, 0x00D6, UNICODE_LETTER }, { 0x00D8, 0x00F6, UNICODE_LETTER }, { 0x00F8, 0x02AF, UNICODE_LETTER }, // Latin
+    { 0x0300, 0x036F, UNICODE_MARK },
+    { 0x0370, 0x0373, UNICODE_LETTER }, { 0x0376, 0x0377, UNICODE_LETTER }, { 0x037B, 0x037D, UNICODE_LETTER },
+    { 0x0386, 0x0386, UNICODE_LETTER }, { 0x0388, 0x03F5, UNICODE_LETTER }, { 0x03F7, 0x03FF, UNICODE_LETTER }, // Greek
+    { 0x0400, 0x0481, UNICODE_LETTER }, { 0x0483, 0x0487, UNICODE_MARK }, { 0x048A, 0x052F, UNICODE_LETTER }, // Cyrillic
+    { 0x0531, 0x0556, UNICODE_LETTER }, { 0x0561, 0x0587, UNICODE_LETTER }, // Armenian
+    { 0x05D0, 0x05EA, UNICODE_LETTER }, // Hebrew
+    { 0x0620, 0x064A, UNICODE_LETTER }, { 0x064B, 0x0669, UNICODE_MARK }, { 0x0671, 0x06D3, UNICODE_LETTER }, // Arabic
+    { 0x0904, 0x0939, UNICODE_LETTER }, { 0x093A, 0x094F, UNICODE_MARK }, { 0x0966, 0x096F, UNICODE_MARK }, // Devanagari
+    { 0x0E01, 0x0E30, UNICODE_LETTER }, // Thai
+    { 0x10A0, 0x10C5, UNICODE_LETTER }, { 0x10D0, 0x10FA, UNICODE_LETTER }, // Georgian
+    { 0x1E00, 0x1FBC, UNICODE_LETTER }, // Latin and Greek extended
+    { 0x3041, 0x3096, UNICODE_LETTER }, { 0x30A1, 0x30FA, UNICODE_LETTER }, // Hiragana, Katakana
+    { 0x3400, 0x4DBF, UNICODE_LETTER }, { 0x4E00, 0x9FFF, UNICODE_LETTER }, // CJK
+    { 0xAC00, 0xD7A3, UNICODE_LETTER }, // Hangul
+    { 0xF900, 0xFAFF, UNICODE_LETTER },
+    { 0x20000, 0x2A6DF, UNICODE_LETTER },
+};
+
+unsigned char classifyUnicode(char32_t chr) {
+    const UnicodeRange *begin = UNICODE_IDENTIFIER_RANGES;
+    const UnicodeRange *end = begin + sizeof(UNICODE_IDENTIFIER_RANGES) / sizeof(UNICODE_IDENTIFIER_RANGES[0]);
+    const UnicodeRange *range = std::upper_bound(begin, end, chr, [](char32_t codePoint, const UnicodeRange &range) {
+        return codePoint < range.first;
+    });
+
+    if (range == begin || (range - 1)->last < chr) {
+        return CHAR_NONE;
+    }
+
+    return (range - 1)->classes;
+}
+
+/**
+ * Perfect hash table of KEYWORDS, built at compile time. Hash of identifier
+    is computed from its length, first and last byte, so it costs no loop.
+    If new keyword collides with existing one, static_assert below fails, and
+    hash multiplier or table size must be changed.
+ */
+struct KeywordTable {
+    static const unsigned long SIZE = 16;
+
+    KeywordSpelling slots[SIZE];
+    unsigned long minLength;
+    unsigned long maxLength;
+    unsigned long collisions;
+
+    static constexpr unsigned long hash(const char *text, unsigned long length) {
+        return ((unsigned char)text[0] + (unsigned char)text[length - 1] * 3 + length) & (SIZE - 1);
     }
 
-    Utf8Char chr = this->peekChar();
-
-    // TODO: Remove this->type.
-
-    if (utfCharInString(
-        this->IDENTIFIER_CHARS_START.c_str(),
-        this->IDENTIFIER_CHARS_START.c_str() + \
-            this->IDENTIFIER_CHARS_START.size(),
-        chr
-    )) {
-        switch (this->prevType) {
-            case TokenType::PROGRAM_START:
-            case TokenType::KEYWORD:
-            case TokenType::LPAREN:
-            case TokenType::LBRACE:
-            case TokenType::LBRACKET:
-            case TokenType::OPERATOR:
-            case TokenType::RBRACE:
-            case TokenType::IDENTIFIER:
-            case TokenType::ARG_SEPARATOR: break;
-
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected identifier", .line = this->line, .column = this->column } };
+    constexpr KeywordTable() : slots(), minLength(~0UL), maxLength(0), collisions(0) {
+        for (const KeywordSpelling &spelling : KEYWORDS) {
+            KeywordSpelling &slot = this->slots[hash(spelling.text.data(), spelling.text.size())];
+
+            if (slot.keyword != Keyword::KEYWORD_NONE) {
+                this->collisions++;
             }
+
+            slot = spelling;
+            this->minLength = spelling.text.size() < this->minLength ? spelling.text.size() : this->minLength;
+            this->maxLength = spelling.text.size() > this->maxLength ? spelling.text.size() : this->maxLength;
+        }
+    }
+
+    Keyword find(std::string_view text) const {
+        if (text.size() < this->minLength || text.size() > this->maxLength) {
+            return Keyword::KEYWORD_NONE;
         }
 
-        Token ident = this->nextIdentifier();
+        const KeywordSpelling &slot = this->slots[hash(text.data(), text.size())];
+        return slot.text == text ? slot.keyword : Keyword::KEYWORD_NONE;
+    }
+};
+
+constexpr KeywordTable KEYWORD_TABLE;
+
+static_assert(KEYWORD_TABLE.collisions == 0, "Keywords collide in KeywordTable, change its hash");
+
+/**
+ * Longest-match table of OPERATORS, indexed by the first char. Each entry
+    holds operator of that single char and operators, which continue it with
+    second char, so operator is found with one load and few compares.
+ */
+struct OperatorTable {
+    static const unsigned long MAX_CONTINUATIONS = 2;
+
+    struct Continuation {
+        char second = '\0';
+        Operator oper = Operator::OPERATOR_NONE;
+    };
+
+    struct Entry {
+        Operator single = Operator::OPERATOR_NONE;
+        Continuation continuations[MAX_CONTINUATIONS] = {};
+    };
+
+    Entry entries[128];
+    unsigned long overflows;
+
+    constexpr OperatorTable() : entries(), overflows(0) {
+        for (const OperatorSpelling &spelling : OPERATORS) {
+            Entry &entry = this->entries[(unsigned char)spelling.text[0]];
+
+            if (spelling.text.size() == 1) {
+                entry.single = spelling.oper;
+                continue;
+            }
+
+            unsigned long i = 0;
 
-        if (this->prevType == TokenType::RBRACE) {
-            if (ident.content != "else") {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected identifier. May be you mean to use 'else'?", .line = this->line, .column = this->column } };
+            while (i < MAX_CONTINUATIONS && entry.continuations[i].oper != Operator::OPERATOR_NONE) {
+                i++;
             }
-        } else if (this->prevType == TokenType::IDENTIFIER) {
-            if (ident.content != "if") {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected identifier. May be you mean to use 'else if'?", .line = line, .column = column } };
+
+            if (i == MAX_CONTINUATIONS || spelling.text.size() != 2) {
+                this->overflows++;
+                continue;
             }
-        }
 
-        this->prevType = TokenType::IDENTIFIER;
-        return { ident };
+            entry.continuations[i] = Continuation { .second = spelling.text[1], .oper = spelling.oper };
+        }
     }
 
-    if (utfCharInString(
-        this->DIGITS.c_str(),
-        this->DIGITS.c_str() + this->DIGITS.size(),
-        chr
-    )) {
-        switch (this->prevType) {
-            case TokenType::PROGRAM_START:
-            case TokenType::KEYWORD:
-            case TokenType::LPAREN:
-            case TokenType::LBRACE:
-            case TokenType::LBRACKET:
-            case TokenType::OPERATOR:
-            case TokenType::ARG_SEPARATOR: break;
+    /**
+     * Returns operator at `ptr` and writes its length, or returns
+        OPERATOR_NONE. Reads second char, so `ptr` must be followed by at
+        least one readable byte (Source padding).
+     */
+    Operator find(const char *ptr, unsigned long *length) const {
+        unsigned char first = (unsigned char)ptr[0];
+
+        if (first >= 128) {
+            return Operator::OPERATOR_NONE;
+        }
 
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected number", .line = this->line, .column = this->column } };
+        const Entry &entry = this->entries[first];
+
+        for (unsigned long i = 0; i < MAX_CONTINUATIONS; i++) {
+            if (entry.continuations[i].oper != Operator::OPERATOR_NONE && entry.continuations[i].second == ptr[1]) {
+                *length = 2;
+                return entry.continuations[i].oper;
             }
         }
 
-        Token token = this->nextNumber();
-        this->prevType = token.type;
-        return token;
+        *length = 1;
+        return entry.single;
     }
+};
+
+constexpr OperatorTable OPERATOR_TABLE;
+
+static_assert(OPERATOR_TABLE.overflows == 0, "Operator is longer than 2 chars or OperatorTable::MAX_CONTINUATIONS is too small");
+
+constexpr unsigned long TOKEN_TYPE_COUNT = TokenType::LEXER_ERROR + 1;
 
-    if (chr.bytes[0] == Lexer::LPAREN) {
-        switch (this->prevType) {
-            case TokenType::PROGRAM_START:
-            case TokenType::IDENTIFIER:
-            case TokenType::KEYWORD:
-            case TokenType::LPAREN:
-            case TokenType::RPAREN:
-            case TokenType::LBRACE:
-            case TokenType::LBRACKET:
-            case TokenType::RBRACKET:
-            case TokenType::OPERATOR:
-            case TokenType::ARG_SEPARATOR: break;
-
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected left parentheses", .line = this->line, .column = this->column } };
+/**
+ * Tokens, which may precede token of `type` (as documented in TokenType).
+    Operators and strings are not checked yet, so they may follow anything.
+ */
+struct FollowRule {
+    TokenType type;
+    const char *error;
+    std::initializer_list<TokenType> after;
+};
+
+constexpr TokenType ANY_TOKEN = TokenType::LEXER_ERROR;
+
+constexpr FollowRule FOLLOW_RULES[] = {
+    { TokenType::IDENTIFIER, "Unexpected identifier", {
+        TokenType::PROGRAM_START, TokenType::KEYWORD, TokenType::LPAREN, TokenType::LBRACE, TokenType::LBRACKET,
+        TokenType::OPERATOR, TokenType::RBRACE, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::KEYWORD, "Unexpected identifier", {
+        TokenType::PROGRAM_START, TokenType::KEYWORD, TokenType::LPAREN, TokenType::LBRACE, TokenType::LBRACKET,
+        TokenType::OPERATOR, TokenType::RBRACE, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::INT_NUMBER, "Unexpected number", {
+        TokenType::PROGRAM_START, TokenType::KEYWORD, TokenType::LPAREN, TokenType::LBRACE, TokenType::LBRACKET,
+        TokenType::OPERATOR, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::FLOAT_NUMBER, "Unexpected number", {
+        TokenType::PROGRAM_START, TokenType::KEYWORD, TokenType::LPAREN, TokenType::LBRACE, TokenType::LBRACKET,
+        TokenType::OPERATOR, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::LPAREN, "Unexpected left parentheses", {
+        TokenType::PROGRAM_START, TokenType::IDENTIFIER, TokenType::KEYWORD, TokenType::LPAREN, TokenType::RPAREN,
+        TokenType::LBRACE, TokenType::LBRACKET, TokenType::RBRACKET, TokenType::OPERATOR, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::RPAREN, "Unexpected right parentheses", {
+        TokenType::IDENTIFIER, TokenType::INT_NUMBER, TokenType::FLOAT_NUMBER, TokenType::LPAREN, TokenType::RPAREN,
+        TokenType::RBRACE, TokenType::STRING, TokenType::RBRACKET,
+    } },
+    { TokenType::LBRACE, "Unexpected left brace", {
+        // Identifier just in case, if all keywords are still identifiers at the moment
+        TokenType::KEYWORD, TokenType::IDENTIFIER, TokenType::RPAREN,
+    } },
+    { TokenType::RBRACE, "Unexpected right brace", {
+        TokenType::IDENTIFIER, TokenType::INT_NUMBER, TokenType::FLOAT_NUMBER, TokenType::KEYWORD, TokenType::RPAREN,
+        TokenType::LBRACE, TokenType::STRING, TokenType::RBRACKET,
+    } },
+    { TokenType::LBRACKET, "Unexpected left bracket", {
+        TokenType::PROGRAM_START, TokenType::IDENTIFIER, TokenType::KEYWORD, TokenType::LPAREN, TokenType::LBRACE,
+        TokenType::LBRACKET, TokenType::RBRACKET, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::RBRACKET, "Unexpected right bracket", {
+        TokenType::IDENTIFIER, TokenType::INT_NUMBER, TokenType::FLOAT_NUMBER, TokenType::RPAREN, TokenType::LBRACKET,
+        TokenType::RBRACKET, TokenType::STRING, TokenType::ARG_SEPARATOR,
+    } },
+    { TokenType::ARG_SEPARATOR, "Unexpected argument separator", {
+        TokenType::IDENTIFIER, TokenType::INT_NUMBER, TokenType::FLOAT_NUMBER, TokenType::RPAREN, TokenType::STRING,
+        TokenType::RBRACKET,
+    } },
+    { TokenType::OPERATOR, "Unexpected operator", { ANY_TOKEN } },
+    { TokenType::STRING, "Unexpected string", { ANY_TOKEN } },
+};
+
+enum Transition : unsigned char {
+    TRANSITION_INVALID,
+    TRANSITION_VALID,
+    // Valid by type, but parens must match, or keyword must be checked
+    TRANSITION_CHECKED,
+};
+
+/**
+ * Transition table of FOLLOW_RULES: transitions[prevType][type] tells, if
+    token of `type` may follow token of `prevType`. Built at compile time, so
+    TokenValidator checks order of most tokens with one load.
+ */
+struct TransitionTable {
+    Transition transitions[TOKEN_TYPE_COUNT][TOKEN_TYPE_COUNT];
+    const char *errors[TOKEN_TYPE_COUNT];
+    unsigned long missingRules;
+
+    constexpr TransitionTable() : transitions(), errors(), missingRules(0) {
+        for (const FollowRule &rule : FOLLOW_RULES) {
+            this->errors[rule.type] = rule.error;
+
+            for (TokenType prevType : rule.after) {
+                for (unsigned long prev = 0; prev < TOKEN_TYPE_COUNT; prev++) {
+                    if (prevType == ANY_TOKEN || prevType == prev) {
+                        this->transitions[prev][rule.type] = isChecked((TokenType)prev, rule.type) ? TRANSITION_CHECKED : TRANSITION_VALID;
+                    }
+                }
             }
         }
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
-        this->parens.push(TokenType::LPAREN);
-        this->prevType = TokenType::LPAREN;
-        return { Token { .type = TokenType::LPAREN, .content = charToString(Lexer::LPAREN), .line = line, .column = column } };
-    }
-
-    if (chr.bytes[0] == Lexer::RPAREN) {
-        switch (this->prevType) {
-            case TokenType::IDENTIFIER:
-            case TokenType::INT_NUMBER:
-            case TokenType::FLOAT_NUMBER:
-            case TokenType::LPAREN:
-            case TokenType::RPAREN:
-            case TokenType::RBRACE:
-            case TokenType::STRING:
-            case TokenType::RBRACKET: break;
-
-            default: {
-                std::printf("%s\n", Token { this->prevType, "none", 0, 0 }.to_string().c_str());
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected right parentheses", .line = this->line, .column = this->column } };
+        for (unsigned long type = TokenType::IDENTIFIER; type < TokenType::LEXER_ERROR; type++) {
+            if (this->errors[type] == nullptr) {
+                this->missingRules++;
             }
         }
+    }
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
-
-        if (this->parens.top() != TokenType::LPAREN) {
-            return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected ')'. Do you forget to close other parens?", .line = line, .column = column } };
+    /**
+     * Parens and braces are matched, words after '}' and "else" are checked.
+     */
+    static constexpr bool isChecked(TokenType prevType, TokenType type) {
+        if (type == TokenType::LPAREN || type == TokenType::RPAREN || type == TokenType::LBRACE || type == TokenType::RBRACE) {
+            return true;
         }
 
-        this->parens.pop();
-        this->prevType = TokenType::RPAREN;
-        return { Token { .type = TokenType::RPAREN, .content = charToString(Lexer::RPAREN), .line = line, .column = column } };
+        return (type == TokenType::IDENTIFIER || type == TokenType::KEYWORD) && (prevType == TokenType::RBRACE || prevType == TokenType::KEYWORD);
+    }
+};
+
+constexpr TransitionTable TRANSITIONS;
+
+static_assert(TRANSITIONS.missingRules == 0, "Every token type must have its rule in FOLLOW_RULES");
+static_assert(
+    TRANSITIONS.transitions[TokenType::LPAREN][TokenType::IDENTIFIER] == TRANSITION_VALID &&
+    TRANSITIONS.transitions[TokenType::IDENTIFIER][TokenType::INT_NUMBER] == TRANSITION_INVALID
+);
+
+inline unsigned char classifyChar(char32_t chr) {
+    if (chr < 0x80) {
+        return CHAR_CLASSES.classes[chr];
     }
 
-    if (chr.bytes[0] == Lexer::LBRACE) {
-        switch (this->prevType) {
-            case TokenType::KEYWORD:
-            case TokenType::IDENTIFIER: // just in case, if all keywords are still identifiers at the moment
-            case TokenType::RPAREN: break;
+    return classifyUnicode(chr);
+}
+
+}
+
+Lexer::Lexer(std::string_view input) : Lexer(Source(input)) {}
 
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected left brace", .line = this->line, .column = this->column } };
+Lexer::Lexer(Source source) : source(std::move(source)) {
+    this->windowOffset = 0;
+    this->windowPosition = SourcePosition { .line = 1, .column = 1 };
+    this->loadCode();
+}
+
+/**
+ * Starts lexing code of own Source from its beginning.
+ */
+void Lexer::loadCode() {
+    this->code = this->source.getCode();
+    this->index = 0;
+    this->invalidUtf8 = false;
+    this->map.reset();
+
+    const char *data = this->code.data();
+    const char *end = data + this->code.size();
+
+    // Whole code is validated at once, so lexing itself never checks chars.
+    // Invalid code is lexed up to the first invalid sequence, then reported.
+    if (!isValidUtf8(data, end)) {
+        this->code = this->code.substr(0, findInvalidUtf8(data, end) - data);
+        this->invalidUtf8 = true;
+    }
+
+    this->decodeCurrent();
+}
+
+Lexer::Lexer(SourceStream stream) : Lexer(Source(std::string_view())) {
+    this->stream.emplace(std::move(stream));
+    this->refill();
+}
+
+Lexer::Lexer(std::string_view code, unsigned long start, bool invalidUtf8) : Lexer(Source(std::string_view())) {
+    this->code = code;
+    this->index = start;
+    this->invalidUtf8 = invalidUtf8;
+    this->decodeCurrent();
+}
+
+std::optional<Token> Lexer::next() {
+    while (true) {
+        std::optional<Token> token = this->stream.has_value() ? this->nextStreamed() : this->nextToken();
+
+        if (!token.has_value()) {
+            return token;
+        }
+
+        if (token->type == TokenType::LEXER_ERROR) {
+            if (!this->recovering) {
+                return token;
             }
+
+            this->recordError(*token);
+
+            if (!this->resumeAfterInvalidUtf8()) {
+                this->skipToDelimiter();
+            }
+
+            continue;
         }
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
-        this->parens.push(TokenType::LBRACE);
-        this->prevType = TokenType::LBRACE;
-        return { Token { .type = TokenType::LBRACE, .content = charToString(Lexer::LBRACE), .line = line, .column = column } };
-    }
-
-    if (chr.bytes[0] == Lexer::RBRACE) {
-        switch (this->prevType) {
-            case TokenType::IDENTIFIER:
-            case TokenType::INT_NUMBER:
-            case TokenType::FLOAT_NUMBER:
-            case TokenType::KEYWORD:
-            case TokenType::RPAREN:
-            case TokenType::LBRACE:
-            case TokenType::STRING:
-            case TokenType::RBRACKET: break;
-
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected right brace", .line = this->line, .column = this->column } };
+        this->intern(&*token);
+        std::optional<Token> error = this->validator.check(*token);
+
+        if (error.has_value()) {
+            if (!this->recovering) {
+                return error;
+            }
+
+            if (!this->afterError) {
+                this->recordError(*error);
             }
+
+            this->validator.accept(*token);
         }
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
+        this->afterError = false;
+        return token;
+    }
+}
+
+void Lexer::setRecovering(bool recovering) {
+    this->recovering = recovering;
+}
+
+const std::vector<Token> &Lexer::getDiagnostics() const {
+    return this->diagnostics;
+}
+
+void Lexer::intern(Token *token) {
+    if (this->symbols != nullptr && (token->type == TokenType::IDENTIFIER || token->type == TokenType::STRING)) {
+        token->symbol = this->symbols->intern(token->content);
+    }
+}
+
+void Lexer::setSymbols(SymbolTable *symbols) {
+    this->symbols = symbols;
+}
+
+SymbolTable *Lexer::getSymbols() const {
+    return this->symbols;
+}
+
+__attribute__((noinline, cold))
+void Lexer::recordError(const Token &error) {
+    this->diagnostics.push_back(error);
+    this->afterError = true;
+}
+
+/**
+ * Skips the rest of erroneous token: at least one char, then up to
+    whitespace, delimiter or the end of code.
+ */
+__attribute__((noinline, cold))
+void Lexer::skipToDelimiter() {
+    if (this->index >= this->code.size()) {
+        return;
+    }
+
+    char32_t chr = this->advanceChar();
+
+    while (
+        this->index < this->code.size() && !(classifyChar(chr) & CHAR_WHITESPACE) &&
+        chr != (char32_t)Lexer::LPAREN && chr != (char32_t)Lexer::RPAREN &&
+        chr != (char32_t)Lexer::LBRACE && chr != (char32_t)Lexer::RBRACE &&
+        chr != (char32_t)Lexer::LBRACKET && chr != (char32_t)Lexer::RBRACKET &&
+        chr != (char32_t)Lexer::ARG_SEPARATOR
+    ) {
+        chr = this->advanceChar();
+    }
+}
+
+/**
+ * If code was cut at invalid UTF-8, and cursor reached it, skips invalid
+    sequence and continues code up to the next invalid one. Source keeps the
+    whole code, so offsets don't change.
+ */
+__attribute__((noinline, cold))
+bool Lexer::resumeAfterInvalidUtf8() {
+    std::string_view whole = this->source.getCode();
+
+    if (this->stream.has_value() || this->index < this->code.size() || this->code.size() >= whole.size() || this->code.data() != whole.data()) {
+        return false;
+    }
+
+    unsigned long resume = this->code.size() + 1;
+
+    while (resume < whole.size() && ((unsigned char)whole[resume] & 0xC0) == 0x80) {
+        resume++;
+    }
 
-        if (this->parens.top() != TokenType::LBRACE) {
-            return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected '}'. Do you forget to close other parens?", .line = line, .column = column } };
+    const char *begin = whole.data() + resume;
+    const char *end = whole.data() + whole.size();
+    const char *invalid = isValidUtf8(begin, end) ? end : findInvalidUtf8(begin, end);
+    this->code = whole.substr(0, invalid - whole.data());
+    this->invalidUtf8 = invalid != end;
+    this->rewind(resume);
+    return true;
+}
+
+std::optional<Token> Lexer::fill(PackedTokens *tokens) {
+    if (this->stream.has_value()) {
+        return { Token { .type = TokenType::LEXER_ERROR, .content = "Streamed code can't be packed", .offset = this->offsetOf(this->index) } };
+    }
+
+    if (this->code.size() > UINT32_MAX) {
+        return { Token { .type = TokenType::LEXER_ERROR, .content = "Code is too big to be packed", .offset = this->offsetOf(this->index) } };
+    }
+
+    // Code may continue after invalid UTF-8 in recovery mode, so buffer is for the whole Source
+    tokens->reset(this->source.getCode());
+
+    while (true) {
+        std::optional<Token> token = this->next();
+
+        if (!token.has_value() || token->type == TokenType::LEXER_ERROR) {
+            this->filledWhole = !token.has_value();
+            return token;
         }
 
-        this->parens.pop();
-        this->prevType = TokenType::RBRACE;
-        return { Token { .type = TokenType::RBRACE, .content = charToString(Lexer::RBRACE), .line = line, .column = column } };
-    }
-
-    if (chr.bytes[0] == Lexer::LBRACKET) {
-        switch (this->prevType) {
-            case TokenType::PROGRAM_START:
-            case TokenType::IDENTIFIER:
-            case TokenType::KEYWORD:
-            case TokenType::LPAREN:
-            case TokenType::LBRACE:
-            case TokenType::LBRACKET:
-            case TokenType::RBRACKET:
-            case TokenType::ARG_SEPARATOR: break;
-
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected left bracket", .line = this->line, .column = this->column } };
-            }
+        tokens->push(*token);
+    }
+}
+
+namespace {
+
+/**
+ * Chunk of code, lexed speculatively from `start` up to the first token
+    boundary at or after `end`, which is `stop`. Boundary is the cursor
+    before token, so `boundaries` are ascending, one per token.
+ */
+struct LexedChunk {
+    unsigned long start;
+    unsigned long end;
+    PackedTokens tokens;
+    std::vector<std::uint32_t> boundaries;
+    unsigned long stop;
+    // Set, if lexing stopped at error at `stop`
+    std::optional<Token> error;
+    Arena strings;
+};
+
+/**
+ * Start of the first line after `offset` (within `limit` bytes), or start of
+    the next char, if line doesn't end there. Strings rarely span lines, so
+    it's likely outside of them.
+ */
+unsigned long findRestart(std::string_view code, unsigned long offset, unsigned long limit) {
+    unsigned long searchEnd = std::min(code.size(), offset + limit);
+    const void *lineFeed = std::memchr(code.data() + offset, '\n', searchEnd - offset);
+
+    if (lineFeed != nullptr) {
+        return (const char *)lineFeed - code.data() + 1;
+    }
+
+    while (offset < code.size() && ((unsigned char)code[offset] & 0xC0) == 0x80) {
+        offset++;
+    }
+
+    return offset;
+}
+
+/**
+ * Runs `task` for each index below `count` on `threadCount` threads
+    (including calling one). Each thread takes the next index, when it's done
+    with previous one, so chunks of different cost are balanced.
+ */
+void runParallel(unsigned long count, unsigned long threadCount, const std::function<void(unsigned long)> &task) {
+    std::atomic<unsigned long> next(0);
+    auto worker = [&]() {
+        for (unsigned long i = next++; i < count; i = next++) {
+            task(i);
         }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(std::min(threadCount, count));
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
-        this->prevType = TokenType::LBRACKET;
-        return { Token { .type = TokenType::LBRACKET, .content = charToString(Lexer::LBRACKET), .line = line, .column = column } };
-    }
-
-    if (chr.bytes[0] == Lexer::RBRACKET) {
-        switch (this->prevType) {
-            case TokenType::IDENTIFIER:
-            case TokenType::INT_NUMBER:
-            case TokenType::FLOAT_NUMBER:
-            case TokenType::RPAREN:
-            case TokenType::LBRACKET:
-            case TokenType::RBRACKET:
-            case TokenType::STRING:
-            case TokenType::ARG_SEPARATOR: break;
-
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected right bracket", .line = this->line, .column = this->column } };
-            }
+    for (unsigned long i = 1; i < std::min(threadCount, count); i++) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+}
+
+std::optional<Token> Lexer::fillParallel(PackedTokens *tokens, unsigned long threadCount, unsigned long chunkSize) {
+    if (
+        this->stream.has_value() || this->recovering || this->code.size() > UINT32_MAX ||
+        threadCount <= 1 || this->code.size() - this->index <= chunkSize
+    ) {
+        return this->fill(tokens);
+    }
+
+    std::vector<LexedChunk> chunks;
+    unsigned long start = this->index;
+
+    while (start < this->code.size()) {
+        if (!chunks.empty()) {
+            chunks.back().end = start;
         }
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
-        this->prevType = TokenType::RBRACKET;
-        return { Token { .type = TokenType::RBRACKET, .content = charToString(Lexer::RBRACKET), .line = line, .column = column } };
+        chunks.push_back(LexedChunk { .start = start, .end = ~0UL, .tokens = PackedTokens(), .boundaries = {}, .stop = 0, .error = {}, .strings = Arena() });
+        unsigned long nominal = start + chunkSize;
+        start = nominal < this->code.size() ? findRestart(this->code, nominal, chunkSize) : this->code.size();
     }
 
-    if (chr.bytes[0] == Lexer::ARG_SEPARATOR) {
-        switch (this->prevType) {
-            case TokenType::IDENTIFIER:
-            case TokenType::INT_NUMBER:
-            case TokenType::FLOAT_NUMBER:
-            case TokenType::RPAREN:
-            case TokenType::STRING:
-            case TokenType::RBRACKET: break;
+    runParallel(chunks.size(), threadCount, [&](unsigned long i) {
+        LexedChunk &chunk = chunks[i];
+        Lexer lexer(this->code, chunk.start, this->invalidUtf8);
+        chunk.tokens.reset(this->code);
+        chunk.stop = lexer.lexChunk(chunk.end, &chunk.tokens, &chunk.boundaries, &chunk.error);
+        chunk.strings = std::move(lexer.strings);
+    });
+
+    // Chunks are joined at the boundary, where previous one stopped. If chunk
+    // has no such boundary, it started inside of token, so it's lexed again
+    // from there, until it meets boundary of chunk or reaches its end.
+    tokens->reset(this->code);
+    unsigned long total = 0;
+
+    for (const LexedChunk &chunk : chunks) {
+        total += chunk.tokens.size();
+    }
+
+    // Relexed tokens at boundaries are few, so arrays are allocated once
+    tokens->reserve(total);
+    this->chunkStrings.reserve(this->chunkStrings.size() + chunks.size());
+    unsigned long boundary = this->index;
+    std::optional<Token> error;
+    bool ended = false;
+
+    for (LexedChunk &chunk : chunks) {
+        while (!ended && !error.has_value() && boundary < chunk.end) {
+            const std::uint32_t *found = std::lower_bound(chunk.boundaries.data(), chunk.boundaries.data() + chunk.boundaries.size(), boundary);
+
+            if (boundary == chunk.stop || (found != chunk.boundaries.data() + chunk.boundaries.size() && *found == boundary)) {
+                tokens->append(chunk.tokens, found - chunk.boundaries.data());
+                boundary = chunk.stop;
+                error = chunk.error;
+                break;
+            }
+
+            this->rewind(boundary);
+            std::optional<Token> token = this->nextToken();
+            boundary = this->index;
 
-            default: {
-                return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected argument separator", .line = this->line, .column = this->column } };
+            if (!token.has_value()) {
+                ended = true;
+            } else if (token->type == TokenType::LEXER_ERROR) {
+                error = token;
+            } else {
+                tokens->push(*token);
             }
         }
 
-        unsigned long line = this->line;
-        unsigned long column = this->column;
-        this->advanceChar();
-        this->prevType = TokenType::ARG_SEPARATOR;
-        return { Token { .type = TokenType::ARG_SEPARATOR, .content = charToString(Lexer::ARG_SEPARATOR), .line = line, .column = column } };
+        this->chunkStrings.push_back(std::move(chunk.strings));
     }
 
-    if (chr.bytes[0] == '"' || chr.bytes[0] == '\'') {
-        this->prevType = TokenType::STRING;
-        return { this->nextString(chr) };
+    this->rewind(boundary);
+
+    if (error.has_value() && boundary >= this->code.size()) {
+        // Invalid UTF-8 at the end is already reported by chunk
+        this->invalidUtf8 = false;
     }
 
-    unsigned long line = this->line;
-    unsigned long column = this->column;
+    // Table isn't shared by threads, so tokens are interned in this pass too
+    for (unsigned long i = 0; i < tokens->size(); i++) {
+        Token token = tokens->get(i);
+        std::optional<Token> invalid = this->validator.check(token);
 
-    std::optional<std::string> operatorText = this->find_operator();
+        if (invalid.has_value()) {
+            tokens->truncate(i);
+            this->filledWhole = false;
+            return invalid;
+        }
 
-    if (operatorText.has_value()) {
-        this->prevType = TokenType::OPERATOR;
-        return { Token { .type = TokenType::OPERATOR, .content = *operatorText, .line = line, .column = column } };
+        this->intern(&token);
+
+        if (token.symbol != NO_SYMBOL) {
+            tokens->setSymbol(i, token.symbol);
+        }
     }
 
-    return { Token { .type = TokenType::LEXER_ERROR, .content = "Unknown token type", .line = line, .column = column } };
+    this->filledWhole = !error.has_value();
+    return error;
+}
+
+namespace {
+
+/**
+ * Offset, where token begins in code. Offset of string is its content, so
+    its opening quote is one byte before.
+ */
+unsigned long startOf(TokenType type, unsigned long offset) {
+    return type == TokenType::STRING ? offset - 1 : offset;
 }
 
-Token Lexer::findKeyword(Token token) {
-    if (token.type == TokenType::IDENTIFIER && (token.content == "if" || token.content == "else" || token.content == "while" || token.content == "for")) {
-        return Token { .type = TokenType::KEYWORD, .content = token.content, .line = token.line, .column = token.column };
+/**
+ * Index of the first token at or after `offset`.
+ */
+unsigned long findToken(const PackedTokens &tokens, unsigned long offset) {
+    unsigned long low = 0;
+    unsigned long high = tokens.size();
+
+    while (low < high) {
+        unsigned long middle = low + (high - low) / 2;
+
+        if (tokens.getOffset(middle) < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
     }
 
-    return token;
+    return low;
 }
 
-std::optional<std::string> Lexer::find_operator() {
-    return this->get_operator("", 2); // Max. length of operator is 2
 }
 
-std::optional<std::string> Lexer::get_operator(std::string str, short depth) {
-    if (depth == 0) {
-        for (unsigned long i = 0; i < sizeof(Lexer::OPERATORS) / sizeof(Lexer::OPERATORS[0]); i++) {
-            if (str == this->OPERATORS[i]) {
-                this->advanceChar();
-                return { str };
-            }
-        }
-    } else {
-        std::string str2;
-        str2.append(str);
-        utfStringAppend(&str, this->peekChar());
-        std::optional<std::string> oper = get_operator(str2, depth - 1);
+std::optional<Token> Lexer::relex(PackedTokens *tokens, const TextEdit &edit, TokenChange *change) {
+    std::string_view oldCode = this->source.getCode();
+
+    if (this->stream.has_value()) {
+        return { Token { .type = TokenType::LEXER_ERROR, .content = "Streamed code can't be relexed", .offset = this->offsetOf(this->index) } };
+    }
+
+    if (edit.offset > oldCode.size() || edit.removed > oldCode.size() - edit.offset) {
+        return { Token { .type = TokenType::LEXER_ERROR, .content = "Edit is outside of code", .offset = oldCode.size() } };
+    }
+
+    if (oldCode.size() - edit.removed + edit.inserted.size() > UINT32_MAX) {
+        return { Token { .type = TokenType::LEXER_ERROR, .content = "Code is too big to be packed", .offset = edit.offset } };
+    }
 
-        if (oper.has_value()) {
-            return { oper };
+    std::string code;
+    code.reserve(oldCode.size() - edit.removed + edit.inserted.size());
+    code.append(oldCode.substr(0, edit.offset));
+    code.append(edit.inserted);
+    code.append(oldCode.substr(edit.offset + edit.removed));
+    this->source = Source(code);
+    this->loadCode();
+    this->validator = TokenValidator();
+    this->afterError = false;
+
+    // Token before edit may grow into it, and the one before that may look
+    // ahead into it (e.g. number before '.'), so both are lexed again. If old
+    // tokens don't reach the end, there is nothing to meet after edit.
+    unsigned long count = this->filledWhole ? tokens->size() : 0;
+    unsigned long first = findToken(*tokens, edit.offset);
+    first = std::min(first >= 2 ? first - 2 : 0, count);
+    unsigned long start = first == 0 ? 0 : startOf(tokens->getType(first), tokens->getOffset(first));
+    unsigned long old = std::max(first, findToken(*tokens, edit.offset + edit.removed));
+    unsigned long editEnd = edit.offset + edit.inserted.size();
+    long shift = (long)edit.inserted.size() - (long)edit.removed;
+    PackedTokens relexed;
+    relexed.reset(this->source.getCode());
+    this->rewind(start);
+    std::optional<Token> error;
+
+    while (true) {
+        std::optional<Token> token = this->nextToken();
+
+        if (!token.has_value() || token->type == TokenType::LEXER_ERROR) {
+            error = token;
+            old = tokens->size();
+            break;
         }
 
-        this->advanceChar();
+        // Lexer, which starts token at the same place in the same text, lexes
+        // the same tokens from there. Starts are compared, not offsets, so an
+        // edit of opening quote doesn't meet the old string behind it.
+        unsigned long tokenStart = startOf(token->type, token->offset);
+
+        if (tokenStart >= editEnd) {
+            unsigned long oldStart = tokenStart - shift;
+
+            while (old < count && startOf(tokens->getType(old), tokens->getOffset(old)) < oldStart) {
+                old++;
+            }
 
-        for (unsigned long i = 0; i < sizeof(Lexer::OPERATORS) / sizeof(Lexer::OPERATORS[0]); i++) {
-            if (str == this->OPERATORS[i]) {
-                return { str };
+            if (old < count && startOf(tokens->getType(old), tokens->getOffset(old)) == oldStart && tokens->getType(old) == token->type) {
+                break;
             }
         }
+
+        this->intern(&*token);
+        relexed.push(*token);
     }
 
-    return {};
+    tokens->replace(this->source.getCode(), first, old - first, relexed, shift);
+    *change = TokenChange { .start = first, .removed = old - first, .inserted = relexed.size() };
+    this->rewind(this->code.size());
+    this->filledWhole = !error.has_value();
+    return error;
 }
 
 /**
- * Caller must ensure, that this->index + 1 < this->code.size()
-*/
-Utf8Char Lexer::peekChar() {
-    std::tuple<unsigned char, Utf8Char> chr = getNextUnicode(this->code.c_str() + this->index);
+ * Lexes tokens of chunk, until boundary reaches `end`, code ends or error
+    occurs. Returns the last boundary.
+ */
+unsigned long Lexer::lexChunk(unsigned long end, PackedTokens *tokens, std::vector<std::uint32_t> *boundaries, std::optional<Token> *error) {
+    while (this->index < end) {
+        unsigned long boundary = this->index;
+        std::optional<Token> token = this->nextToken();
+
+        if (!token.has_value()) {
+            return this->index;
+        }
+
+        if (token->type == TokenType::LEXER_ERROR) {
+            *error = token;
+            return boundary;
+        }
 
-    if (std::get<0>(chr) == UTF8_INVALID) {
-        std::fprintf(stderr, "Invalid UTF-8!\n");
-        throw new std::exception();
+        tokens->push(*token);
+        boundaries->push_back(boundary);
     }
 
-    return std::get<1>(chr);
+    return this->index;
 }
 
 /**
- * Caller must ensure, that this->index + 1 < this->code.size()
-*/
-Utf8Char Lexer::advanceChar() {
-    if (this->code[this->index] == '\n') {
-        this->line++;
-        this->column = 1;
-    } else if (this->code[this->index] == '\r') {
-        if (this->code[this->index + 1] == '\n') {
-            // Windows CRLF, make sure, that its counted as only one line feed, so do nothing
-        } else {
-            this->line++;
-            this->column = 1;
+ * Whitespaces and tokens may be split between blocks. Lexer doesn't keep
+    state of unfinished token: whitespaces or token, that reach the end of
+    window, are lexed again after the next block is read. Text from their
+    start is kept in window, so token is always lexed from contiguous text.
+ */
+std::optional<Token> Lexer::nextStreamed() {
+    while (true) {
+        while (!this->stream->isEnded() && this->code.size() - this->index < Lexer::STREAM_LOOKAHEAD) {
+            this->refill();
+        }
+
+        unsigned long start = this->index;
+        this->skipWhitespaces();
+
+        if (this->reachesBlockEnd()) {
+            this->rewind(start);
+            this->refill();
+        } else if (this->stream->isEnded() || this->code.size() - this->index >= Lexer::STREAM_LOOKAHEAD) {
+            break;
         }
-    } else {
-        this->column++;
     }
 
-    std::tuple<unsigned char, Utf8Char> chrNow = getNextUnicode(this->code.c_str() + this->index);
-    unsigned char prevLength = std::get<0>(chrNow);
+    while (true) {
+        unsigned long start = this->index;
+        std::optional<Token> token = this->nextToken();
+
+        if (!this->reachesBlockEnd()) {
+            return token;
+        }
 
-    if (prevLength == UTF8_INVALID) {
-        std::fprintf(stderr, "Invalid UTF-8!\n");
-        throw new std::exception();
+        this->rewind(start);
+        this->refill();
     }
+}
+
+/**
+ * Reads the next block into window, dropping text before the cursor.
+ */
+void Lexer::refill() {
+    this->windowPosition = SourceMap::advance(this->windowPosition, this->code.substr(0, this->index));
+    this->windowOffset += this->index;
+    this->stream->advance(this->index);
+    this->code = this->stream->getCode();
+    this->index = 0;
+    this->invalidUtf8 = this->stream->isInvalid();
+    this->decodeCurrent();
+}
 
-    this->index += prevLength;
-    std::tuple<unsigned char, Utf8Char> chr = getNextUnicode(this->code.c_str() + this->index);
-    unsigned char length = std::get<0>(chr);
+/**
+ * True, if cursor is too close to the end of window, which isn't the end of
+    input, so token before it may be incomplete. Tokens of fixed length never
+    reach it, because window has STREAM_LOOKAHEAD bytes after their start.
+ */
+bool Lexer::reachesBlockEnd() {
+    return !this->stream->isEnded() && this->index + Lexer::STREAM_LOOKAHEAD / 2 > this->code.size();
+}
 
-    if (length == UTF8_INVALID) {
-        std::fprintf(stderr, "Invalid UTF-8!\n");
-        throw new std::exception();
+/**
+ * Moves cursor back (or forward) to `index` to lex from there again. Tokens
+    depend only on text after cursor, so no other state is restored.
+ */
+void Lexer::rewind(unsigned long index) {
+    this->index = index;
+    this->decodeCurrent();
+}
+
+/**
+ * Lexes the next token by its first char only. Order of tokens is checked
+    by TokenValidator, so the same text gives the same token anywhere.
+ */
+std::optional<Token> Lexer::nextToken() {
+    if (this->index >= this->code.size()) {
+        return this->finish();
+    }
+
+    this->skipWhitespaces();
+
+    if (this->index >= this->code.size()) {
+        return this->finish();
     }
 
-    // this->index += length;
-    return std::get<1>(chr);
+    char32_t chr = this->peekChar();
+
+    unsigned char charClass = classifyChar(chr);
+
+    if (charClass & CHAR_IDENTIFIER_START) {
+        return { this->nextIdentifier() };
+    }
+
+    if (charClass & CHAR_DIGIT) {
+        return { this->nextNumber() };
+    }
+
+    if (
+        chr == (char32_t)Lexer::LPAREN || chr == (char32_t)Lexer::RPAREN ||
+        chr == (char32_t)Lexer::LBRACE || chr == (char32_t)Lexer::RBRACE ||
+        chr == (char32_t)Lexer::LBRACKET || chr == (char32_t)Lexer::RBRACKET ||
+        chr == (char32_t)Lexer::ARG_SEPARATOR
+    ) {
+        TokenType type = TokenType::ARG_SEPARATOR;
+
+        switch (chr) {
+            case '(': type = TokenType::LPAREN; break;
+            case ')': type = TokenType::RPAREN; break;
+            case '{': type = TokenType::LBRACE; break;
+            case '}': type = TokenType::RBRACE; break;
+            case '[': type = TokenType::LBRACKET; break;
+            case ']': type = TokenType::RBRACKET; break;
+        }
+
+        unsigned long start = this->index;
+        this->advanceChar();
+        return { Token { .type = type, .content = this->slice(start), .offset = this->offsetOf(start) } };
+    }
+
+    if (chr == '"' || chr == '\'') {
+        return { this->nextString(chr) };
+    }
+
+    unsigned long start = this->index;
+
+    Operator oper = this->findOperator();
+
+    if (oper != Operator::OPERATOR_NONE) {
+        return { Token { .type = TokenType::OPERATOR, .content = this->slice(start), .offset = this->offsetOf(start), .oper = oper } };
+    }
+
+    return { Token { .type = TokenType::LEXER_ERROR, .content = "Unknown token type", .offset = this->offsetOf(start) } };
 }
 
-void Lexer::skipWhitespaces() {
-    Utf8Char chr = this->peekChar();
+Operator Lexer::findOperator() {
+    unsigned long length;
+    Operator oper = OPERATOR_TABLE.find(this->code.data() + this->index, &length);
 
-    while (utfCharInString(
-        Lexer::WHITESPACE_CHARS.c_str(),
-        Lexer::WHITESPACE_CHARS.c_str() + Lexer::WHITESPACE_CHARS.size(),
-        chr
-    )) {
-        chr = this->advanceChar();
+    if (oper == Operator::OPERATOR_NONE) {
+        return oper;
+    }
+
+    this->jumpTo(this->code.data() + this->index + length);
+    return oper;
+}
+
+/**
+ * Decodes char at this->index into lookahead cache. Code is validated in
+    constructor, so result isn't checked. Safe at the end of code: Source
+    padding is decoded as '\0' char.
+ */
+void Lexer::decodeCurrent() {
+    const char *ptr = this->code.data() + this->index;
+
+    if (!((unsigned char)ptr[0] & 0x80)) {
+        this->current = (unsigned char)ptr[0];
+        this->currentLength = 1;
+        return;
     }
+
+    DecodedChar decoded = decodeUtf8(ptr);
+    this->current = decoded.codePoint;
+    this->currentLength = decoded.length;
+}
+
+char32_t Lexer::peekChar() {
+    return this->current;
+}
+
+/**
+ * Appends UTF-8 bytes of current char, as they are in code.
+ */
+void Lexer::appendCurrent(std::string *string) {
+    string->append(this->code.data() + this->index, this->currentLength);
+}
+
+/**
+ * Called, when cursor reached the end of code. Reports invalid UTF-8, if code
+    was cut at it.
+ */
+std::optional<Token> Lexer::finish() {
+    if (!this->invalidUtf8) {
+        return {};
+    }
+
+    this->invalidUtf8 = false;
+    return { Token { .type = TokenType::LEXER_ERROR, .content = "Invalid UTF-8", .offset = this->offsetOf(this->index) } };
+}
+
+/**
+ * Lookahead of the last char decodes Source padding (or invalid sequence,
+    where code was cut), which is '\0' and belongs to no token. So all loops
+    over chars stop at the end of code and never leave the padding.
+*/
+char32_t Lexer::advanceChar() {
+    this->index += this->currentLength;
+    this->decodeCurrent();
+    return this->current;
+}
+
+/**
+ * Moves cursor forward to `ptr` inside of code.
+ */
+void Lexer::jumpTo(const char *ptr) {
+    this->index = ptr - this->code.data();
+    this->decodeCurrent();
+}
+
+void Lexer::skipWhitespaces() {
+    if (!(classifyChar(this->peekChar()) & CHAR_WHITESPACE)) {
+        return;
+    }
+
+    this->jumpTo(scanWhitespaces(this->code.data() + this->index));
 }
 
 Token Lexer::nextIdentifier() {
-    std::string content = "";
-    unsigned long line = this->line;
-    unsigned long column = this->column;
-    Utf8Char utfChar = this->peekChar();
+    unsigned long start = this->index;
 
-    while (utfCharInString(this->IDENTIFIER_CHARS.c_str(), this->IDENTIFIER_CHARS.c_str() + this->IDENTIFIER_CHARS.size(), utfChar)) {
-        utfStringAppend(&content, utfChar);
-        utfChar = this->advanceChar();
+    while (true) {
+        this->jumpTo(scanIdentifierChars(this->code.data() + this->index));
+
+        // Non-ASCII chars are rare, so they are checked only where ASCII run stops
+        if (this->current < 0x80 || !(classifyUnicode(this->current) & CHAR_IDENTIFIER)) {
+            break;
+        }
+
+        this->advanceChar();
+    }
+
+    std::string_view content = this->slice(start);
+    Keyword keyword = KEYWORD_TABLE.find(content);
+
+    if (keyword != Keyword::KEYWORD_NONE) {
+        return Token { .type = TokenType::KEYWORD, .content = content, .offset = this->offsetOf(start), .keyword = keyword };
     }
 
-    return Token { .type = TokenType::IDENTIFIER, .content = content, .line = line, .column = column };
+    return Token { .type = TokenType::IDENTIFIER, .content = content, .offset = this->offsetOf(start) };
 }
 
 Token Lexer::nextNumber() {
-    std::string content = "";
-    unsigned long line = this->line;
-    unsigned long column = this->column;
+    unsigned long start = this->index;
     bool floating = false;
-    Utf8Char utfChar = this->peekChar();
+    char32_t utfChar = this->peekChar();
 
-    while (utfCharInString(this->DIGITS.c_str(), this->DIGITS.c_str() + this->DIGITS.size(), utfChar)) {
-        utfStringAppend(&content, utfChar);
+    while (classifyChar(utfChar) & CHAR_DIGIT) {
         utfChar = this->advanceChar();
 
-        if (utfChar.bytes[0] == Lexer::FLOATING_POINT) { // This comparision is possible, because '.' is ASCII
+        if (utfChar == (char32_t)Lexer::FLOATING_POINT) {
             if (floating) {
-                return Token { .type = TokenType::LEXER_ERROR, .content = "Invalid floating point number. Maybe remove second period?", .line = line, .column = column };
+                return Token { .type = TokenType::LEXER_ERROR, .content = "Invalid floating point number. Maybe remove second period?", .offset = this->offsetOf(start) };
             }
 
             floating = true;
-            content.push_back(Lexer::FLOATING_POINT);
             utfChar = this->advanceChar();
         }
     }
 
+    std::string_view content = this->slice(start);
+
     if (content.back() == Lexer::FLOATING_POINT) { // TODO: Check if std::string.back() really returns last char or i'm stupid.
-        return Token { .type = TokenType::LEXER_ERROR, .content = "Floating point number must end with digit. Maybe add '0' to end of it?", .line = line, .column = column };
+        return Token { .type = TokenType::LEXER_ERROR, .content = "Floating point number must end with digit. Maybe add '0' to end of it?", .offset = this->offsetOf(start) };
     }
 
     if (floating) {
-        return Token { .type = TokenType::FLOAT_NUMBER, .content = content, .line = line, .column = column };
+        return Token { .type = TokenType::FLOAT_NUMBER, .content = content, .offset = this->offsetOf(start) };
     }
 
-    return Token { .type = TokenType::INT_NUMBER, .content = content, .line = line, .column = column };
+    return Token { .type = TokenType::INT_NUMBER, .content = content, .offset = this->offsetOf(start) };
 }
 
-Token Lexer::nextString(Utf8Char closingChar) {
-    Utf8Char chr = this->advanceChar(); // Gets next char after 1 open quote
-    bool escaped = false;
-    std::string buffer;
-    unsigned long line = this->line;
-    unsigned long column = this->column;
+/**
+ * Runs of plain chars between escape sequences are found by scanStringChars()
+    and taken (or copied) whole. Strings without escape sequences are views of
+    code, others are decoded into buffer.
+ */
+Token Lexer::nextString(char32_t closingChar) {
+    const char *data = this->code.data();
+    const char *end = data + this->code.size();
+    const char *ptr = data + this->index + 1; // After opening quote
+    unsigned long start = ptr - data;
+    char quote = (char)closingChar;
+    const char *stop = scanStringChars(ptr, end, quote);
+
+    if (stop < end && *stop == quote) {
+        this->jumpTo(stop + 1);
+        return Token { .type = TokenType::STRING, .content = this->code.substr(start, stop - ptr), .offset = this->offsetOf(start) };
+    }
 
-    while (chr.codePoint != closingChar.codePoint && (!escaped)) {
-        if (escaped) {
-            switch (chr.bytes[0]) {
-                case 'n': {
-                    buffer.push_back('\n');
-                    break;
-                }
-                case 'r': {
-                    buffer.push_back('\r');
-                    break;
-                }
-                case 't': {
-                    buffer.push_back('\t');
-                    break;
-                }
-                case '\\': {
-                    buffer.push_back('\\');
-                    break;
-                }
-                default: {
-                    if (closingChar.codePoint == chr.codePoint) {
-                        utfStringAppend(&buffer, chr);
-                    }
-                }
+    std::string &buffer = this->stringBuffer;
+    buffer.clear();
+
+    while (true) {
+        buffer.append(ptr, stop - ptr);
+
+        // Streaming lexer reads the next block, when cursor is at the end, and lexes string again
+        if (stop == end || (*stop == Lexer::ESCAPE && (stop + 1 == end || (stop[1] == 'u' && end - stop < 6)))) {
+            this->jumpTo(end);
+
+            if (this->invalidUtf8) {
+                return this->finish().value();
             }
 
-            escaped = false;
-            buffer.push_back(Lexer::ESCAPE);
-            utfStringAppend(&buffer, chr);
+            return Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected end of program. String is left unterminated", .offset = this->offsetOf(start) };
+        }
+
+        if (*stop == quote) {
+            break;
+        }
+
+        unsigned long escapeLength = Lexer::appendEscaped(stop, &buffer);
+
+        if (escapeLength == 0) {
+            return Token { .type = TokenType::LEXER_ERROR, .content = "Unknown escape sequence. Use \\n, \\r, \\t, \\\\, \\\", \\' or \\uXXXX", .offset = this->offsetOf(stop - data) };
+        }
+
+        ptr = stop + escapeLength;
+        stop = scanStringChars(ptr, end, quote);
+    }
+
+    // Only strings with escape sequences differ from source code and need own memory.
+    // Streamed tokens live only until the next token, so buffer is enough for them.
+    std::string_view content = this->stream.has_value() ? std::string_view(buffer) : this->strings.copyString(buffer);
+    this->jumpTo(stop + 1);
+    return Token { .type = TokenType::STRING, .content = content, .offset = this->offsetOf(start) };
+}
+
+/**
+ * Appends char of escape sequence at `escape` to buffer and returns length
+    of sequence, or returns 0, if sequence is unknown. `\uXXXX` is a code point
+    of four hex digits (not a surrogate), encoded as UTF-8. Sequence must not
+    be cut by `end`.
+ */
+unsigned long Lexer::appendEscaped(const char *escape, std::string *buffer) {
+    switch (escape[1]) {
+        case 'n': buffer->push_back('\n'); return 2;
+        case 'r': buffer->push_back('\r'); return 2;
+        case 't': buffer->push_back('\t'); return 2;
+        case '\\': buffer->push_back('\\'); return 2;
+        case '"': buffer->push_back('"'); return 2;
+        case '\'': buffer->push_back('\''); return 2;
+        case 'u': break;
+        default: return 0;
+    }
+
+    char32_t codePoint = 0;
+
+    for (unsigned long i = 2; i < 6; i++) {
+        char digit = escape[i];
+
+        if (digit >= '0' && digit <= '9') {
+            codePoint = codePoint * 16 + (digit - '0');
+        } else if ((digit | 0x20) >= 'a' && (digit | 0x20) <= 'f') {
+            codePoint = codePoint * 16 + ((digit | 0x20) - 'a' + 10);
         } else {
-            if (chr.bytes[0] == Lexer::ESCAPE) {
-                escaped = true;
-            } else {
-                utfStringAppend(&buffer, chr);
-            }
+            return 0;
         }
+    }
+
+    char bytes[4];
+    unsigned char length = encodeUtf8(codePoint, bytes);
+
+    if (length == UTF8_INVALID) {
+        return 0;
+    }
 
-        if (this->index + 1 >= this->code.size()) {
-            return Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected end of program. String is left unterminated", .line = line, .column = column };
+    buffer->append(bytes, length);
+    return 6;
+}
+
+std::string_view Lexer::slice(unsigned long start) {
+    return this->code.substr(start, this->index - start);
+}
+
+/**
+ * Offset in whole code of `index` in window (they differ only for stream).
+ */
+unsigned long Lexer::offsetOf(unsigned long index) {
+    return this->windowOffset + index;
+}
+
+SourcePosition Lexer::locate(unsigned long offset) {
+    if (this->stream.has_value()) {
+        // Offsets before window can't be located anymore, so they are moved to window start
+        unsigned long index = offset > this->windowOffset ? offset - this->windowOffset : 0;
+        return SourceMap::advance(this->windowPosition, this->code.substr(0, index));
+    }
+
+    if (!this->map.has_value()) {
+        this->map.emplace(this->source.getCode());
+    }
+
+    return this->map->locate(offset);
+}
+
+void ParenStack::push(TokenType type) {
+    if (this->depth < ParenStack::INLINE_CAPACITY) {
+        this->inlineItems[this->depth] = type;
+    } else {
+        this->overflow.push_back(type);
+    }
+
+    this->depth++;
+}
+
+TokenType ParenStack::pop() {
+    if (this->depth == 0) {
+        return TokenType::PROGRAM_START;
+    }
+
+    this->depth--;
+
+    if (this->depth < ParenStack::INLINE_CAPACITY) {
+        return this->inlineItems[this->depth];
+    }
+
+    TokenType type = this->overflow.back();
+    this->overflow.pop_back();
+    return type;
+}
+
+unsigned long ParenStack::size() const {
+    return this->depth;
+}
+
+TokenType ParenStack::top() const {
+    if (this->depth == 0) {
+        return TokenType::PROGRAM_START;
+    }
+
+    return this->depth <= ParenStack::INLINE_CAPACITY ? this->inlineItems[this->depth - 1] : this->overflow.back();
+}
+
+std::optional<Token> TokenValidator::check(const Token &token) {
+    Transition transition = TRANSITIONS.transitions[this->prevType][token.type];
+
+    if (transition == TRANSITION_VALID) {
+        this->prevType = token.type;
+        this->prevKeyword = token.keyword;
+        return {};
+    }
+
+    if (transition == TRANSITION_INVALID) {
+        return { Token { .type = TokenType::LEXER_ERROR, .content = TRANSITIONS.errors[token.type], .offset = token.offset } };
+    }
+
+    // Only "else" may follow '}' as a word, and the only word after keyword is "if" after "else"
+    if (token.type == TokenType::IDENTIFIER || token.type == TokenType::KEYWORD) {
+        if (this->prevType == TokenType::RBRACE && token.keyword != Keyword::KEYWORD_ELSE) {
+            return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected identifier. May be you mean to use 'else'?", .offset = token.offset } };
         }
 
-        chr = this->advanceChar();
+        if (this->prevKeyword == Keyword::KEYWORD_ELSE && token.keyword != Keyword::KEYWORD_IF) {
+            return { Token { .type = TokenType::LEXER_ERROR, .content = "Unexpected identifier. May be you mean to use 'else if'?", .offset = token.offset } };
+        }
+
+        if (this->prevType == TokenType::KEYWORD && this->prevKeyword != Keyword::KEYWORD_ELSE) {
+            return { Token { .type = TokenType::LEXER_ERROR, .content = TRANSITIONS.errors[token.type], .offset = token.offset } };
+        }
+    }
+
+    if (token.type == TokenType::LPAREN || token.type == TokenType::LBRACE) {
+        this->parens.push(token.type);
+    } else if (token.type == TokenType::RPAREN || token.type == TokenType::RBRACE) {
+        if (this->parens.top() != (token.type == TokenType::RPAREN ? TokenType::LPAREN : TokenType::LBRACE)) {
+            return { Token {
+                .type = TokenType::LEXER_ERROR,
+                .content = token.type == TokenType::RPAREN ? "Unexpected ')'. Do you forget to close other parens?" : "Unexpected '}'. Do you forget to close other parens?",
+                .offset = token.offset,
+            } };
+        }
+
+        this->parens.pop();
+    }
+
+    this->prevType = token.type;
+    this->prevKeyword = token.keyword;
+    return {};
+}
+
+void TokenValidator::accept(const Token &token) {
+    if (token.type == TokenType::LPAREN || token.type == TokenType::LBRACE) {
+        this->parens.push(token.type);
+    } else if (
+        (token.type == TokenType::RPAREN && this->parens.top() == TokenType::LPAREN) ||
+        (token.type == TokenType::RBRACE && this->parens.top() == TokenType::LBRACE)
+    ) {
+        this->parens.pop();
     }
 
-    this->advanceChar(); // get next token to prevent analyzing same string
-    return Token { .type = TokenType::STRING, .content = buffer, .line = line, .column = column };
+    this->prevType = token.type;
+    this->prevKeyword = token.keyword;
 }
 
-std::string Token::to_string() {
+std::string Token::to_string(SourcePosition position) {
     if (this->type == TokenType::LEXER_ERROR) {
-        return "Lexer error on line " + std::to_string(this->line) + ":" + \
-            std::to_string(this->column) + ": " + this->content;
+        return "Lexer error on line " + std::to_string(position.line) + ":" + \
+            std::to_string(position.column) + ": " + std::string(this->content);
     }
 
     std::map<TokenType, std::string> map = {
@@ -522,8 +1377,8 @@ std::string Token::to_string() {
         {TokenType::STRING, "String"},
     };
     return "<Token type='" + map[this->type] + "', content='" + \
-        this->content + "', line=" + std::to_string(this->line) + ":" + \
-        std::to_string(this->column) + ">";
+        std::string(this->content) + "', line=" + std::to_string(position.line) + ":" + \
+        std::to_string(position.column) + ">";
 }
 
 }
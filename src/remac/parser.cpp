@@ -28,15 +28,26 @@ FunctionCall(name="print", args=[
 ])
 */
 
+#include <remac/arena.hpp>
+#include <remac/astformat.hpp>
+#include <remac/flatast.hpp>
 #include <remac/lexer.hpp>
 #include <remac/parser.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <climits>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <exception>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
 #include <vector>
 
 namespace remac {
@@ -51,6 +62,14 @@ AstNode::NodeType AstNode::getType() {
     return AstNode::NodeType::NODE_EMPTY;
 }
 
+unsigned long AstNode::getByteLength() {
+    return AstFormat::getNodeLength(this);
+}
+
+unsigned long AstNode::toBytes(void *buffer) {
+    return AstFormat::writeNode(this, buffer);
+}
+
 bool AstNode::equals(AstNode *node) {
     if (this->getType() != node->getType()) {
         return false;
@@ -59,17 +78,24 @@ bool AstNode::equals(AstNode *node) {
     return this->equalTo(node);
 }
 
-SequenceNode::SequenceNode(std::vector<AstNode *> nodes) {
+SequenceNode::SequenceNode(const std::vector<AstNode *> &nodes) {
+    this->count = nodes.size();
+    this->nodes = new AstNode *[this->count];
+    std::copy(nodes.begin(), nodes.end(), this->nodes);
+}
+
+SequenceNode::SequenceNode(AstNode **nodes, unsigned long count) {
     this->nodes = nodes;
+    this->count = count;
 }
 
 std::string SequenceNode::toString() {
     std::string str = "<SequenceNode: [";
 
-    for (auto itr = this->nodes.cbegin(); itr != this->nodes.cend(); ++itr) {
-        str += (*itr)->toString();
+    for (unsigned long i = 0; i < this->count; i++) {
+        str += this->nodes[i]->toString();
 
-        if (itr + 1 != this->nodes.cend()) {
+        if (i + 1 != this->count) {
             str += ", ";
         }
     }
@@ -78,75 +104,69 @@ std::string SequenceNode::toString() {
     return str;
 }
 
-unsigned long SequenceNode::getByteLength() {
-    unsigned long totalSize = 0;
-
-    for (auto itr = this->nodes.cbegin(); itr != this->nodes.cend(); ++itr) {
-        totalSize += (*itr)->getByteLength();
-    }
-
-    return sizeof(unsigned int) + totalSize;
+AstNode::NodeType SequenceNode::getType() {
+    return AstNode::NodeType::NODE_SEQUENCE;
 }
 
-unsigned long SequenceNode::toBytes(void *buffer) {
-    *((unsigned int *)buffer) = this->nodes.size();
-
-    unsigned long offset = sizeof(unsigned int);
-
-    for (auto itr = this->nodes.cbegin(); itr != this->nodes.cend(); ++itr) {
-        offset += (*itr)->toBytes(((char *)buffer) + offset);
-    }
-
-    return offset;
+std::vector<AstNode *> SequenceNode::getSequence() {
+    return std::vector<AstNode *>(this->nodes, this->nodes + this->count);
 }
 
-unsigned long SequenceNode::fromBytes(void *buffer) {
-    unsigned int size = *((unsigned int *)buffer);
-    unsigned long i = 0;
-    unsigned long offset = sizeof(unsigned int);
-    this->nodes = std::vector<AstNode *>(size);
-
-    while (i < size) {
-        offset += this->nodes[i]->fromBytes((char *)buffer + offset);
-        i++;
-    }
-
-    return offset;
+unsigned long SequenceNode::getCount() {
+    return this->count;
 }
 
-AstNode::NodeType SequenceNode::getType() {
-    return AstNode::NodeType::NODE_SEQUENCE;
+AstNode *SequenceNode::getNode(unsigned long index) {
+    return this->nodes[index];
 }
 
-std::vector<AstNode *> SequenceNode::getSequence() {
+AstNode *const *SequenceNode::begin() {
     return this->nodes;
 }
 
+AstNode *const *SequenceNode::end() {
+    return this->nodes + this->count;
+}
+
 bool SequenceNode::equalTo(AstNode *node) {
-    return this->nodes == static_cast<SequenceNode *>(node)->getSequence();
+    SequenceNode *other = static_cast<SequenceNode *>(node);
+
+    if (this->count != other->count) {
+        return false;
+    }
+
+    for (unsigned long i = 0; i < this->count; i++) {
+        if (!this->nodes[i]->equals(other->nodes[i])) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 SequenceNode::~SequenceNode() {
-    for (auto itr = this->nodes.cbegin(); itr != this->nodes.cend(); ++itr) {
-        delete (*itr);
+    for (unsigned long i = 0; i < this->count; i++) {
+        delete this->nodes[i];
     }
+
+    delete[] this->nodes;
 }
 
-FunctionCallNode::FunctionCallNode(std::string name, SequenceNode *args) {
+FunctionCallNode::FunctionCallNode(const SymbolTable *symbols, Symbol name, SequenceNode *args) {
+    this->symbols = symbols;
     this->name = name;
     this->args = args;
 }
 
 std::string FunctionCallNode::toString() {
     std::string str = "<FunctionCallNode name=";
-    str += this->name;
+    str += this->getName();
     str += ", args=(";
-    std::vector<AstNode *> args = this->args->getSequence();
 
-    for (auto itr = args.cbegin(); itr != args.cend(); ++itr) {
+    for (auto itr = this->args->begin(); itr != this->args->end(); ++itr) {
         str += (*itr)->toString();
 
-        if (itr + 1 != args.cend()) {
+        if (itr + 1 != this->args->end()) {
             str += ", ";
         }
     }
@@ -155,33 +175,15 @@ std::string FunctionCallNode::toString() {
     return str;
 }
 
-unsigned long FunctionCallNode::getByteLength() {
-    unsigned long length = sizeof(unsigned int);
-    length += this->name.size();
-    length += this->args->getByteLength();
-    return length;
-}
-
-unsigned long FunctionCallNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    *((unsigned int *)buffer) = this->name.size();
-    offset += sizeof(unsigned int);
-    memcpy((char *)buffer + offset, this->name.c_str(), this->name.size());
-    offset += this->name.size();
-    offset += this->args->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long FunctionCallNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType FunctionCallNode::getType() {
     return AstNode::NodeType::NODE_FUNCTION_CALL;
 }
 
-std::string FunctionCallNode::getName() {
+std::string_view FunctionCallNode::getName() {
+    return this->symbols->getName(this->name);
+}
+
+Symbol FunctionCallNode::getSymbol() {
     return this->name;
 }
 
@@ -190,7 +192,9 @@ SequenceNode *FunctionCallNode::getArgs() {
 }
 
 bool FunctionCallNode::equalTo(AstNode *node) {
-    return this->name == static_cast<FunctionCallNode *>(node)->getName() && this->args->equals(static_cast<FunctionCallNode *>(node)->getArgs());
+    FunctionCallNode *call = static_cast<FunctionCallNode *>(node);
+    bool sameName = this->symbols == call->symbols ? this->name == call->name : this->getName() == call->getName();
+    return sameName && this->args->equals(call->getArgs());
 }
 
 FunctionCallNode::~FunctionCallNode() {
@@ -199,6 +203,12 @@ FunctionCallNode::~FunctionCallNode() {
 
 ProgramNode::ProgramNode(SequenceNode *body) {
     this->body = body;
+    this->nodes = nullptr;
+}
+
+ProgramNode::ProgramNode(SequenceNode *body, Arena *nodes) {
+    this->body = body;
+    this->nodes = nodes;
 }
 
 std::string ProgramNode::toString() {
@@ -208,19 +218,6 @@ std::string ProgramNode::toString() {
     return str;
 }
 
-unsigned long ProgramNode::getByteLength() {
-    return this->body->getByteLength();
-}
-
-unsigned long ProgramNode::toBytes(void *buffer) {
-    return this->body->toBytes(buffer);
-}
-
-unsigned long ProgramNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType ProgramNode::getType() {
     return AstNode::NodeType::NODE_PROGRAM;
 }
@@ -234,7 +231,12 @@ bool ProgramNode::equalTo(AstNode *node) {
 }
 
 ProgramNode::~ProgramNode() {
-    delete this->body;
+    if (this->nodes != nullptr) {
+        // Nodes in arena don't delete their children, they are freed all at once
+        delete this->nodes;
+    } else {
+        delete this->body;
+    }
 }
 
 IfStatementNode::IfStatementNode(AstNode *condition, SequenceNode *ifBranch, SequenceNode *elseBranch) {
@@ -254,22 +256,6 @@ std::string IfStatementNode::toString() {
     return str;
 }
 
-unsigned long IfStatementNode::getByteLength() {
-    return this->condition->getByteLength() + this->ifBranch->getByteLength() + this->elseBranch->getByteLength();
-}
-
-unsigned long IfStatementNode::toBytes(void *buffer) {
-    unsigned long offset = this->condition->toBytes(buffer);
-    offset += this->ifBranch->toBytes((char *)buffer + offset);
-    offset += this->elseBranch->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long IfStatementNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType IfStatementNode::getType() {
     return AstNode::NodeType::NODE_IF_STATEMENT;
 }
@@ -310,21 +296,6 @@ std::string WhileStatementNode::toString() {
     return str;
 }
 
-unsigned long WhileStatementNode::getByteLength() {
-    return this->condition->getByteLength() + this->body->getByteLength();
-}
-
-unsigned long WhileStatementNode::toBytes(void *buffer) {
-    unsigned long offset = this->condition->toBytes(buffer);
-    offset += this->body->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long WhileStatementNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType WhileStatementNode::getType() {
     return AstNode::NodeType::NODE_WHILE_STATEMENT;
 }
@@ -366,27 +337,6 @@ std::string ForStatementNode::toString() {
     return str;
 }
 
-unsigned long ForStatementNode::getByteLength() {
-    unsigned long length = this->condition->getByteLength();
-    length += this->initializationBody->getByteLength();
-    length += this->incrementBody->getByteLength();
-    length += this->body->getByteLength();
-    return length;
-}
-
-unsigned long ForStatementNode::toBytes(void *buffer) {
-    unsigned long offset = this->condition->toBytes(buffer);
-    offset += this->initializationBody->toBytes((char *)buffer + offset);
-    offset += this->incrementBody->toBytes((char *)buffer + offset);
-    offset += this->body->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long ForStatementNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType ForStatementNode::getType() {
     return AstNode::NodeType::NODE_FOR_STATEMENT;
 }
@@ -418,43 +368,30 @@ ForStatementNode::~ForStatementNode() {
     delete this->body;
 }
 
-VariableAssignmentNode::VariableAssignmentNode(std::string name, AstNode *value) {
+VariableAssignmentNode::VariableAssignmentNode(const SymbolTable *symbols, Symbol name, AstNode *value) {
+    this->symbols = symbols;
     this->name = name;
     this->value = value;
 }
 
 std::string VariableAssignmentNode::toString() {
     std::string str = "<VariableAssignmentNode name=";
-    str += this->name;
+    str += this->getName();
     str += ", value=";
     str += this->value->toString();
     str += ">";
     return str;
 }
 
-unsigned long VariableAssignmentNode::getByteLength() {
-    return sizeof(unsigned int) + this->name.size() + this->value->getByteLength();
-}
-
-unsigned long VariableAssignmentNode::toBytes(void *buffer) {
-    *((unsigned int *)buffer) = this->name.size();
-    unsigned long offset = sizeof(unsigned int);
-    memcpy((char *)buffer + offset, this->name.c_str(), this->name.size());
-    offset += this->name.size();
-    offset += this->value->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long VariableAssignmentNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType VariableAssignmentNode::getType() {
     return AstNode::NodeType::NODE_VARIABLE_ASSIGNMENT;
 }
 
-std::string VariableAssignmentNode::getName() {
+std::string_view VariableAssignmentNode::getName() {
+    return this->symbols->getName(this->name);
+}
+
+Symbol VariableAssignmentNode::getSymbol() {
     return this->name;
 }
 
@@ -463,7 +400,9 @@ AstNode *VariableAssignmentNode::getValue() {
 }
 
 bool VariableAssignmentNode::equalTo(AstNode *node) {
-    return this->name == static_cast<VariableAssignmentNode *>(node)->name && this->value->equals(static_cast<VariableAssignmentNode *>(node)->getValue());
+    VariableAssignmentNode *assignment = static_cast<VariableAssignmentNode *>(node);
+    bool sameName = this->symbols == assignment->symbols ? this->name == assignment->name : this->getName() == assignment->getName();
+    return sameName && this->value->equals(assignment->getValue());
 }
 
 VariableAssignmentNode::~VariableAssignmentNode() {
@@ -476,12 +415,11 @@ ListDefinitionNode::ListDefinitionNode(SequenceNode *array) {
 
 std::string ListDefinitionNode::toString() {
     std::string str = "<ListDefinitionNode: [";
-    std::vector<AstNode *> args = this->array->getSequence();
 
-    for (auto itr = args.cbegin(); itr != args.cend(); ++itr) {
+    for (auto itr = this->array->begin(); itr != this->array->end(); ++itr) {
         str += (*itr)->toString();
 
-        if (itr + 1 != args.cend()) {
+        if (itr + 1 != this->array->end()) {
             str += ", ";
         }
     }
@@ -489,18 +427,6 @@ std::string ListDefinitionNode::toString() {
     return str + "]>";
 }
 
-unsigned long ListDefinitionNode::getByteLength() {
-    return this->array->getByteLength();
-}
-
-unsigned long ListDefinitionNode::toBytes(void *buffer) {
-    return this->array->toBytes(buffer);
-}
-
-unsigned long ListDefinitionNode::fromBytes(void *buffer) {
-    return this->array->fromBytes(buffer);
-}
-
 AstNode::NodeType ListDefinitionNode::getType() {
     return AstNode::NodeType::NODE_LIST_DEFINITION;
 }
@@ -526,24 +452,6 @@ std::string ListSliceNode::toString() {
     return "<ListSliceNode array=" + this->array->toString() + ", value=" + this->value->toString() + ">";
 }
 
-unsigned long ListSliceNode::getByteLength() {
-    return this->array->getByteLength() + this->value->getByteLength();
-}
-
-unsigned long ListSliceNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->array->toBytes(buffer);
-    offset += this->value->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long ListSliceNode::fromBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->array->fromBytes(buffer);
-    offset += this->value->fromBytes((char *)buffer + offset);
-    return offset;
-}
-
 AstNode::NodeType ListSliceNode::getType() {
     return AstNode::NodeType::NODE_LIST_SLICE;
 }
@@ -565,39 +473,30 @@ ListSliceNode::~ListSliceNode() {
     delete this->value;
 }
 
-VariableReferenceNode::VariableReferenceNode(std::string name) {
+VariableReferenceNode::VariableReferenceNode(const SymbolTable *symbols, Symbol name) {
+    this->symbols = symbols;
     this->name = name;
 }
 
 std::string VariableReferenceNode::toString() {
-    return "<VariableReferenceNode name=\"" + this->name + "\">";
-}
-
-unsigned long VariableReferenceNode::getByteLength() {
-    return sizeof(unsigned int) + this->name.size();
-}
-
-unsigned long VariableReferenceNode::toBytes(void *buffer) {
-    *((unsigned int *)buffer) = this->name.size();
-    std::memcpy(buffer, this->name.c_str(), this->name.size());
-    return this->name.size();
-}
-
-unsigned long VariableReferenceNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw new std::exception(); // not implemented
+    return "<VariableReferenceNode name=\"" + std::string(this->getName()) + "\">";
 }
 
 AstNode::NodeType VariableReferenceNode::getType() {
     return AstNode::NodeType::NODE_VARIABLE_REFERENCE;
 }
 
-std::string VariableReferenceNode::getName() {
+std::string_view VariableReferenceNode::getName() {
+    return this->symbols->getName(this->name);
+}
+
+Symbol VariableReferenceNode::getSymbol() {
     return this->name;
 }
 
 bool VariableReferenceNode::equalTo(AstNode *node) {
-    return this->name == static_cast<VariableReferenceNode *>(node)->name;
+    VariableReferenceNode *reference = static_cast<VariableReferenceNode *>(node);
+    return this->symbols == reference->symbols ? this->name == reference->name : this->getName() == reference->getName();
 }
 
 VariableReferenceNode::~VariableReferenceNode() {}
@@ -616,22 +515,6 @@ std::string OperationAddNode::toString() {
     return str;
 }
 
-unsigned long OperationAddNode::getByteLength() {
-    return this->left->getByteLength() + this->right->getByteLength();
-}
-
-unsigned long OperationAddNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->left->toBytes((char *)buffer + offset);
-    offset += this->right->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long OperationAddNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType OperationAddNode::getType() {
     return AstNode::NodeType::NODE_OPERATION_ADD;
 }
@@ -667,24 +550,8 @@ std::string OperationSubtractNode::toString() {
     return str;
 }
 
-unsigned long OperationSubtractNode::getByteLength() {
-    return this->left->getByteLength() + this->right->getByteLength();
-}
-
-unsigned long OperationSubtractNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->left->toBytes((char *)buffer + offset);
-    offset += this->right->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long OperationSubtractNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType OperationSubtractNode::getType() {
-    return AstNode::NodeType::NODE_OPERATION_ADD;
+    return AstNode::NodeType::NODE_OPERATION_SUBTRACT;
 }
 
 AstNode *OperationSubtractNode::getLeft() {
@@ -718,24 +585,8 @@ std::string OperationMultiplyNode::toString() {
     return str;
 }
 
-unsigned long OperationMultiplyNode::getByteLength() {
-    return this->left->getByteLength() + this->right->getByteLength();
-}
-
-unsigned long OperationMultiplyNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->left->toBytes((char *)buffer + offset);
-    offset += this->right->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long OperationMultiplyNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType OperationMultiplyNode::getType() {
-    return AstNode::NodeType::NODE_OPERATION_ADD;
+    return AstNode::NodeType::NODE_OPERATION_MULTIPLY;
 }
 
 AstNode *OperationMultiplyNode::getLeft() {
@@ -769,24 +620,8 @@ std::string OperationDivideNode::toString() {
     return str;
 }
 
-unsigned long OperationDivideNode::getByteLength() {
-    return this->left->getByteLength() + this->right->getByteLength();
-}
-
-unsigned long OperationDivideNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->left->toBytes((char *)buffer + offset);
-    offset += this->right->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long OperationDivideNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType OperationDivideNode::getType() {
-    return AstNode::NodeType::NODE_OPERATION_ADD;
+    return AstNode::NodeType::NODE_OPERATION_DIVIDE;
 }
 
 AstNode *OperationDivideNode::getLeft() {
@@ -820,24 +655,8 @@ std::string OperationModNode::toString() {
     return str;
 }
 
-unsigned long OperationModNode::getByteLength() {
-    return this->left->getByteLength() + this->right->getByteLength();
-}
-
-unsigned long OperationModNode::toBytes(void *buffer) {
-    unsigned long offset = 0;
-    offset += this->left->toBytes((char *)buffer + offset);
-    offset += this->right->toBytes((char *)buffer + offset);
-    return offset;
-}
-
-unsigned long OperationModNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType OperationModNode::getType() {
-    return AstNode::NodeType::NODE_OPERATION_ADD;
+    return AstNode::NodeType::NODE_OPERATION_MOD;
 }
 
 AstNode *OperationModNode::getLeft() {
@@ -857,29 +676,249 @@ OperationModNode::~OperationModNode() {
     delete this->right;
 }
 
-IntConstantNode::IntConstantNode(long long value) {
-    this->value = value;
+OperationEqualNode::OperationEqualNode(AstNode *left, AstNode *right) {
+    this->left = left;
+    this->right = right;
 }
 
-std::string IntConstantNode::toString() {
-    std::string str = "<IntConstantNode value=";
-    str += std::to_string(this->value);
+std::string OperationEqualNode::toString() {
+    std::string str = "<OperationEqualNode left=";
+    str += this->left->toString();
+    str += ", right=";
+    str += this->right->toString();
+    str += ">";
+    return str;
+}
+
+AstNode::NodeType OperationEqualNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_EQUAL;
+}
+
+AstNode *OperationEqualNode::getLeft() {
+    return this->left;
+}
+
+AstNode *OperationEqualNode::getRight() {
+    return this->right;
+}
+
+bool OperationEqualNode::equalTo(AstNode *node) {
+    return this->left->equals(static_cast<OperationEqualNode *>(node)->left) && this->right->equals(static_cast<OperationEqualNode *>(node)->right);
+}
+
+OperationEqualNode::~OperationEqualNode() {
+    delete this->left;
+    delete this->right;
+}
+
+OperationNotEqualNode::OperationNotEqualNode(AstNode *left, AstNode *right) {
+    this->left = left;
+    this->right = right;
+}
+
+std::string OperationNotEqualNode::toString() {
+    std::string str = "<OperationNotEqualNode left=";
+    str += this->left->toString();
+    str += ", right=";
+    str += this->right->toString();
+    str += ">";
+    return str;
+}
+
+AstNode::NodeType OperationNotEqualNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_NOT_EQUAL;
+}
+
+AstNode *OperationNotEqualNode::getLeft() {
+    return this->left;
+}
+
+AstNode *OperationNotEqualNode::getRight() {
+    return this->right;
+}
+
+bool OperationNotEqualNode::equalTo(AstNode *node) {
+    return this->left->equals(static_cast<OperationNotEqualNode *>(node)->left) && this->right->equals(static_cast<OperationNotEqualNode *>(node)->right);
+}
+
+OperationNotEqualNode::~OperationNotEqualNode() {
+    delete this->left;
+    delete this->right;
+}
+
+OperationLessNode::OperationLessNode(AstNode *left, AstNode *right) {
+    this->left = left;
+    this->right = right;
+}
+
+std::string OperationLessNode::toString() {
+    std::string str = "<OperationLessNode left=";
+    str += this->left->toString();
+    str += ", right=";
+    str += this->right->toString();
+    str += ">";
+    return str;
+}
+
+AstNode::NodeType OperationLessNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_LESS;
+}
+
+AstNode *OperationLessNode::getLeft() {
+    return this->left;
+}
+
+AstNode *OperationLessNode::getRight() {
+    return this->right;
+}
+
+bool OperationLessNode::equalTo(AstNode *node) {
+    return this->left->equals(static_cast<OperationLessNode *>(node)->left) && this->right->equals(static_cast<OperationLessNode *>(node)->right);
+}
+
+OperationLessNode::~OperationLessNode() {
+    delete this->left;
+    delete this->right;
+}
+
+OperationLessEqualNode::OperationLessEqualNode(AstNode *left, AstNode *right) {
+    this->left = left;
+    this->right = right;
+}
+
+std::string OperationLessEqualNode::toString() {
+    std::string str = "<OperationLessEqualNode left=";
+    str += this->left->toString();
+    str += ", right=";
+    str += this->right->toString();
+    str += ">";
+    return str;
+}
+
+AstNode::NodeType OperationLessEqualNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_LESS_EQUAL;
+}
+
+AstNode *OperationLessEqualNode::getLeft() {
+    return this->left;
+}
+
+AstNode *OperationLessEqualNode::getRight() {
+    return this->right;
+}
+
+bool OperationLessEqualNode::equalTo(AstNode *node) {
+    return this->left->equals(static_cast<OperationLessEqualNode *>(node)->left) && this->right->equals(static_cast<OperationLessEqualNode *>(node)->right);
+}
+
+OperationLessEqualNode::~OperationLessEqualNode() {
+    delete this->left;
+    delete this->right;
+}
+
+OperationGreaterNode::OperationGreaterNode(AstNode *left, AstNode *right) {
+    this->left = left;
+    this->right = right;
+}
+
+std::string OperationGreaterNode::toString() {
+    std::string str = "<OperationGreaterNode left=";
+    str += this->left->toString();
+    str += ", right=";
+    str += this->right->toString();
     str += ">";
     return str;
 }
 
-unsigned long IntConstantNode::getByteLength() {
-    return sizeof(unsigned long long);
+AstNode::NodeType OperationGreaterNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_GREATER;
+}
+
+AstNode *OperationGreaterNode::getLeft() {
+    return this->left;
+}
+
+AstNode *OperationGreaterNode::getRight() {
+    return this->right;
 }
 
-unsigned long IntConstantNode::toBytes(void *buffer) {
-    *((unsigned long long *)buffer) = this->value;
-    return sizeof(unsigned long long);
+bool OperationGreaterNode::equalTo(AstNode *node) {
+    return this->left->equals(static_cast<OperationGreaterNode *>(node)->left) && this->right->equals(static_cast<OperationGreaterNode *>(node)->right);
 }
 
-unsigned long IntConstantNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
+OperationGreaterNode::~OperationGreaterNode() {
+    delete this->left;
+    delete this->right;
+}
+
+OperationGreaterEqualNode::OperationGreaterEqualNode(AstNode *left, AstNode *right) {
+    this->left = left;
+    this->right = right;
+}
+
+std::string OperationGreaterEqualNode::toString() {
+    std::string str = "<OperationGreaterEqualNode left=";
+    str += this->left->toString();
+    str += ", right=";
+    str += this->right->toString();
+    str += ">";
+    return str;
+}
+
+AstNode::NodeType OperationGreaterEqualNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL;
+}
+
+AstNode *OperationGreaterEqualNode::getLeft() {
+    return this->left;
+}
+
+AstNode *OperationGreaterEqualNode::getRight() {
+    return this->right;
+}
+
+bool OperationGreaterEqualNode::equalTo(AstNode *node) {
+    return this->left->equals(static_cast<OperationGreaterEqualNode *>(node)->left) && this->right->equals(static_cast<OperationGreaterEqualNode *>(node)->right);
+}
+
+OperationGreaterEqualNode::~OperationGreaterEqualNode() {
+    delete this->left;
+    delete this->right;
+}
+
+OperationNegateNode::OperationNegateNode(AstNode *value) {
+    this->value = value;
+}
+
+std::string OperationNegateNode::toString() {
+    return "<OperationNegateNode value=" + this->value->toString() + ">";
+}
+
+AstNode::NodeType OperationNegateNode::getType() {
+    return AstNode::NodeType::NODE_OPERATION_NEGATE;
+}
+
+AstNode *OperationNegateNode::getValue() {
+    return this->value;
+}
+
+bool OperationNegateNode::equalTo(AstNode *node) {
+    return this->value->equals(static_cast<OperationNegateNode *>(node)->value);
+}
+
+OperationNegateNode::~OperationNegateNode() {
+    delete this->value;
+}
+
+IntConstantNode::IntConstantNode(long long value) {
+    this->value = value;
+}
+
+std::string IntConstantNode::toString() {
+    std::string str = "<IntConstantNode value=";
+    str += std::to_string(this->value);
+    str += ">";
+    return str;
 }
 
 AstNode::NodeType IntConstantNode::getType() {
@@ -907,20 +946,6 @@ std::string FloatConstantNode::toString() {
     return str;
 }
 
-unsigned long FloatConstantNode::getByteLength() {
-    return sizeof(double);
-}
-
-unsigned long FloatConstantNode::toBytes(void *buffer) {
-    *((double *)buffer) = this->value;
-    return sizeof(double);
-}
-
-unsigned long FloatConstantNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType FloatConstantNode::getType() {
     return AstNode::NodeType::NODE_FLOAT_CONSTANT;
 }
@@ -935,41 +960,33 @@ bool FloatConstantNode::equalTo(AstNode *node) {
 
 FloatConstantNode::~FloatConstantNode() {}
 
-StringConstantNode::StringConstantNode(std::string value) {
+StringConstantNode::StringConstantNode(const SymbolTable *symbols, Symbol value) {
+    this->symbols = symbols;
     this->value = value;
 }
 
 std::string StringConstantNode::toString() {
     std::string str = "<StringConstantNode value=\"";
-    str += this->value;
+    str += this->getValue();
     str += "\">";
     return str;
 }
 
-unsigned long StringConstantNode::getByteLength() {
-    return this->value.size();
-}
-
-unsigned long StringConstantNode::toBytes(void *buffer) {
-    memcpy(buffer, this->value.c_str(), this->value.size());
-    return this->value.size();
-}
-
-unsigned long StringConstantNode::fromBytes(void *buffer) {
-    (void)buffer;
-    throw std::exception(); // Not implemented yet
-}
-
 AstNode::NodeType StringConstantNode::getType() {
     return AstNode::NodeType::NODE_STRING_CONSTANT;
 }
 
-std::string StringConstantNode::getValue() {
+std::string_view StringConstantNode::getValue() {
+    return this->symbols->getName(this->value);
+}
+
+Symbol StringConstantNode::getSymbol() {
     return this->value;
 }
 
 bool StringConstantNode::equalTo(AstNode *node) {
-    return this->value == static_cast<StringConstantNode *>(node)->getValue();
+    StringConstantNode *constant = static_cast<StringConstantNode *>(node);
+    return this->symbols == constant->symbols ? this->value == constant->value : this->getValue() == constant->getValue();
 }
 
 StringConstantNode::~StringConstantNode() {}
@@ -978,6 +995,158 @@ ParserException::ParserException(std::string message) {
     this->message = message;
 }
 
+ParserException::ParserException(std::string message, unsigned long offset) {
+    this->message = message;
+    this->offset = offset;
+}
+
+TokenWindow::TokenWindow(std::vector<Token> &&tokens) {
+    this->tokens = std::move(tokens);
+    this->lexer = nullptr;
+    this->first = 0;
+    this->head = 0;
+    this->count = this->tokens.size();
+    this->packed = nullptr;
+    this->unpackedIndex = ULONG_MAX;
+}
+
+TokenWindow::TokenWindow(Lexer *lexer, unsigned long capacity) {
+    this->tokens.resize(capacity > 0 ? capacity : 1);
+    this->contents.resize(this->tokens.size());
+    this->lexer = lexer;
+    this->first = 0;
+    this->head = 0;
+    this->count = 0;
+    this->packed = nullptr;
+    this->unpackedIndex = ULONG_MAX;
+}
+
+TokenWindow::TokenWindow(PackedTokens *tokens) : TokenWindow(std::vector<Token>()) {
+    this->packed = tokens;
+}
+
+bool TokenWindow::has(unsigned long index) {
+    if (this->packed != nullptr) {
+        return index < this->packed->size();
+    }
+
+    while (index >= this->first + this->count) {
+        if (!this->pull()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Token &TokenWindow::at(unsigned long index) {
+    if (index < this->first) {
+        throw new ParserException("Token is already released");
+    }
+
+    if (!this->has(index)) {
+        throw new ParserException("Unexpected end of program");
+    }
+
+    if (this->packed != nullptr) {
+        if (this->unpackedIndex != index) {
+            this->unpacked = this->packed->get(index);
+            this->unpackedIndex = index;
+        }
+
+        return this->unpacked;
+    }
+
+    unsigned long slot = this->head + (index - this->first);
+
+    if (slot >= this->tokens.size()) {
+        slot -= this->tokens.size();
+    }
+
+    return this->tokens[slot];
+}
+
+void TokenWindow::release(unsigned long index) {
+    if (this->lexer == nullptr || index <= this->first) {
+        return;
+    }
+
+    unsigned long released = std::min(index - this->first, this->count);
+    this->head = (this->head + released) % this->tokens.size();
+    this->first += released;
+    this->count -= released;
+}
+
+unsigned long TokenWindow::getCapacity() {
+    return this->tokens.size();
+}
+
+bool TokenWindow::pull() {
+    if (this->lexer == nullptr) {
+        return false;
+    }
+
+    std::optional<Token> token = this->lexer->next();
+
+    if (!token.has_value()) {
+        return false;
+    }
+
+    if (token->type == TokenType::LEXER_ERROR) {
+        throw new ParserException(token->to_string(this->lexer->locate(token->offset)));
+    }
+
+    if (this->count == this->tokens.size()) {
+        this->grow();
+    }
+
+    unsigned long slot = (this->head + this->count) % this->tokens.size();
+    this->tokens[slot] = *token;
+
+    if (token->symbol != NO_SYMBOL) {
+        // Interned content lives in symbol table, so it isn't copied
+        this->tokens[slot].content = this->lexer->getSymbols()->getName(token->symbol);
+    } else {
+        // Capacity of string is reused, so copying content rarely allocates
+        std::string &content = this->contents[slot];
+        content.assign(token->content.data(), token->content.size());
+        this->tokens[slot].content = content;
+    }
+    ++this->count;
+    return true;
+}
+
+/**
+ * Statement doesn't fit into ring, so ring is doubled and unrolled.
+ */
+void TokenWindow::grow() {
+    unsigned long capacity = this->tokens.size() * 2;
+    std::vector<Token> tokens;
+    std::vector<std::string> contents;
+    tokens.reserve(capacity);
+    contents.reserve(capacity);
+
+    for (unsigned long i = 0; i < this->count; i++) {
+        unsigned long slot = (this->head + i) % this->tokens.size();
+        tokens.push_back(this->tokens[slot]);
+        contents.push_back(std::move(this->contents[slot]));
+    }
+
+    tokens.resize(capacity);
+    contents.resize(capacity);
+
+    // Short strings keep chars inside of themselves, so moved contents are pointed again
+    for (unsigned long i = 0; i < this->count; i++) {
+        if (tokens[i].symbol == NO_SYMBOL) {
+            tokens[i].content = contents[i];
+        }
+    }
+
+    this->tokens = std::move(tokens);
+    this->contents = std::move(contents);
+    this->head = 0;
+}
+
 /*
     (1 + 2 + 3 * 4 + 5) + 8 % funcName()
     parseExpression()
@@ -1123,49 +1292,147 @@ parse(tokens)
                             parseTerm()
                                 # Simple int constant, returning IntConstantValue(2)
                         # Returning ArraySliceNode("array", IntConstantValue(2))
-                    # Next token is math operator, so
-                    # Parse everything in between all math operators, the most left is already parsed
-                    parseTerm()
-                        # Found int constant, so returing IntConstantValue(1)
-                    # Now get priorities by operators
-                    getPriorities()
-                        # Return values: [ArraySliceNode("array", IntConstantValue(2)), IntConstantValue(1)]
-                        # Return operators: [PrioritizedOperator("+", 1)]
-                    parseMath(values, operators)
-                        # Max. priority operator is '+', so
-                        # Add token OperationAddNode(ArraySliceNode("array", IntConstantValue(2)), IntConstantValue(1))
-                        # No more operators left, return OperationAddNode(ArraySliceNode("array", IntConstantValue(2)), IntConstantValue(1))
+                    # Next token is math operator '+', its priority isn't less than minimal, so
+                    # Parse right operand, taking only operators with higher priority
+                    parseOperation(priority('+') + 1)
+                        parseTerm()
+                            # Found int constant, so returing IntConstantValue(1)
+                        # No more operators, return IntConstantValue(1)
+                    # Left operand becomes OperationAddNode(ArraySliceNode("array", IntConstantValue(2)), IntConstantValue(1))
+                    # No more operators left, return it
             # Return value: OperationAddNode(ArraySliceNode("array", IntConstantValue(2)), IntConstantValue(1))
 */
-Parser::Parser(std::vector<Token> tokens) {
-    this->tokens = tokens;
+namespace {
+
+/**
+ * Numbers are parsed from token content in place, without copying it into
+    string. Out of range numbers are saturated by strtoll() and strtod().
+ */
+long long parseInt(std::string_view content) {
+    long long value;
+
+    if (std::from_chars(content.data(), content.data() + content.size(), value).ec == std::errc()) {
+        return value;
+    }
+
+    return std::strtoll(std::string(content).c_str(), nullptr, 10);
+}
+
+double parseFloat(std::string_view content) {
+    double value;
+
+    if (std::from_chars(content.data(), content.data() + content.size(), value).ec == std::errc()) {
+        return value;
+    }
+
+    return std::strtod(std::string(content).c_str(), nullptr);
+}
+
+}
+
+Parser::Parser(std::vector<Token> &&tokens, SymbolTable *symbols) : tokens(std::move(tokens)), symbols(symbols) {}
+
+Parser::Parser(Lexer *lexer, SymbolTable *symbols) : tokens(lexer), symbols(symbols) {
+    lexer->setSymbols(symbols);
+}
+
+Parser::Parser(PackedTokens *tokens, SymbolTable *symbols) : tokens(tokens), symbols(symbols) {}
+
+/**
+ * Symbol of IDENTIFIER or STRING token. Tokens, which weren't interned by
+    lexer, are interned here.
+ */
+Symbol Parser::intern(const Token &token) {
+    return token.symbol != NO_SYMBOL ? token.symbol : this->symbols->intern(token.content);
+}
+
+void Parser::setArena(bool useArena) {
+    this->useArena = useArena;
+}
+
+template<typename T, typename... Args>
+T *Parser::create(Args &&...args) {
+    if (this->nodes != nullptr) {
+        return this->nodes->make<T>(std::forward<Args>(args)...);
+    }
+
+    return new T(std::forward<Args>(args)...);
+}
+
+SequenceNode *Parser::createSequence(unsigned long start) {
+    unsigned long count = this->pending.size() - start;
+    SequenceNode *sequence;
+
+    if (this->nodes == nullptr) {
+        AstNode **array = new AstNode *[count];
+        std::copy(this->pending.begin() + start, this->pending.end(), array);
+        sequence = new SequenceNode(array, count);
+    } else {
+        AstNode **array = (AstNode **)this->nodes->allocate(count * sizeof(AstNode *), alignof(AstNode *));
+        std::copy(this->pending.begin() + start, this->pending.end(), array);
+        sequence = this->nodes->make<SequenceNode>(array, count);
+    }
+
+    this->pending.resize(start);
+    return sequence;
 }
 
 ProgramNode *Parser::parse() {
-    return new ProgramNode(std::get<0>(this->parseSequence(0, TokenType::PROGRAM_START)));
+    // Nodes, left by failed parse, aren't pending anymore
+    this->pending.clear();
+
+    if (!this->useArena) {
+        return new ProgramNode(std::get<0>(this->parseSequence(0, TokenType::PROGRAM_START)));
+    }
+
+    this->nodes = new Arena(Parser::NODE_CHUNK_SIZE);
+
+    try {
+        SequenceNode *body = std::get<0>(this->parseSequence(0, TokenType::PROGRAM_START));
+        ProgramNode *program = new ProgramNode(body, this->nodes);
+        this->nodes = nullptr;
+        return program;
+    } catch (...) {
+        // Nodes of unfinished program are freed with arena
+        delete this->nodes;
+        this->nodes = nullptr;
+        throw;
+    }
+}
+
+FlatAst *Parser::parseFlat() {
+    ProgramNode *program = this->parse();
+    FlatAst *flat = new FlatAst(this->symbols, program);
+    delete program;
+    return flat;
 }
 
 std::tuple<SequenceNode *, unsigned long> Parser::parseSequence(unsigned long index, TokenType stop) {
-    if (this->tokens.size() <= index) {
+    if (!this->tokens.has(index)) {
         throw new ParserException("Index is bigger than tokens length");
     }
 
     unsigned long length = 0;
-    std::vector<AstNode *> nodes;
+    unsigned long start = this->pending.size();
 
-    while (index < this->tokens.size()) {
-        if (this->tokens[index].type == stop) {
-            return { new SequenceNode(nodes), length };
+    while (this->tokens.has(index)) {
+        if (this->tokens.at(index).type == stop) {
+            return { this->createSequence(start), length };
         }
 
         std::tuple<AstNode *, unsigned long> statement = this->parseStatement(index);
-        nodes.push_back(std::get<0>(statement));
+        this->pending.push_back(std::get<0>(statement));
         unsigned long statementLength = std::get<1>(statement);
         index += statementLength;
         length += statementLength;
+
+        if (stop == TokenType::PROGRAM_START) {
+            // Top-level statement is parsed, so its tokens aren't needed anymore
+            this->tokens.release(index);
+        }
     }
 
-    return { new SequenceNode(nodes), length };
+    return { this->createSequence(start), length };
 }
 
 // (nullptr, 0) = ParserError
@@ -1175,7 +1442,7 @@ std::tuple<AstNode *, unsigned long> Parser::parseStatement(unsigned long index)
     Result may be used in that statement (ex. function call, var assign, etc.).
     But now, we can simply omit it, to increase lang performance.
     */
-    Token *token = &this->tokens[index]; // Take address as optimization
+    Token *token = &this->tokens.at(index); // Take address as optimization
 
     switch ((unsigned char)token->type) {
         case TokenType::FLOAT_NUMBER:
@@ -1193,184 +1460,144 @@ std::tuple<AstNode *, unsigned long> Parser::parseStatement(unsigned long index)
         }
 
         case TokenType::IDENTIFIER: {
-            Token *nextToken = &this->tokens[index + 1];
+            Token *nextToken = &this->tokens.at(index + 1);
 
             if (nextToken->type == TokenType::LPAREN) {
                 return parseFunctionCall(index);
-            } else if (nextToken->type == TokenType::OPERATOR && nextToken->content == "=") {
+            } else if (nextToken->oper == Operator::OPERATOR_ASSIGN) {
                 std::tuple<AstNode *, unsigned long> expr = parseExpression(index + 2);
-                return { new VariableAssignmentNode(token->content, std::get<0>(expr)), 2 + std::get<1>(expr) };
+                // Token is taken again, because pulling more tokens may move it
+                return { this->create<VariableAssignmentNode>(this->symbols, this->intern(this->tokens.at(index)), std::get<0>(expr)), 2 + std::get<1>(expr) };
             }
 
             break;
         }
 
         case TokenType::KEYWORD: {
-            if (token->content == "if") {
-                if (this->tokens[index + 1].type != TokenType::LPAREN) {
-                    throw new ParserException("Expected left parentheses ('(')");
+            if (token->keyword == Keyword::KEYWORD_IF) {
+                if (this->tokens.at(index + 1).type != TokenType::LPAREN) {
+                    throw new ParserException("Expected left parentheses ('(')", this->tokens.at(index + 1).offset);
                 }
 
                 std::tuple<AstNode *, unsigned long> condition = parseExpression(index + 2);
                 unsigned long length = std::get<1>(condition) + 1;
 
-                if (this->tokens[index + length + 2].type != TokenType::LBRACE) {
-                    throw new ParserException("Expected left brace ('{')");
+                if (this->tokens.at(index + length + 2).type != TokenType::LBRACE) {
+                    throw new ParserException("Expected left brace ('{')", this->tokens.at(index + length + 2).offset);
                 }
 
                 std::tuple<SequenceNode *, unsigned long> ifBranch = parseSequence(index + length + 3, TokenType::RBRACE);
                 length += 2 + std::get<1>(ifBranch) + 2;
 
-                if (index + length + 2 >= this->tokens.size()) {
-                    return { new IfStatementNode(std::get<0>(condition), std::get<0>(ifBranch), new SequenceNode({})), length };
+                if (!this->tokens.has(index + length + 2)) {
+                    return { this->create<IfStatementNode>(std::get<0>(condition), std::get<0>(ifBranch), this->createSequence(this->pending.size())), length };
                 }
 
-                Token *elseToken = &this->tokens[index + length];
+                Token *elseToken = &this->tokens.at(index + length);
 
-                if (elseToken->type == TokenType::KEYWORD && elseToken->content == "else") {
-                    if (this->tokens[index + length + 1].type == TokenType::KEYWORD && this->tokens[index + length + 1].content == "if") {
+                if (elseToken->keyword == Keyword::KEYWORD_ELSE) {
+                    if (this->tokens.at(index + length + 1).keyword == Keyword::KEYWORD_IF) {
                         std::tuple<AstNode *, unsigned long> elseStatement = this->parseStatement(index + length + 1);
                         length += 1 + std::get<1>(elseStatement);
-                        std::vector<AstNode *> nodes;
-                        nodes.push_back(std::get<0>(elseStatement));
-                        return { new IfStatementNode(std::get<0>(condition), std::get<0>(ifBranch), new SequenceNode(nodes)), length }; // FIXME: mb + 1? and mb + 1 + 2?
+                        this->pending.push_back(std::get<0>(elseStatement));
+                        return { this->create<IfStatementNode>(std::get<0>(condition), std::get<0>(ifBranch), this->createSequence(this->pending.size() - 1)), length }; // FIXME: mb + 1? and mb + 1 + 2?
                     }
 
                     std::tuple<SequenceNode *, unsigned long> elseSequence = this->parseSequence(index + length + 2, TokenType::RBRACE);
                     length += 3 + std::get<1>(elseSequence);
-                    return { new IfStatementNode(std::get<0>(condition), std::get<0>(ifBranch), std::get<0>(elseSequence)), length };
+                    return { this->create<IfStatementNode>(std::get<0>(condition), std::get<0>(ifBranch), std::get<0>(elseSequence)), length };
                 }
 
-                return { new IfStatementNode(std::get<0>(condition), std::get<0>(ifBranch), nullptr), length };
+                return { this->create<IfStatementNode>(std::get<0>(condition), std::get<0>(ifBranch), nullptr), length };
             }
         }
     }
 
-    throw new ParserException("Invalid statement start");
+    throw new ParserException("Invalid statement start", this->tokens.at(index).offset);
 }
 
 std::tuple<ListDefinitionNode *, unsigned long> Parser::parseListDefinition(unsigned long index) {
     std::tuple<SequenceNode *, unsigned long> sequence = this->parseEnclosed(index + 1, TokenType::RBRACKET);
-    return { new ListDefinitionNode(std::get<0>(sequence)), std::get<1>(sequence) + 1 };
+    return { this->create<ListDefinitionNode>(std::get<0>(sequence)), std::get<1>(sequence) + 1 };
 }
 
 std::tuple<AstNode *, unsigned long> Parser::parseExpression(unsigned long index) {
-    std::tuple<AstNode *, unsigned long> leftTerm = Parser::parseTerm(index);
-    unsigned long termTokensLength = std::get<1>(leftTerm);
-    index += termTokensLength;
-    unsigned long length = termTokensLength;
-    AstNode *leftNode = std::get<0>(leftTerm);
-
-    if (index >= this->tokens.size()) {
-        return leftTerm;
-    }
-
-    if (this->tokens[index].type == TokenType::OPERATOR) {
-        if (this->tokens[index].content == "=") {
-            throw new ParserException("No assignment is allowed inside an expression");
-        }
+    return this->parseOperation(index, 0);
+}
 
-        std::vector<AstNode *> terms;
-        terms.push_back(leftNode);
-        std::vector<Token> unpriOperators;
+/**
+ * Precedence climbing: parses operand, then folds operators, which have at
+    least `minPriority`, into it from left to right. Right operand of each
+    operator takes only operators with higher priority, so each token is
+    visited once, and recursion depth is bounded by count of priorities, not
+    by length of expression.
+ */
+std::tuple<AstNode *, unsigned long> Parser::parseOperation(unsigned long index, unsigned short minPriority) {
+    std::tuple<AstNode *, unsigned long> operand = this->parseUnary(index);
+    AstNode *left = std::get<0>(operand);
+    unsigned long length = std::get<1>(operand);
 
-        for (unsigned long i = index; i < this->tokens.size(); i++, length++) {
-            if (this->tokens[i].type == TokenType::RPAREN || this->tokens[i].type == TokenType::RBRACKET || this->tokens[i].type == TokenType::RBRACE || this->tokens[i].type == ARG_SEPARATOR) {
-                break;
-            }
+    while (this->tokens.has(index + length) && this->tokens.at(index + length).type == TokenType::OPERATOR) {
+        const Token &token = this->tokens.at(index + length);
 
-            if (this->tokens[i].type == TokenType::OPERATOR) {
-                unpriOperators.push_back(this->tokens[i]);
-            } else {
-                std::tuple<AstNode *, unsigned long> term = this->parseTerm(i);
-                unsigned long tokensLength = std::get<1>(term) - 1; // - 1 because it will increment after "continue"
-                i += tokensLength;
-                length += tokensLength;
-                terms.push_back(std::get<0>(term));
-                continue;
-            }
+        if (token.oper == Operator::OPERATOR_ASSIGN) {
+            throw new ParserException("No assignment is allowed inside an expression", token.offset);
         }
 
-        if (terms.size() != unpriOperators.size() + 1) {
-            throw new ParserException("Invalid operators count");
-        }
+        PrioritizedOperator oper = Parser::getPriority(token);
 
-        std::vector<PrioritizedOperator> operators = getPriorities(unpriOperators);
+        if (oper.priority < minPriority) {
+            break;
+        }
 
-        while (operators.size() > 0) {
-            auto maxPriorityOper = operators.begin();
-            unsigned int i = 0;
-            unsigned short maxPriority = operators[0].priority;
-            unsigned int maxI = 0;
+        std::tuple<AstNode *, unsigned long> right = this->parseOperation(index + length + 1, oper.priority + 1);
+        left = this->createOperation(oper.type, left, std::get<0>(right));
+        length += 1 + std::get<1>(right);
+    }
 
-            for (auto itr = operators.begin(); itr != operators.end(); ++itr, i++) {
-                if (itr->priority > maxPriority) {
-                    maxPriorityOper = itr;
-                    maxPriority = itr->priority;
-                    maxI = i;
-                }
-            }
+    return { left, length };
+}
 
-            AstNode *newValue;
+std::tuple<AstNode *, unsigned long> Parser::parseUnary(unsigned long index) {
+    if (!this->tokens.has(index)) {
+        throw new ParserException("Expected operand, not program end");
+    }
 
-            switch (maxPriorityOper->type) {
-                case AstNode::NodeType::NODE_OPERATION_ADD: {
-                    newValue = new OperationAddNode(terms[maxI], terms[maxI + 1]);
-                    break;
-                }
-                case AstNode::NodeType::NODE_OPERATION_SUBTRACT: {
-                    newValue = new OperationSubtractNode(terms[maxI], terms[maxI + 1]);
-                    break;
-                }
-                case AstNode::NodeType::NODE_OPERATION_MULTIPLY: {
-                    newValue = new OperationMultiplyNode(terms[maxI], terms[maxI + 1]);
-                    break;
-                }
-                case AstNode::NodeType::NODE_OPERATION_DIVIDE: {
-                    newValue = new OperationDivideNode(terms[maxI], terms[maxI + 1]);
-                    break;
-                }
-                case AstNode::NodeType::NODE_OPERATION_MOD: {
-                    newValue = new OperationModNode(terms[maxI], terms[maxI + 1]);
-                    break;
-                }
-                default: {
-                    throw new ParserException("Unexpected operator type");
-                }
-            }
+    const Token &token = this->tokens.at(index);
 
-            operators.erase(maxPriorityOper);
-            terms[maxI] = newValue;
-            terms.erase(terms.begin() + maxI + 1);
-        }
+    if (token.type != TokenType::OPERATOR) {
+        return this->parseTerm(index);
+    }
 
-        return { terms[0], length };
+    if (token.oper != Operator::OPERATOR_SUBTRACT) {
+        throw new ParserException("Expected operand, not operator", token.offset);
     }
 
-    return { leftNode, length };
+    std::tuple<AstNode *, unsigned long> operand = this->parseUnary(index + 1);
+    return { this->create<OperationNegateNode>(std::get<0>(operand)), std::get<1>(operand) + 1 };
 }
 
 std::tuple<AstNode *, unsigned long> Parser::parseTerm(unsigned long index) {
     // TODO: ALL INDEX IN RETURNS MUST POINT TO NEXT TOKEN AFTER LAST PROCESSED
 
-    switch (this->tokens[index].type) {
+    switch (this->tokens.at(index).type) {
         case TokenType::LBRACKET: {
             std::tuple<ListDefinitionNode *, unsigned long> listDefinition = parseListDefinition(index);
             return listDefinition;
         }
         case TokenType::IDENTIFIER: {
-            if (this->tokens[index + 1].type == TokenType::LPAREN) {
+            if (this->tokens.at(index + 1).type == TokenType::LPAREN) {
                 std::tuple<FunctionCallNode *, unsigned long> functionCall = parseFunctionCall(index);
                 return functionCall;
             }
 
-            return { new VariableReferenceNode(this->tokens[index].content), 1 };
+            return { this->create<VariableReferenceNode>(this->symbols, this->intern(this->tokens.at(index))), 1 };
         }
         case TokenType::INT_NUMBER: {
-            return { new IntConstantNode(std::strtoll(this->tokens[index].content.c_str(), nullptr, 10)), 1 };
+            return { this->create<IntConstantNode>(parseInt(this->tokens.at(index).content)), 1 };
         }
         case TokenType::FLOAT_NUMBER: {
-            return { new FloatConstantNode(std::strtod(this->tokens[index].content.c_str(), nullptr)), 1 };
+            return { this->create<FloatConstantNode>(parseFloat(this->tokens.at(index).content)), 1 };
         }
         case TokenType::LPAREN: {
             std::tuple<AstNode *, unsigned long> expr = parseExpression(index + 1);
@@ -1378,10 +1605,10 @@ std::tuple<AstNode *, unsigned long> Parser::parseTerm(unsigned long index) {
             return { std::get<0>(expr), tokensLength + 2 };
         }
         case TokenType::STRING: {
-            return { new StringConstantNode(this->tokens[index].content), 1 };
+            return { this->create<StringConstantNode>(this->symbols, this->intern(this->tokens.at(index))), 1 };
         }
         default: {
-            throw new ParserException("Unexpected token, while parsing term");
+            throw new ParserException("Unexpected token, while parsing term", this->tokens.at(index).offset);
         }
     }
 
@@ -1389,35 +1616,35 @@ std::tuple<AstNode *, unsigned long> Parser::parseTerm(unsigned long index) {
 }
 
 std::tuple<FunctionCallNode *, unsigned long> Parser::parseFunctionCall(unsigned long index) {
-    if (index + 2 >= this->tokens.size()) {
+    if (!this->tokens.has(index + 2)) {
         throw new ParserException("Expected function call, not program end");
     }
 
-    if (this->tokens[index].type != TokenType::IDENTIFIER) {
-        throw new ParserException("Expected identifier to start function call");
+    if (this->tokens.at(index).type != TokenType::IDENTIFIER) {
+        throw new ParserException("Expected identifier to start function call", this->tokens.at(index).offset);
     }
 
-    if (this->tokens[index + 1].type != TokenType::LPAREN) {
-        throw new ParserException("Expected left parentheses after function name");
+    if (this->tokens.at(index + 1).type != TokenType::LPAREN) {
+        throw new ParserException("Expected left parentheses after function name", this->tokens.at(index + 1).offset);
     }
 
-    if (this->tokens[index + 2].type == TokenType::RPAREN) {
-        return { new FunctionCallNode(this->tokens[index].content, new SequenceNode(std::vector<AstNode *>())), 3 };
+    if (this->tokens.at(index + 2).type == TokenType::RPAREN) {
+        return { this->create<FunctionCallNode>(this->symbols, this->intern(this->tokens.at(index)), this->createSequence(this->pending.size())), 3 };
     }
 
     std::tuple<SequenceNode *, unsigned long> sequence = this->parseEnclosed(index + 1, TokenType::RPAREN);
-    // TODO: Check that all this->tokens[...] not exceeds its length, otherwise throw ParserException.
+    // TODO: Check that all this->tokens.at(...) not exceeds its length, otherwise throw ParserException.
     // TODO: Check all that returns unsigned long, or tuple containing it. If it equals to 0, then throw ParserException.
-    return { new FunctionCallNode(this->tokens[index].content, std::get<0>(sequence)), std::get<1>(sequence) + 2 };
+    return { this->create<FunctionCallNode>(this->symbols, this->intern(this->tokens.at(index)), std::get<0>(sequence)), std::get<1>(sequence) + 2 };
 }
 
 std::tuple<SequenceNode *, unsigned long> Parser::parseEnclosed(unsigned long index, TokenType stop) {
     ++index;
     unsigned long length = 1;
-    std::vector<AstNode *> nodes;
+    unsigned long start = this->pending.size();
 
-    while (index < this->tokens.size() && this->tokens[index].type != stop) {
-        if (this->tokens[index].type == TokenType::ARG_SEPARATOR) {
+    while (this->tokens.has(index) && this->tokens.at(index).type != stop) {
+        if (this->tokens.at(index).type == TokenType::ARG_SEPARATOR) {
             // Next is ArgumentSeparator, so skip it
             ++index;
             ++length;
@@ -1428,36 +1655,72 @@ std::tuple<SequenceNode *, unsigned long> Parser::parseEnclosed(unsigned long in
         unsigned long tokensLength = std::get<1>(expr);
         index += tokensLength;
         length += tokensLength;
-        nodes.push_back(std::get<0>(expr));
+        this->pending.push_back(std::get<0>(expr));
     }
 
-    return { new SequenceNode(nodes), length };
+    return { this->createSequence(start), length };
 }
 
-std::vector<PrioritizedOperator> Parser::getPriorities(std::vector<Token> tokens) {
-    std::vector<PrioritizedOperator> opers;
-
-    for (auto itr = tokens.cbegin(); itr != tokens.cend(); ++itr) {
-        if (itr->type != TokenType::OPERATOR) {
-            throw new ParserException("Expected operator");
-        }
-
-        if (itr->content == "+") {
-            opers.push_back(PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_ADD, .priority = 101 });
-        } else if (itr->content == "-") {
-            opers.push_back(PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_SUBTRACT, .priority = 101 });
-        } else if (itr->content == "*") {
-            opers.push_back(PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_MULTIPLY, .priority = 102 });
-        } else if (itr->content == "/") {
-            opers.push_back(PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_DIVIDE, .priority = 102 });
-        } else if (itr->content == "%") {
-            opers.push_back(PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_MOD, .priority = 102 });
-        } else {
-            throw new ParserException("Unknown operator");
-        }
+/**
+ * Comparisons bind looser than arithmetic, and equality looser than order,
+    so "a + 1 < b == c" is "((a + 1) < b) == c".
+ */
+PrioritizedOperator Parser::getPriority(const Token &token) {
+    switch (token.oper) {
+        case Operator::OPERATOR_EQUAL:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_EQUAL, .priority = 99 };
+        case Operator::OPERATOR_NOT_EQUAL:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_NOT_EQUAL, .priority = 99 };
+        case Operator::OPERATOR_LESS:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_LESS, .priority = 100 };
+        case Operator::OPERATOR_LESS_EQUAL:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_LESS_EQUAL, .priority = 100 };
+        case Operator::OPERATOR_GREATER:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_GREATER, .priority = 100 };
+        case Operator::OPERATOR_GREATER_EQUAL:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL, .priority = 100 };
+        case Operator::OPERATOR_ADD:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_ADD, .priority = 101 };
+        case Operator::OPERATOR_SUBTRACT:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_SUBTRACT, .priority = 101 };
+        case Operator::OPERATOR_MULTIPLY:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_MULTIPLY, .priority = 102 };
+        case Operator::OPERATOR_DIVIDE:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_DIVIDE, .priority = 102 };
+        case Operator::OPERATOR_MOD:
+            return PrioritizedOperator { .type = AstNode::NodeType::NODE_OPERATION_MOD, .priority = 102 };
+        default:
+            throw new ParserException("Unknown operator", token.offset);
     }
+}
 
-    return opers;
+AstNode *Parser::createOperation(AstNode::NodeType type, AstNode *left, AstNode *right) {
+    switch (type) {
+        case AstNode::NodeType::NODE_OPERATION_ADD:
+            return this->create<OperationAddNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_SUBTRACT:
+            return this->create<OperationSubtractNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_MULTIPLY:
+            return this->create<OperationMultiplyNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_DIVIDE:
+            return this->create<OperationDivideNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_MOD:
+            return this->create<OperationModNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_EQUAL:
+            return this->create<OperationEqualNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_NOT_EQUAL:
+            return this->create<OperationNotEqualNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_LESS:
+            return this->create<OperationLessNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_LESS_EQUAL:
+            return this->create<OperationLessEqualNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_GREATER:
+            return this->create<OperationGreaterNode>(left, right);
+        case AstNode::NodeType::NODE_OPERATION_GREATER_EQUAL:
+            return this->create<OperationGreaterEqualNode>(left, right);
+        default:
+            throw new ParserException("Unexpected operator type");
+    }
 }
 
 }
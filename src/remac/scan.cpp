@@ -0,0 +1,301 @@
+#include <remac/scan.hpp>
+
+#include <remac/cpu.hpp>
+
+#include <vector>
+
+#ifdef REMAC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace remac {
+
+static inline bool isWhitespaceByte(char chr) {
+    return chr == ' ' || chr == '\t' || chr == '\n';
+}
+
+static inline bool isIdentifierByte(char chr) {
+    return (chr >= 'a' && chr <= 'z') || (chr >= 'A' && chr <= 'Z') || (chr >= '0' && chr <= '9') || chr == '_';
+}
+
+static const char *scanWhitespacesScalar(const char *ptr) {
+    while (isWhitespaceByte(*ptr)) {
+        ptr++;
+    }
+
+    return ptr;
+}
+
+static const char *scanIdentifierCharsScalar(const char *ptr) {
+    while (isIdentifierByte(*ptr)) {
+        ptr++;
+    }
+
+    return ptr;
+}
+
+/**
+ * Line ends after LF, and after CR, which isn't followed by LF. `next` is
+    byte after `ptr`, or '\0' at the end of text.
+ */
+static inline bool isLineEnd(char chr, char next) {
+    return chr == '\n' || (chr == '\r' && next != '\n');
+}
+
+static void scanLineStartsScalar(const char *begin, const char *ptr, const char *end, std::vector<unsigned long> *lineStarts) {
+    for (; ptr < end; ptr++) {
+        if (isLineEnd(*ptr, ptr + 1 < end ? ptr[1] : '\0')) {
+            lineStarts->push_back(ptr + 1 - begin);
+        }
+    }
+}
+
+static const char *scanStringCharsScalar(const char *ptr, const char *end, char quote) {
+    while (ptr < end && *ptr != quote && *ptr != '\\') {
+        ptr++;
+    }
+
+    return ptr;
+}
+
+#ifdef REMAC_X86_SIMD
+
+/*
+Run kernels build mask of bytes in class for each block. When mask isn't
+full, first byte out of class ends the run.
+
+Line start kernel compares each block and the same block shifted by one
+byte, so CR is a line end only without LF after it. Blocks stop one byte
+before the end of text, which is left for scalar loop.
+*/
+
+__attribute__((target("sse2")))
+static inline __m128i inRangeSse2(__m128i bytes, char low, char high) {
+    __m128i clamped = _mm_min_epu8(_mm_max_epu8(bytes, _mm_set1_epi8(low)), _mm_set1_epi8(high));
+    return _mm_cmpeq_epi8(clamped, bytes);
+}
+
+__attribute__((target("sse2")))
+static const char *scanWhitespacesSse2(const char *ptr) {
+    while (true) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i isWhitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))
+        );
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(isWhitespace);
+
+        if (mask != 0xFFFF) {
+            return ptr + __builtin_ctz(~mask);
+        }
+
+        ptr += 16;
+    }
+}
+
+__attribute__((target("sse2")))
+static void scanLineStartsSse2(const char *begin, const char *end, std::vector<unsigned long> *lineStarts) {
+    const char *ptr = begin;
+
+    for (; end - ptr > 16; ptr += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i next = _mm_loadu_si128((const __m128i *)(ptr + 1));
+        __m128i isLineEnd = _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+            _mm_andnot_si128(_mm_cmpeq_epi8(next, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')))
+        );
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(isLineEnd);
+
+        while (mask) {
+            lineStarts->push_back(ptr + __builtin_ctz(mask) + 1 - begin);
+            mask &= mask - 1;
+        }
+    }
+
+    scanLineStartsScalar(begin, ptr, end, lineStarts);
+}
+
+__attribute__((target("sse2")))
+static const char *scanStringCharsSse2(const char *ptr, const char *end, char quote) {
+    for (; end - ptr >= 16; ptr += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i isStop = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(quote)), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(isStop);
+
+        if (mask) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return scanStringCharsScalar(ptr, end, quote);
+}
+
+__attribute__((target("sse2")))
+static const char *scanIdentifierCharsSse2(const char *ptr) {
+    while (true) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)ptr);
+        // Setting 0x20 bit makes upper case letters lower case, and doesn't make any other char a letter
+        __m128i isLetter = inRangeSse2(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+        __m128i isIdentifier = _mm_or_si128(
+            _mm_or_si128(isLetter, inRangeSse2(bytes, '0', '9')),
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_'))
+        );
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(isIdentifier);
+
+        if (mask != 0xFFFF) {
+            return ptr + __builtin_ctz(~mask);
+        }
+
+        ptr += 16;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i inRangeAvx2(__m256i bytes, char low, char high) {
+    __m256i clamped = _mm256_min_epu8(_mm256_max_epu8(bytes, _mm256_set1_epi8(low)), _mm256_set1_epi8(high));
+    return _mm256_cmpeq_epi8(clamped, bytes);
+}
+
+__attribute__((target("avx2")))
+static const char *scanWhitespacesAvx2(const char *ptr) {
+    while (true) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)ptr);
+        __m256i isWhitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))
+        );
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(isWhitespace);
+
+        if (mask != 0xFFFFFFFFU) {
+            return ptr + __builtin_ctz(~mask);
+        }
+
+        ptr += 32;
+    }
+}
+
+__attribute__((target("avx2")))
+static void scanLineStartsAvx2(const char *begin, const char *end, std::vector<unsigned long> *lineStarts) {
+    const char *ptr = begin;
+
+    for (; end - ptr > 32; ptr += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)ptr);
+        __m256i next = _mm256_loadu_si256((const __m256i *)(ptr + 1));
+        __m256i isLineEnd = _mm256_or_si256(
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')),
+            _mm256_andnot_si256(_mm256_cmpeq_epi8(next, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r')))
+        );
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(isLineEnd);
+
+        while (mask) {
+            lineStarts->push_back(ptr + __builtin_ctz(mask) + 1 - begin);
+            mask &= mask - 1;
+        }
+    }
+
+    scanLineStartsScalar(begin, ptr, end, lineStarts);
+}
+
+__attribute__((target("avx2")))
+static const char *scanStringCharsAvx2(const char *ptr, const char *end, char quote) {
+    for (; end - ptr >= 32; ptr += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)ptr);
+        __m256i isStop = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(quote)), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\')));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(isStop);
+
+        if (mask) {
+            return ptr + __builtin_ctz(mask);
+        }
+    }
+
+    return scanStringCharsSse2(ptr, end, quote);
+}
+
+__attribute__((target("avx2")))
+static const char *scanIdentifierCharsAvx2(const char *ptr) {
+    while (true) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)ptr);
+        __m256i isLetter = inRangeAvx2(_mm256_or_si256(bytes, _mm256_set1_epi8(0x20)), 'a', 'z');
+        __m256i isIdentifier = _mm256_or_si256(
+            _mm256_or_si256(isLetter, inRangeAvx2(bytes, '0', '9')),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('_'))
+        );
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(isIdentifier);
+
+        if (mask != 0xFFFFFFFFU) {
+            return ptr + __builtin_ctz(~mask);
+        }
+
+        ptr += 32;
+    }
+}
+
+#endif
+
+const char *scanWhitespaces(const char *ptr) {
+#ifdef REMAC_X86_SIMD
+    SimdLevel level = getSimdLevel();
+
+    if (level >= SimdLevel::SIMD_AVX2) {
+        return scanWhitespacesAvx2(ptr);
+    }
+
+    if (level >= SimdLevel::SIMD_SSE2) {
+        return scanWhitespacesSse2(ptr);
+    }
+#endif
+
+    return scanWhitespacesScalar(ptr);
+}
+
+const char *scanIdentifierChars(const char *ptr) {
+#ifdef REMAC_X86_SIMD
+    SimdLevel level = getSimdLevel();
+
+    if (level >= SimdLevel::SIMD_AVX2) {
+        return scanIdentifierCharsAvx2(ptr);
+    }
+
+    if (level >= SimdLevel::SIMD_SSE2) {
+        return scanIdentifierCharsSse2(ptr);
+    }
+#endif
+
+    return scanIdentifierCharsScalar(ptr);
+}
+
+const char *scanStringChars(const char *ptr, const char *end, char quote) {
+#ifdef REMAC_X86_SIMD
+    SimdLevel level = getSimdLevel();
+
+    if (level >= SimdLevel::SIMD_AVX2) {
+        return scanStringCharsAvx2(ptr, end, quote);
+    }
+
+    if (level >= SimdLevel::SIMD_SSE2) {
+        return scanStringCharsSse2(ptr, end, quote);
+    }
+#endif
+
+    return scanStringCharsScalar(ptr, end, quote);
+}
+
+void scanLineStarts(const char *begin, const char *end, std::vector<unsigned long> *lineStarts) {
+#ifdef REMAC_X86_SIMD
+    SimdLevel level = getSimdLevel();
+
+    if (level >= SimdLevel::SIMD_AVX2) {
+        scanLineStartsAvx2(begin, end, lineStarts);
+        return;
+    }
+
+    if (level >= SimdLevel::SIMD_SSE2) {
+        scanLineStartsSse2(begin, end, lineStarts);
+        return;
+    }
+#endif
+
+    scanLineStartsScalar(begin, begin, end, lineStarts);
+}
+
+}
@@ -0,0 +1,487 @@
+#include <remac/source.hpp>
+
+#include <remac/scan.hpp>
+#include <remac/utf8.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define REMAC_SOURCE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace remac {
+
+SourceException::SourceException(std::string message) {
+    this->message = message;
+}
+
+Source::Source() {
+    this->data = nullptr;
+    this->size = 0;
+    this->buffer = nullptr;
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+}
+
+Source::Source(std::string_view code) : Source() {
+    this->buffer = new char[code.size() + SOURCE_PADDING];
+
+    // Empty view may have null data, which memcpy must not get
+    if (code.size() != 0) {
+        std::memcpy(this->buffer, code.data(), code.size());
+    }
+
+    std::memset(this->buffer + code.size(), 0, SOURCE_PADDING);
+    this->data = this->buffer;
+    this->size = code.size();
+}
+
+Source::Source(Source &&other) noexcept : Source() {
+    *this = std::move(other);
+}
+
+Source &Source::operator=(Source &&other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->data = other.data;
+        this->size = other.size;
+        this->buffer = other.buffer;
+        this->mapping = other.mapping;
+        this->mappingSize = other.mappingSize;
+        other.data = nullptr;
+        other.size = 0;
+        other.buffer = nullptr;
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+    }
+
+    return *this;
+}
+
+static std::string describeError(const std::string &path) {
+    return "Can't read file '" + path + "': " + std::strerror(errno);
+}
+
+#ifdef REMAC_SOURCE_MMAP
+
+Source Source::readUnmapped(int fd, const std::string &path) {
+    unsigned long capacity = 65536;
+    unsigned long size = 0;
+    char *buffer = new char[capacity + SOURCE_PADDING];
+
+    while (true) {
+        if (size == capacity) {
+            char *grown = new char[capacity * 2 + SOURCE_PADDING];
+            std::memcpy(grown, buffer, size);
+            delete[] buffer;
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        ssize_t result = ::read(fd, buffer + size, capacity - size);
+
+        if (result > 0) {
+            size += (unsigned long)result;
+        } else if (result == 0) {
+            break;
+        } else if (errno != EINTR) {
+            std::string message = describeError(path);
+            delete[] buffer;
+            close(fd);
+            throw new SourceException(message);
+        }
+    }
+
+    close(fd);
+    std::memset(buffer + size, 0, SOURCE_PADDING);
+    Source source;
+    source.buffer = buffer;
+    source.data = buffer;
+    source.size = size;
+    return source;
+}
+
+Source Source::fromFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw new SourceException(describeError(path));
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0) {
+        std::string message = describeError(path);
+        close(fd);
+        throw new SourceException(message);
+    }
+
+    // Pipes and devices report no size, so they are read instead of mapped
+    if (!S_ISREG(info.st_mode)) {
+        return Source::readUnmapped(fd, path);
+    }
+
+    Source source;
+    source.size = (unsigned long)info.st_size;
+
+    if (source.size == 0) {
+        close(fd);
+        return Source(std::string_view());
+    }
+
+    /*
+    Reserve zeroed anonymous memory for text and padding first, and then map
+    file over the beginning of it. Rest of last page of file mapping is zeroed
+    by kernel, and pages after it stay anonymous zero pages, so reading padding
+    never touches memory beyond the end of file (which would be SIGBUS).
+    */
+    unsigned long pageSize = (unsigned long)sysconf(_SC_PAGESIZE);
+    source.mappingSize = (source.size + SOURCE_PADDING + pageSize - 1) / pageSize * pageSize;
+    void *reserved = mmap(nullptr, source.mappingSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (reserved == MAP_FAILED) {
+        std::string message = describeError(path);
+        close(fd);
+        throw new SourceException(message);
+    }
+
+    source.mapping = reserved;
+    void *file = mmap(reserved, source.size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    int mapError = errno;
+    close(fd);
+
+    if (file == MAP_FAILED) {
+        errno = mapError;
+        throw new SourceException(describeError(path));
+    }
+
+#ifdef MADV_SEQUENTIAL
+    madvise(file, source.size, MADV_SEQUENTIAL);
+#endif
+
+    source.data = (const char *)file;
+    return source;
+}
+
+#else
+
+Source Source::fromFile(const std::string &path) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+
+    if (file == nullptr) {
+        throw new SourceException(describeError(path));
+    }
+
+    std::string code;
+    char block[65536];
+    unsigned long read;
+
+    while ((read = std::fread(block, 1, sizeof(block), file)) > 0) {
+        code.append(block, read);
+    }
+
+    bool failed = std::ferror(file);
+    std::fclose(file);
+
+    if (failed) {
+        throw new SourceException(describeError(path));
+    }
+
+    return Source(code);
+}
+
+#endif
+
+Source Source::fromPadded(std::string_view code) {
+    for (unsigned long i = 0; i < SOURCE_PADDING; i++) {
+        if (code.data()[code.size() + i] != '\0') {
+            throw new SourceException("Code isn't followed by " + std::to_string(SOURCE_PADDING) + " zero bytes");
+        }
+    }
+
+    Source source;
+    source.data = code.data();
+    source.size = code.size();
+    return source;
+}
+
+const char *Source::getData() const {
+    return this->data;
+}
+
+unsigned long Source::getSize() const {
+    return this->size;
+}
+
+std::string_view Source::getCode() const {
+    return std::string_view(this->data, this->size);
+}
+
+void Source::release() {
+#ifdef REMAC_SOURCE_MMAP
+    if (this->mapping != nullptr) {
+        munmap(this->mapping, this->mappingSize);
+    }
+#endif
+
+    delete[] this->buffer;
+    this->data = nullptr;
+    this->size = 0;
+    this->buffer = nullptr;
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+}
+
+Source::~Source() {
+    this->release();
+}
+
+SourceMap::SourceMap(std::string_view code) {
+    this->code = code;
+    this->lineStarts.push_back(0);
+    scanLineStarts(code.data(), code.data() + code.size(), &this->lineStarts);
+}
+
+SourcePosition SourceMap::locate(unsigned long offset) const {
+    // The last line, which starts at or before offset
+    auto next = std::upper_bound(this->lineStarts.cbegin(), this->lineStarts.cend(), offset);
+    unsigned long line = next - this->lineStarts.cbegin();
+    unsigned long column = 1;
+
+    for (unsigned long i = *(next - 1); i < offset && i < this->code.size(); i++) {
+        // Each char has exactly one byte, which isn't UTF-8 continuation byte
+        column += ((unsigned char)this->code[i] & 0xC0) != 0x80;
+    }
+
+    return SourcePosition { .line = line, .column = column };
+}
+
+SourcePosition SourceMap::advance(SourcePosition position, std::string_view text) {
+    const char *data = text.data();
+
+    for (unsigned long i = 0; i < text.size(); i++) {
+        if (data[i] == '\n' || (data[i] == '\r' && data[i + 1] != '\n')) {
+            position.line++;
+            position.column = 1;
+        } else if (((unsigned char)data[i] & 0xC0) != 0x80 && data[i] != '\r') {
+            position.column++;
+        }
+    }
+
+    return position;
+}
+
+unsigned long SourceMap::getLineCount() const {
+    return this->lineStarts.size();
+}
+
+SourceStream::SourceStream(unsigned long blockSize) {
+    this->stream = nullptr;
+    this->fd = -1;
+    this->buffer = nullptr;
+    this->capacity = 0;
+    this->size = 0;
+    this->blockSize = blockSize > 0 ? blockSize : 1;
+    this->tailSize = 0;
+    this->ended = false;
+    this->invalid = false;
+}
+
+SourceStream::SourceStream(std::istream &stream, unsigned long blockSize) : SourceStream(blockSize) {
+    this->stream = &stream;
+}
+
+SourceStream::SourceStream(int fd, unsigned long blockSize) : SourceStream(blockSize) {
+    this->fd = fd;
+}
+
+SourceStream::SourceStream(SourceStream &&other) noexcept : SourceStream(other.blockSize) {
+    *this = std::move(other);
+}
+
+SourceStream &SourceStream::operator=(SourceStream &&other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->stream = other.stream;
+        this->fd = other.fd;
+        this->buffer = other.buffer;
+        this->capacity = other.capacity;
+        this->size = other.size;
+        this->blockSize = other.blockSize;
+        std::memcpy(this->tail, other.tail, sizeof(this->tail));
+        this->tailSize = other.tailSize;
+        this->ended = other.ended;
+        this->invalid = other.invalid;
+        other.buffer = nullptr;
+        other.capacity = 0;
+        other.size = 0;
+        other.tailSize = 0;
+    }
+
+    return *this;
+}
+
+/**
+ * Count of bytes in UTF-8 char, which starts with `lead` byte, or 1 for
+    bytes, that can't start multibyte char (validator rejects them later).
+ */
+static unsigned long utf8SequenceLength(unsigned char lead) {
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        return 4;
+    }
+
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        return 3;
+    }
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        return 2;
+    }
+
+    return 1;
+}
+
+void SourceStream::advance(unsigned long keepFrom) {
+    unsigned long kept = this->size - keepFrom;
+    if (kept > 0) {
+        std::memmove(this->buffer, this->buffer + keepFrom, kept);
+    }
+
+    this->size = kept;
+
+    if (!this->ended) {
+        unsigned long wanted = kept > this->blockSize ? kept : this->blockSize;
+        unsigned long needed = kept + sizeof(this->tail) + wanted + SOURCE_PADDING;
+
+        if (needed > this->capacity) {
+            char *grown = new char[needed];
+
+            // Buffer is still null before the first block
+            if (kept != 0) {
+                std::memcpy(grown, this->buffer, kept);
+            }
+
+            delete[] this->buffer;
+            this->buffer = grown;
+            this->capacity = needed;
+        }
+
+        // Held back bytes weren't validated yet, so validation starts from them
+        unsigned long unchecked = this->size;
+        std::memcpy(this->buffer + this->size, this->tail, this->tailSize);
+        this->size += this->tailSize;
+        this->tailSize = 0;
+
+        unsigned long count = this->read(this->buffer + this->size, wanted);
+        this->size += count;
+        this->ended = count == 0;
+
+        if (!this->ended) {
+            // Look back for lead byte of the last char, and hold it back, if it's incomplete
+            unsigned long continuations = 0;
+
+            while (continuations < 3 && continuations < this->size - unchecked && ((unsigned char)this->buffer[this->size - 1 - continuations] & 0xC0) == 0x80) {
+                ++continuations;
+            }
+
+            if (continuations < this->size - unchecked) {
+                unsigned long lead = this->size - 1 - continuations;
+
+                if (utf8SequenceLength((unsigned char)this->buffer[lead]) > continuations + 1) {
+                    this->tailSize = continuations + 1;
+                    std::memcpy(this->tail, this->buffer + lead, this->tailSize);
+                    this->size = lead;
+                }
+            }
+        }
+
+        const char *start = this->buffer + unchecked;
+        const char *end = this->buffer + this->size;
+
+        if (!isValidUtf8(start, end)) {
+            this->size = findInvalidUtf8(start, end) - this->buffer;
+            this->tailSize = 0;
+            this->ended = true;
+            this->invalid = true;
+        }
+    }
+
+    if (this->buffer != nullptr) {
+        std::memset(this->buffer + this->size, 0, SOURCE_PADDING);
+    }
+}
+
+#ifdef REMAC_SOURCE_MMAP
+
+static unsigned long readFd(int fd, char *into, unsigned long count) {
+    while (true) {
+        ssize_t result = ::read(fd, into, count);
+
+        if (result >= 0) {
+            return (unsigned long)result;
+        }
+
+        if (errno != EINTR) {
+            throw new SourceException(std::string("Can't read input: ") + std::strerror(errno));
+        }
+    }
+}
+
+#else
+
+static unsigned long readFd(int, char *, unsigned long) {
+    throw new SourceException("Reading file descriptors isn't supported on this platform");
+}
+
+#endif
+
+unsigned long SourceStream::read(char *into, unsigned long count) {
+    if (this->stream == nullptr) {
+        return readFd(this->fd, into, count);
+    }
+
+    this->stream->read(into, count);
+
+    if (this->stream->bad()) {
+        throw new SourceException("Can't read input stream");
+    }
+
+    return (unsigned long)this->stream->gcount();
+}
+
+std::string_view SourceStream::getCode() const {
+    return std::string_view(this->buffer, this->size);
+}
+
+bool SourceStream::isEnded() const {
+    return this->ended;
+}
+
+bool SourceStream::isInvalid() const {
+    return this->invalid;
+}
+
+void SourceStream::release() {
+    delete[] this->buffer;
+    this->buffer = nullptr;
+    this->capacity = 0;
+    this->size = 0;
+}
+
+SourceStream::~SourceStream() {
+    this->release();
+}
+
+}
@@ -0,0 +1,101 @@
+#include <remac/symbols.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+SymbolTable::SymbolTable() : slots(SymbolTable::INITIAL_CAPACITY, NO_SYMBOL) {}
+
+Symbol SymbolTable::intern(std::string_view name) {
+    std::uint64_t hash = SymbolTable::hash(name);
+    unsigned long slot = this->findSlot(name, hash);
+
+    if (this->slots[slot] != NO_SYMBOL) {
+        return this->slots[slot];
+    }
+
+    Symbol symbol = this->symbols.size();
+    this->symbols.push_back(this->names.copyString(name));
+    this->hashes.push_back(hash);
+    this->slots[slot] = symbol;
+
+    // Load factor is kept below 1/2, so probe sequences stay short
+    if (this->symbols.size() * 2 > this->slots.size()) {
+        this->grow();
+    }
+
+    return symbol;
+}
+
+Symbol SymbolTable::find(std::string_view name) const {
+    return this->slots[this->findSlot(name, SymbolTable::hash(name))];
+}
+
+std::string_view SymbolTable::getName(Symbol symbol) const {
+    return this->symbols[symbol];
+}
+
+unsigned long SymbolTable::size() const {
+    return this->symbols.size();
+}
+
+/**
+ * Hashes 8 bytes per step, so long string literals are hashed fast too.
+ */
+std::uint64_t SymbolTable::hash(std::string_view name) {
+    const std::uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+    std::uint64_t hash = name.size() * MULTIPLIER;
+    const char *ptr = name.data();
+    const char *end = ptr + name.size();
+
+    for (; end - ptr >= 8; ptr += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, ptr, 8);
+        hash = (hash ^ word) * MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+
+    if (ptr < end) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, ptr, end - ptr);
+        hash = (hash ^ word) * MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
+
+/**
+ * Slot of `name`, or the empty slot, where it's inserted.
+ */
+unsigned long SymbolTable::findSlot(std::string_view name, std::uint64_t hash) const {
+    unsigned long mask = this->slots.size() - 1;
+
+    for (unsigned long slot = hash & mask; ; slot = (slot + 1) & mask) {
+        Symbol symbol = this->slots[slot];
+
+        if (symbol == NO_SYMBOL || (this->hashes[symbol] == hash && this->symbols[symbol] == name)) {
+            return slot;
+        }
+    }
+}
+
+void SymbolTable::grow() {
+    this->slots.assign(this->slots.size() * 2, NO_SYMBOL);
+    unsigned long mask = this->slots.size() - 1;
+
+    for (Symbol symbol = 0; symbol < this->symbols.size(); symbol++) {
+        unsigned long slot = this->hashes[symbol] & mask;
+
+        while (this->slots[slot] != NO_SYMBOL) {
+            slot = (slot + 1) & mask;
+        }
+
+        this->slots[slot] = symbol;
+    }
+}
+
+}
@@ -0,0 +1,192 @@
+#include <remac/tokens.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace remac {
+
+PackedTokens::PackedTokens() {}
+
+void PackedTokens::reset(std::string_view code) {
+    this->code = code;
+    this->types.clear();
+    this->details.clear();
+    this->offsets.clear();
+    this->lengths.clear();
+    this->decoded.clear();
+    this->symbols.clear();
+    this->map.reset();
+}
+
+void PackedTokens::reserve(unsigned long count) {
+    this->types.reserve(count);
+    this->details.reserve(count);
+    this->offsets.reserve(count);
+    this->lengths.reserve(count);
+}
+
+void PackedTokens::push(const Token &token) {
+    std::uint8_t detail = 0;
+    std::uint32_t length = token.content.size();
+
+    if (token.type == TokenType::KEYWORD) {
+        detail = token.keyword;
+    } else if (token.type == TokenType::OPERATOR) {
+        detail = token.oper;
+    } else if (token.type == TokenType::STRING && (token.content.data() < this->code.data() || token.content.data() > this->code.data() + this->code.size())) {
+        detail = PackedTokens::STRING_DECODED;
+        length = this->decoded.size();
+        this->decoded.push_back(token.content);
+    }
+
+    if (token.symbol != NO_SYMBOL) {
+        this->setSymbol(this->size(), token.symbol);
+    }
+
+    this->types.push_back(token.type);
+    this->details.push_back(detail);
+    this->offsets.push_back(token.offset);
+    this->lengths.push_back(length);
+}
+
+void PackedTokens::append(const PackedTokens &other, unsigned long from) {
+    unsigned long first = this->size();
+    this->types.insert(this->types.end(), other.types.begin() + from, other.types.end());
+    this->details.insert(this->details.end(), other.details.begin() + from, other.details.end());
+    this->offsets.insert(this->offsets.end(), other.offsets.begin() + from, other.offsets.end());
+    this->lengths.insert(this->lengths.end(), other.lengths.begin() + from, other.lengths.end());
+
+    if (other.symbols.size() > from) {
+        this->symbols.resize(first, NO_SYMBOL);
+        this->symbols.insert(this->symbols.end(), other.symbols.begin() + from, other.symbols.end());
+    }
+
+    // Decoded contents are moved to the end of own list
+    for (unsigned long i = from; i < other.size(); i++) {
+        if (other.isDecoded(i)) {
+            this->lengths[first + i - from] = this->decoded.size();
+            this->decoded.push_back(other.decoded[other.lengths[i]]);
+        }
+    }
+}
+
+void PackedTokens::truncate(unsigned long size) {
+    this->types.resize(size);
+    this->details.resize(size);
+    this->offsets.resize(size);
+    this->lengths.resize(size);
+
+    if (this->symbols.size() > size) {
+        this->symbols.resize(size);
+    }
+}
+
+void PackedTokens::replace(std::string_view code, unsigned long start, unsigned long count, const PackedTokens &other, long shift) {
+    unsigned long end = start + count;
+    this->code = code;
+    this->map.reset();
+
+    for (unsigned long i = end; i < this->size(); i++) {
+        this->offsets[i] += shift;
+    }
+
+    if (!this->symbols.empty() || !other.symbols.empty()) {
+        this->symbols.resize(this->size(), NO_SYMBOL);
+        this->symbols.erase(this->symbols.begin() + start, this->symbols.begin() + end);
+        this->symbols.insert(this->symbols.begin() + start, other.size(), NO_SYMBOL);
+        std::copy(other.symbols.begin(), other.symbols.end(), this->symbols.begin() + start);
+    }
+
+    this->types.erase(this->types.begin() + start, this->types.begin() + end);
+    this->types.insert(this->types.begin() + start, other.types.begin(), other.types.end());
+    this->details.erase(this->details.begin() + start, this->details.begin() + end);
+    this->details.insert(this->details.begin() + start, other.details.begin(), other.details.end());
+    this->offsets.erase(this->offsets.begin() + start, this->offsets.begin() + end);
+    this->offsets.insert(this->offsets.begin() + start, other.offsets.begin(), other.offsets.end());
+    this->lengths.erase(this->lengths.begin() + start, this->lengths.begin() + end);
+    this->lengths.insert(this->lengths.begin() + start, other.lengths.begin(), other.lengths.end());
+
+    // Decoded contents of replaced tokens stay unused in list, new ones are appended
+    for (unsigned long i = 0; i < other.size(); i++) {
+        if (other.isDecoded(i)) {
+            this->lengths[start + i] = this->decoded.size();
+            this->decoded.push_back(other.decoded[other.lengths[i]]);
+        }
+    }
+}
+
+void PackedTokens::setSymbol(unsigned long index, Symbol symbol) {
+    if (this->symbols.size() <= index) {
+        this->symbols.resize(index + 1, NO_SYMBOL);
+    }
+
+    this->symbols[index] = symbol;
+}
+
+unsigned long PackedTokens::size() const {
+    return this->types.size();
+}
+
+TokenType PackedTokens::getType(unsigned long index) const {
+    return (TokenType)this->types[index];
+}
+
+Keyword PackedTokens::getKeyword(unsigned long index) const {
+    return this->types[index] == TokenType::KEYWORD ? (Keyword)this->details[index] : Keyword::KEYWORD_NONE;
+}
+
+Operator PackedTokens::getOperator(unsigned long index) const {
+    return this->types[index] == TokenType::OPERATOR ? (Operator)this->details[index] : Operator::OPERATOR_NONE;
+}
+
+std::string_view PackedTokens::getContent(unsigned long index) const {
+    if (this->isDecoded(index)) {
+        return this->decoded[this->lengths[index]];
+    }
+
+    return this->code.substr(this->offsets[index], this->lengths[index]);
+}
+
+unsigned long PackedTokens::getOffset(unsigned long index) const {
+    return this->offsets[index];
+}
+
+Symbol PackedTokens::getSymbol(unsigned long index) const {
+    return index < this->symbols.size() ? this->symbols[index] : NO_SYMBOL;
+}
+
+SourcePosition PackedTokens::getPosition(unsigned long index) {
+    if (!this->map.has_value()) {
+        this->map.emplace(this->code);
+    }
+
+    return this->map->locate(this->offsets[index]);
+}
+
+Token PackedTokens::get(unsigned long index) const {
+    return Token {
+        .type = this->getType(index),
+        .content = this->getContent(index),
+        .offset = this->offsets[index],
+        .keyword = this->getKeyword(index),
+        .oper = this->getOperator(index),
+        .symbol = this->getSymbol(index),
+    };
+}
+
+unsigned long PackedTokens::getByteSize() const {
+    return this->types.capacity() * sizeof(std::uint8_t) +
+        this->details.capacity() * sizeof(std::uint8_t) +
+        this->offsets.capacity() * sizeof(std::uint32_t) +
+        this->lengths.capacity() * sizeof(std::uint32_t) +
+        this->decoded.capacity() * sizeof(std::string_view) +
+        this->symbols.capacity() * sizeof(Symbol);
+}
+
+bool PackedTokens::isDecoded(unsigned long index) const {
+    return this->types[index] == TokenType::STRING && this->details[index] == PackedTokens::STRING_DECODED;
+}
+
+}
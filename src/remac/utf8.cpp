@@ -1,114 +1,140 @@
 #include <remac/utf8.hpp>
 
+#include <remac/cpu.hpp>
+
+#include <cstring>
 #include <tuple>
 #include <string>
 
-// TODO: Check for string end (0 byte)
+#ifdef REMAC_X86_SIMD
+#include <immintrin.h>
+#endif
 
 namespace remac {
 
-std::tuple<unsigned char, Utf8Char> getNextUnicode(const char *inputBytes) {
-    Utf8Char utfChar;
-    utfChar.codePoint = 0;
-
-    if (inputBytes[0] & 0x80) {
-        if (!(inputBytes[0] & 0x40)) {
-            // 10xxxxxx
-            // INCORRECT(4)
-            return { UTF8_INVALID, utfChar };
+/*
+UTF-8 decoding DFA by Bjoern Hoehrmann. First 256 entries map bytes to
+classes, the rest is transition table, indexed by state (multiple of 12)
+plus class of next byte. Class also tells, how many payload bits lead byte
+has: `0xFF >> class`.
+*/
+
+static const unsigned char UTF8_ACCEPT = 0;
+static const unsigned char UTF8_REJECT = 12;
+
+static const unsigned char UTF8_DFA[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    8, 8, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    10, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3, 11, 6, 6, 6, 5, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+
+    0, 12, 24, 36, 60, 96, 84, 12, 12, 12, 48, 72, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+    12, 0, 12, 12, 12, 12, 12, 0, 12, 0, 12, 12, 12, 24, 12, 12, 12, 12, 12, 24, 12, 24, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12, 12, 12, 12, 24, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12, 12, 36, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,
+    12, 36, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+};
+
+DecodedChar decodeUtf8Multibyte(const char *bytes, const char *end) {
+    unsigned long available = end - bytes;
+    unsigned char byte = (unsigned char)bytes[0];
+
+    // Two byte chars (Latin, Greek, Cyrillic, ...) need no table
+    if (byte >= 0xC2 && byte <= 0xDF && available >= 2 && ((unsigned char)bytes[1] & 0xC0) == 0x80) {
+        return DecodedChar { .codePoint = (char32_t)((byte & 0x1F) << 6 | ((unsigned char)bytes[1] & 0x3F)), .length = 2 };
+    }
+    unsigned char type = UTF8_DFA[byte];
+    char32_t codePoint = (0xFF >> type) & byte;
+    unsigned char state = UTF8_DFA[256 + type];
+    unsigned char length = 1;
+
+    // States above UTF8_REJECT wait for continuation bytes
+    while (state > UTF8_REJECT) {
+        if (length >= available) {
+            return DecodedChar { .codePoint = 0, .length = UTF8_INVALID };
         }
 
-        // 11111xxx
-        // INCORRECT(3)
-        if (
-            inputBytes[0] & 0x40 && inputBytes[0] & 0x20 && \
-            inputBytes[0] & 0x10 && inputBytes[0] & 0x08
-        ) {
-            return { UTF8_INVALID, utfChar };
-        }
+        byte = (unsigned char)bytes[length++];
+        codePoint = (codePoint << 6) | (byte & 0x3F);
+        state = UTF8_DFA[256 + state + UTF8_DFA[byte]];
+    }
 
-        // 11xxxxxx 0xxxxxxx
-        // INCORRECT(1)
-        // 11xxxxxx 11xxxxxx
-        // INCORRECT(2)
-        if ((!(inputBytes[1] & 0x80)) || (inputBytes[1] & 0x40)) {
-            return { UTF8_INVALID, utfChar };
-        }
+    if (state != UTF8_ACCEPT) {
+        return DecodedChar { .codePoint = 0, .length = UTF8_INVALID };
+    }
 
-        utfChar.bytes[0] = inputBytes[0];
-        utfChar.bytes[1] = inputBytes[1];
+    return DecodedChar { .codePoint = codePoint, .length = length };
+}
 
-        if (inputBytes[0] & 0x20) {
-            // 11xxxxxx 0xxxxxxx
-            // INCORRECT(1)
-            // 11xxxxxx 11xxxxxx
-            // INCORRECT(2)
-            if ((!(inputBytes[1] & 0x80)) || (inputBytes[1] & 0x40)) {
-                return { UTF8_INVALID, utfChar };
-            }
+unsigned char encodeUtf8(char32_t codePoint, char *bytes) {
+    if (codePoint < 0x80) {
+        bytes[0] = (char)codePoint;
+        return 1;
+    }
 
-            // 11xxxxxx xxxxxxxx 0xxxxxxx
-            // INCORRECT(1)
-            // 11xxxxxx xxxxxxxx 11xxxxxx
-            // INCORRECT(2)
-            if ((!(inputBytes[2] & 0x80)) || (inputBytes[2] & 0x40)) {
-                return { UTF8_INVALID, utfChar };
-            }
+    if (codePoint < 0x800) {
+        bytes[0] = (char)(0xC0 | (codePoint >> 6));
+        bytes[1] = (char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
 
-            utfChar.bytes[2] = inputBytes[2];
-        } else {
-            return { 2, utfChar };
+    if (codePoint < 0x10000) {
+        if (codePoint >= 0xD800 && codePoint <= 0xDFFF) {
+            return UTF8_INVALID;
         }
 
-        if (inputBytes[0] & 0x10) {
-            // 11xxxxxx 0xxxxxxx
-            // INCORRECT(1)
-            // 11xxxxxx 11xxxxxx
-            // INCORRECT(2)
-            if ((!(inputBytes[1] & 0x80)) || (inputBytes[1] & 0x40)) {
-                return { UTF8_INVALID, utfChar };
-            }
+        bytes[0] = (char)(0xE0 | (codePoint >> 12));
+        bytes[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
 
-            // 11xxxxxx xxxxxxxx 0xxxxxxx
-            // INCORRECT(1)
-            // 11xxxxxx xxxxxxxx 11xxxxxx
-            // INCORRECT(2)
-            if ((!(inputBytes[2] & 0x80)) || (inputBytes[2] & 0x40)) {
-                return { UTF8_INVALID, utfChar };
-            }
+    if (codePoint < 0x110000) {
+        bytes[0] = (char)(0xF0 | (codePoint >> 18));
+        bytes[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        bytes[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[3] = (char)(0x80 | (codePoint & 0x3F));
+        return 4;
+    }
 
-            // 11xxxxxx xxxxxxxx xxxxxxxx 0xxxxxxx
-            // INCORRECT(1)
-            // 11xxxxxx xxxxxxxx xxxxxxxx 11xxxxxx
-            // INCORRECT(2)
-            if ((!(inputBytes[3] & 0x80)) || (inputBytes[3] & 0x40)) {
-                return { UTF8_INVALID, utfChar };
-            }
+    return UTF8_INVALID;
+}
 
-            utfChar.bytes[3] = inputBytes[3];
-        } else {
-            return { 3, utfChar };
-        }
+std::tuple<unsigned char, Utf8Char> getNextUnicode(const char *inputBytes) {
+    return getNextUnicode(inputBytes, inputBytes + 4);
+}
 
-        return { 4, utfChar };
-    } else {
-        // 0xxxxxxx
-        // CORRECT(1)
-        utfChar.bytes[0] = inputBytes[0];
-        return { 1, utfChar };
+std::tuple<unsigned char, Utf8Char> getNextUnicode(const char *inputBytes, const char *inputEnd) {
+    DecodedChar decoded = decodeUtf8(inputBytes, inputEnd);
+    Utf8Char utfChar = Utf8Char { .bytes = { 0, 0, 0, 0 }, .codePoint = decoded.codePoint };
+
+    for (unsigned char i = 0; i < decoded.length; i++) {
+        utfChar.bytes[i] = inputBytes[i];
     }
+
+    return { decoded.length, utfChar };
 }
 
-Utf8Char utfFromCodePoint(unsigned int codePoint) {
-    return Utf8Char { .codePoint = codePoint };
+Utf8Char utfFromCodePoint(char32_t codePoint) {
+    Utf8Char utfChar = Utf8Char { .bytes = { 0, 0, 0, 0 }, .codePoint = codePoint };
+
+    if (encodeUtf8(codePoint, utfChar.bytes) == UTF8_INVALID) {
+        utfChar.codePoint = 0;
+    }
+
+    return utfChar;
 }
 
 Utf8Char fromAsciiChar(char chr) {
-    return Utf8Char { .bytes = { chr, 0, 0, 0 } };
+    return Utf8Char { .bytes = { chr, 0, 0, 0 }, .codePoint = (unsigned char)chr };
 }
 
 Utf8Char fromCharArray(char chr[4]) {
-    return Utf8Char { .bytes = { chr[0], chr[1], chr[2], chr[3] } };
+    return std::get<1>(getNextUnicode(chr));
 }
 
 void utfStringAppend(std::string *string, Utf8Char chr) {
@@ -133,37 +159,306 @@ bool utfCharInString(const char *stringStart, const char *stringEnd, Utf8Char ch
     const char *ptr = stringStart;
 
     while (ptr < stringEnd) {
-        std::tuple<unsigned char, Utf8Char> utf8_tuple = getNextUnicode(ptr);
-        ptr += std::get<0>(utf8_tuple);
+        DecodedChar decoded = decodeUtf8(ptr, stringEnd);
+
+        if (decoded.length == UTF8_INVALID) {
+            return false;
+        }
 
-        if (std::get<1>(utf8_tuple).codePoint == chr.codePoint) {
+        if (decoded.codePoint == chr.codePoint) {
             return true;
         }
+
+        ptr += decoded.length;
     }
 
     return false;
 }
 
 bool utfCompareSingle(const char *str, Utf8Char chr2) {
-    Utf8Char chr1 = std::get<1>(getNextUnicode(str));
-    return chr1.codePoint == chr2.codePoint;
+    DecodedChar chr1 = decodeUtf8(str);
+    return chr1.length != UTF8_INVALID && chr1.codePoint == chr2.codePoint;
 }
 
-bool isValidUtf8(const char *stringStart, const char *stringEnd) {
+static inline unsigned long loadWord(const unsigned char *ptr) {
+    unsigned long word;
+    std::memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+const char *findInvalidUtf8(const char *stringStart, const char *stringEnd) {
+    const unsigned char *ptr = (const unsigned char *)stringStart;
+    const unsigned char *end = (const unsigned char *)stringEnd;
+    const unsigned long highBits = (unsigned long)0x8080808080808080ULL;
+
+    while (ptr < end) {
+        // ASCII fast path: whole word without high bits
+        if ((unsigned long)(end - ptr) >= sizeof(unsigned long) && !(loadWord(ptr) & highBits)) {
+            ptr += sizeof(unsigned long);
+            continue;
+        }
+
+        unsigned char lead = *ptr;
+
+        if (lead < 0x80) {
+            ptr++;
+            continue;
+        }
+
+        unsigned long length;
+        unsigned char secondMin = 0x80;
+        unsigned char secondMax = 0xBF;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            secondMin = lead == 0xE0 ? 0xA0 : 0x80; // Overlong
+            secondMax = lead == 0xED ? 0x9F : 0xBF; // Surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            secondMin = lead == 0xF0 ? 0x90 : 0x80; // Overlong
+            secondMax = lead == 0xF4 ? 0x8F : 0xBF; // Above U+10FFFF
+        } else {
+            return (const char *)ptr;
+        }
+
+        if ((unsigned long)(end - ptr) < length || ptr[1] < secondMin || ptr[1] > secondMax) {
+            return (const char *)ptr;
+        }
+
+        for (unsigned long i = 2; i < length; i++) {
+            if ((ptr[i] & 0xC0) != 0x80) {
+                return (const char *)ptr;
+            }
+        }
+
+        ptr += length;
+    }
+
+    return stringEnd;
+}
+
+#ifdef REMAC_X86_SIMD
+
+/*
+Vectorized validation, described by John Keiser and Daniel Lemire in
+"Validating UTF-8 In Less Than One Instruction Per Byte". Each pair of
+adjacent bytes is classified by three 16-entry tables (high nibble of the
+first byte, low nibble of the first byte, high nibble of the second byte),
+and their AND is non-zero only for invalid pairs. Continuations of 3 and 4
+byte sequences are checked separately against the bytes 2 and 3 positions
+before.
+*/
+
+static const unsigned char TOO_SHORT = 1 << 0; // 11______ 0_______ or 11______ 11______
+static const unsigned char TOO_LONG = 1 << 1; // 0_______ 10______
+static const unsigned char OVERLONG_3 = 1 << 2; // 11100000 100_____
+static const unsigned char TOO_LARGE = 1 << 3; // 11110100 1001____, 11110100 101_____, 111101__ 10______, ...
+static const unsigned char SURROGATE = 1 << 4; // 11101101 101_____
+static const unsigned char OVERLONG_2 = 1 << 5; // 1100000_ 10______
+static const unsigned char TOO_LARGE_1000 = 1 << 6; // 11110101 1000____, ...
+static const unsigned char OVERLONG_4 = 1 << 6; // 11110000 1000____
+static const unsigned char TWO_CONTINUATIONS = 1 << 7; // 10______ 10______
+static const unsigned char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTINUATIONS;
+
+#define REMAC_UTF8_BYTE_1_HIGH \
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, \
+    TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS, \
+    TOO_SHORT | OVERLONG_2, \
+    TOO_SHORT, \
+    TOO_SHORT | OVERLONG_3 | SURROGATE, \
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+
+#define REMAC_UTF8_BYTE_1_LOW \
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, \
+    CARRY | OVERLONG_2, \
+    CARRY, \
+    CARRY, \
+    CARRY | TOO_LARGE, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+
+#define REMAC_UTF8_BYTE_2_HIGH \
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE, \
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+
+__attribute__((target("ssse3,sse4.1")))
+static inline __m128i highNibblesSse4(__m128i bytes) {
+    return _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+}
+
+__attribute__((target("ssse3,sse4.1")))
+static inline __m128i checkBlockSse4(__m128i input, __m128i previous) {
+    const __m128i byte1HighTable = _mm_setr_epi8(REMAC_UTF8_BYTE_1_HIGH);
+    const __m128i byte1LowTable = _mm_setr_epi8(REMAC_UTF8_BYTE_1_LOW);
+    const __m128i byte2HighTable = _mm_setr_epi8(REMAC_UTF8_BYTE_2_HIGH);
+
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i specialCases = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(byte1HighTable, highNibblesSse4(prev1)),
+            _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))
+        ),
+        _mm_shuffle_epi8(byte2HighTable, highNibblesSse4(input))
+    );
+
+    // Only 111_____ and 1111____ leads stay >= 0x80 after subtraction
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i mustBeContinuation = _mm_or_si128(
+        _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+        _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)))
+    );
+
+    return _mm_xor_si128(_mm_and_si128(mustBeContinuation, _mm_set1_epi8((char)0x80)), specialCases);
+}
+
+__attribute__((target("ssse3,sse4.1")))
+static bool isValidUtf8Sse4(const char *stringStart, const char *stringEnd) {
+    // Non-zero after saturating subtraction only for leads, not finished within the block
+    const __m128i incompleteLimits = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+    );
     const char *ptr = stringStart;
+    __m128i previous = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
 
     while (ptr < stringEnd) {
-        std::tuple<unsigned char, Utf8Char> utf8_tuple = getNextUnicode(ptr);
-        unsigned char length = std::get<0>(utf8_tuple);
+        __m128i input;
 
-        if (length == UTF8_INVALID) {
-            return false;
+        if (stringEnd - ptr >= 16) {
+            input = _mm_loadu_si128((const __m128i *)ptr);
+        } else {
+            // Tail is padded with zeros, which are ASCII
+            char block[16] = {};
+            std::memcpy(block, ptr, stringEnd - ptr);
+            input = _mm_loadu_si128((const __m128i *)block);
         }
 
-        ptr += length;
+        if (_mm_movemask_epi8(input) == 0) {
+            // ASCII block can only be wrong, when previous block ends in the middle of sequence
+            error = _mm_or_si128(error, incomplete);
+        } else {
+            error = _mm_or_si128(error, checkBlockSse4(input, previous));
+            incomplete = _mm_subs_epu8(input, incompleteLimits);
+        }
+
+        previous = input;
+        ptr += 16;
+    }
+
+    // Sequence, truncated by the end of string
+    error = _mm_or_si128(error, incomplete);
+    return _mm_testz_si128(error, error);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i highNibblesAvx2(__m256i bytes) {
+    return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i checkBlockAvx2(__m256i input, __m256i previous) {
+    // pshufb works in 128-bit lanes, so tables are duplicated for both of them
+    const __m256i byte1HighTable = _mm256_setr_epi8(REMAC_UTF8_BYTE_1_HIGH, REMAC_UTF8_BYTE_1_HIGH);
+    const __m256i byte1LowTable = _mm256_setr_epi8(REMAC_UTF8_BYTE_1_LOW, REMAC_UTF8_BYTE_1_LOW);
+    const __m256i byte2HighTable = _mm256_setr_epi8(REMAC_UTF8_BYTE_2_HIGH, REMAC_UTF8_BYTE_2_HIGH);
+
+    // High lane of previous block and low lane of input, so alignr can shift across lanes
+    __m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i specialCases = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(byte1HighTable, highNibblesAvx2(prev1)),
+            _mm256_shuffle_epi8(byte1LowTable, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))
+        ),
+        _mm256_shuffle_epi8(byte2HighTable, highNibblesAvx2(input))
+    );
+
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i mustBeContinuation = _mm256_or_si256(
+        _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+        _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)))
+    );
+
+    return _mm256_xor_si256(_mm256_and_si256(mustBeContinuation, _mm256_set1_epi8((char)0x80)), specialCases);
+}
+
+__attribute__((target("avx2")))
+static bool isValidUtf8Avx2(const char *stringStart, const char *stringEnd) {
+    const __m256i incompleteLimits = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+    );
+    const char *ptr = stringStart;
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+
+    while (ptr < stringEnd) {
+        __m256i input;
+
+        if (stringEnd - ptr >= 32) {
+            input = _mm256_loadu_si256((const __m256i *)ptr);
+        } else {
+            char block[32] = {};
+            std::memcpy(block, ptr, stringEnd - ptr);
+            input = _mm256_loadu_si256((const __m256i *)block);
+        }
+
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, incomplete);
+        } else {
+            error = _mm256_or_si256(error, checkBlockAvx2(input, previous));
+            incomplete = _mm256_subs_epu8(input, incompleteLimits);
+        }
+
+        previous = input;
+        ptr += 32;
+    }
+
+    error = _mm256_or_si256(error, incomplete);
+    return _mm256_testz_si256(error, error);
+}
+
+#undef REMAC_UTF8_BYTE_1_HIGH
+#undef REMAC_UTF8_BYTE_1_LOW
+#undef REMAC_UTF8_BYTE_2_HIGH
+
+#endif
+
+bool isValidUtf8(const char *stringStart, const char *stringEnd) {
+#ifdef REMAC_X86_SIMD
+    SimdLevel level = getSimdLevel();
+
+    if (level >= SimdLevel::SIMD_AVX2) {
+        return isValidUtf8Avx2(stringStart, stringEnd);
+    }
+
+    if (level >= SimdLevel::SIMD_SSE4) {
+        return isValidUtf8Sse4(stringStart, stringEnd);
     }
+#endif
 
-    return ptr == stringEnd;
+    return findInvalidUtf8(stringStart, stringEnd) == stringEnd;
 }
 
 std::string utfCharToString(Utf8Char chr) {
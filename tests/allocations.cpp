@@ -0,0 +1,43 @@
+#include "allocations.hpp"
+
+#include <cstdlib>
+#include <new>
+
+static unsigned long ALLOCATIONS = 0;
+
+unsigned long test_allocation_count() {
+    return ALLOCATIONS;
+}
+
+void *operator new(std::size_t size) {
+    ++ALLOCATIONS;
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t size) noexcept {
+    (void)size;
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t size) noexcept {
+    (void)size;
+    std::free(ptr);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#ifndef REMAC_TESTALLOCATIONS
+#define REMAC_TESTALLOCATIONS 1
+
+/**
+ * Count of calls to global operator new since program start. Test binary
+    replaces global operator new, so allocations of any code can be counted.
+ */
+unsigned long test_allocation_count();
+
+#endif // REMAC_TESTALLOCATIONS
@@ -0,0 +1,160 @@
+#include "astformat.hpp"
+
+#include <remac/astformat.hpp>
+#include <remac/lexer.hpp>
+#include <remac/parser.hpp>
+#include <remac/symbols.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Message of AstFormatException, thrown by loading `bytes`, or empty string,
+    if they are loaded.
+ */
+static std::string loadError(std::string_view bytes) {
+    remac::SymbolTable symbols;
+
+    try {
+        delete remac::AstFormat::load(bytes, &symbols);
+    } catch (remac::AstFormatException *exc) {
+        std::string message = exc->message;
+        delete exc;
+        return message;
+    }
+
+    return "";
+}
+
+void test_astformat() {
+    test_module("AST format");
+
+    // Node of each class is saved and loaded back into another table
+    remac::SymbolTable symbols;
+    symbols.intern("unused");
+    remac::ProgramNode program(new remac::SequenceNode({
+        new remac::WhileStatementNode(new remac::OperationLessNode(
+            new remac::VariableReferenceNode(&symbols, symbols.intern("i")),
+            new remac::OperationNegateNode(new remac::IntConstantNode(-9000000000LL))
+        ), new remac::SequenceNode({})),
+        new remac::ForStatementNode(
+            new remac::SequenceNode({ new remac::VariableAssignmentNode(&symbols, symbols.intern("i"), new remac::IntConstantNode(0)) }),
+            new remac::OperationNotEqualNode(
+                new remac::OperationEqualNode(new remac::FloatConstantNode(0.1), new remac::FloatConstantNode(-2.5e300)),
+                new remac::OperationGreaterEqualNode(new remac::IntConstantNode(1), new remac::IntConstantNode(2))
+            ),
+            new remac::SequenceNode({ new remac::FunctionCallNode(&symbols, symbols.intern("Next"), new remac::SequenceNode({})) }),
+            new remac::SequenceNode({
+                new remac::ListSliceNode(
+                    new remac::ListDefinitionNode(new remac::SequenceNode({ new remac::StringConstantNode(&symbols, symbols.intern("text \"\xd0\xb6\"")) })),
+                    new remac::OperationModNode(
+                        new remac::OperationDivideNode(new remac::IntConstantNode(7), new remac::IntConstantNode(2)),
+                        new remac::OperationMultiplyNode(new remac::IntConstantNode(3), new remac::IntConstantNode(4))
+                    )
+                ),
+                new remac::IfStatementNode(
+                    new remac::OperationLessEqualNode(new remac::IntConstantNode(1), new remac::OperationGreaterNode(new remac::IntConstantNode(2), new remac::IntConstantNode(3))),
+                    new remac::SequenceNode({ new remac::OperationAddNode(new remac::IntConstantNode(1), new remac::OperationSubtractNode(new remac::IntConstantNode(2), new remac::IntConstantNode(3))) }),
+                    new remac::SequenceNode({})
+                ),
+            })
+        ),
+    }));
+    std::string bytes = remac::AstFormat::save(&program, &symbols);
+    remac::SymbolTable otherSymbols;
+    otherSymbols.intern("first");
+    remac::ProgramNode *loaded = remac::AstFormat::load(bytes, &otherSymbols);
+    test_condition(loaded->equals(&program) && loaded->toString() == program.toString());
+    // Loaded program is saved with the same bytes, but for names of its table
+    test_condition(remac::AstFormat::save(loaded, &otherSymbols).size() == bytes.size() + std::string("first").size() + 4);
+    delete loaded;
+
+    // Missing else body is kept missing
+    remac::ProgramNode withoutElse(new remac::SequenceNode({
+        new remac::IfStatementNode(new remac::IntConstantNode(1), new remac::SequenceNode({}), nullptr),
+    }));
+    remac::ProgramNode *loadedWithoutElse = remac::AstFormat::load(remac::AstFormat::save(&withoutElse, &symbols), &symbols);
+    remac::IfStatementNode *loadedIf = static_cast<remac::IfStatementNode *>(loadedWithoutElse->getBody()->getNode(0));
+    test_condition(loadedIf->getElseBody() == nullptr && loadedIf->getBody()->getCount() == 0);
+    delete loadedWithoutElse;
+
+    // Parsed program survives round trip
+    std::string code = "if (x > 1) {\n    Print(\"a\", -y * 2, 2.5)\n} else {\n    G(x == 3, F(1))\n}";
+    remac::Lexer lexer(code);
+    remac::Parser parser(&lexer, &symbols);
+    remac::ProgramNode *parsed = parser.parse();
+    remac::ProgramNode *parsedLoaded = remac::AstFormat::load(remac::AstFormat::save(parsed, &symbols), &symbols);
+    test_condition(parsedLoaded->equals(parsed));
+    delete parsedLoaded;
+    delete parsed;
+
+    // Numbers are little-endian, and each node starts with its tag
+    remac::IntConstantNode number(0x0102030405060708LL);
+    unsigned char numberBytes[9];
+    unsigned long numberLength = number.toBytes(numberBytes);
+    test_condition(
+        numberLength == number.getByteLength() && numberLength == 9 &&
+        numberBytes[0] == remac::AstNode::NodeType::NODE_INT_CONSTANT && numberBytes[1] == 0x08 && numberBytes[8] == 0x01
+    );
+    test_condition(bytes.compare(0, 4, "RMAC") == 0 && bytes[4] == remac::AstFormat::VERSION && bytes[5] == 0);
+
+    // Broken bytes are rejected, and nothing is leaked or read out of bounds
+    bool truncatedRejected = true;
+
+    for (unsigned long length = 0; length < bytes.size(); length++) {
+        truncatedRejected = truncatedRejected && !loadError(std::string_view(bytes).substr(0, length)).empty();
+    }
+
+    test_condition(truncatedRejected && loadError(bytes).empty());
+    std::string otherVersion = bytes;
+    otherVersion[4] = remac::AstFormat::VERSION + 1;
+    std::string otherFlags = bytes;
+    otherFlags[6] = 1;
+    std::string otherMagic = bytes;
+    otherMagic[0] = 'X';
+    remac::SymbolTable emptySymbols;
+    remac::ProgramNode single(new remac::SequenceNode({ new remac::IntConstantNode(1) }));
+    std::string wrongTag = remac::AstFormat::save(&single, &emptySymbols);
+    // Header, then program, sequence and its count, then tag of the constant
+    wrongTag[remac::AstFormat::HEADER_SIZE + 6] = (char)0xFF;
+    test_condition(
+        loadError(otherVersion) == "Unsupported version of AST: " + std::to_string(remac::AstFormat::VERSION + 1) &&
+        loadError(otherFlags) == "Unsupported flags of AST: 1" &&
+        loadError(otherMagic) == "Not an AST" &&
+        loadError(bytes + '\0') == "Unexpected bytes after program" &&
+        loadError(wrongTag) == "Unexpected node tag 255"
+    );
+
+    // Deep trees are saved and loaded without recursion: parsed chain of 100k operands,
+    // and crafted file with 1M nested negations, which is rejected in place, when cut
+    std::string chain = "F(x0";
+
+    for (unsigned long i = 1; i < 100000; i++) {
+        chain += " - x" + std::to_string(i);
+    }
+
+    chain += ")";
+    remac::Lexer chainLexer(chain);
+    remac::Parser chainParser(&chainLexer, &symbols);
+    remac::ProgramNode *chainProgram = chainParser.parse();
+    std::string chainBytes = remac::AstFormat::save(chainProgram, &symbols);
+    remac::ProgramNode *chainLoaded = remac::AstFormat::load(chainBytes, &symbols);
+    test_condition(remac::AstFormat::save(chainLoaded, &symbols) == chainBytes);
+    delete chainLoaded;
+    delete chainProgram;
+    std::string negations = remac::AstFormat::save(&single, &emptySymbols);
+    negations.insert(remac::AstFormat::HEADER_SIZE + 6, std::string(1000000, (char)remac::AstNode::NodeType::NODE_OPERATION_NEGATE));
+    remac::ProgramNode *negationsLoaded = remac::AstFormat::load(negations, &emptySymbols);
+    remac::AstNode *negation = negationsLoaded->getBody()->getNode(0);
+    unsigned long depth = 0;
+
+    while (negation->getType() == remac::AstNode::NodeType::NODE_OPERATION_NEGATE) {
+        negation = static_cast<remac::OperationNegateNode *>(negation)->getValue();
+        depth++;
+    }
+
+    test_condition(depth == 1000000 && static_cast<remac::IntConstantNode *>(negation)->getValue() == 1);
+    delete negationsLoaded;
+    test_condition(loadError(negations.substr(0, negations.size() - 1)) == "Unexpected end of AST");
+}
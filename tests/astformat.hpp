@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_TESTASTFORMAT
+#define REMAC_TESTASTFORMAT 1
+
+#include "testmain.hpp"
+
+void test_astformat();
+
+#endif // REMAC_TESTASTFORMAT
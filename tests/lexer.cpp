@@ -0,0 +1,520 @@
+#include "lexer.hpp"
+#include "allocations.hpp"
+
+#include <remac/lexer.hpp>
+#include <remac/symbols.hpp>
+#include <remac/tokens.hpp>
+
+#include <optional>
+#include <sstream>
+#include <utility>
+#include <string>
+#include <vector>
+
+/**
+ * Tokens point to memory of lexer, so pass temporary lexer here: it lives
+    until the end of full expression, where tokens are checked.
+ */
+static std::vector<remac::Token> lex(remac::Lexer &&lexer) {
+    std::vector<remac::Token> tokens;
+    std::optional<remac::Token> token = lexer.next();
+
+    while (token.has_value()) {
+        tokens.push_back(*token);
+
+        if (token->type == remac::TokenType::LEXER_ERROR) {
+            break;
+        }
+
+        token = lexer.next();
+    }
+
+    return tokens;
+}
+
+/**
+ * Positions are computed only on request, from the offset of token.
+ */
+static bool samePosition(remac::Lexer lexer, const remac::Token &token, unsigned long line, unsigned long column) {
+    remac::SourcePosition position = lexer.locate(token.offset);
+    return position.line == line && position.column == column;
+}
+
+static bool sameTokens(std::vector<remac::Token> tokens, std::vector<remac::Token> expected) {
+    if (tokens.size() != expected.size()) {
+        return false;
+    }
+
+    for (unsigned long i = 0; i < tokens.size(); i++) {
+        if (
+            tokens[i].type != expected[i].type || tokens[i].content != expected[i].content ||
+            tokens[i].offset != expected[i].offset ||
+            tokens[i].keyword != expected[i].keyword || tokens[i].oper != expected[i].oper
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Lexes program in memory and streamed in blocks of `blockSize` bytes side
+    by side, because streamed tokens live only until the next one.
+ */
+static bool sameWhenStreamed(std::string program, unsigned long blockSize) {
+    std::istringstream input(program);
+    remac::Lexer whole(program);
+    remac::Lexer streamed(remac::SourceStream(input, blockSize));
+
+    while (true) {
+        std::optional<remac::Token> expected = whole.next();
+        std::optional<remac::Token> token = streamed.next();
+
+        if (!expected.has_value() || !token.has_value()) {
+            return expected.has_value() == token.has_value();
+        }
+
+        remac::SourcePosition position = streamed.locate(token->offset);
+        remac::SourcePosition expectedPosition = whole.locate(expected->offset);
+
+        if (
+            !sameTokens({ *token }, { *expected }) ||
+            position.line != expectedPosition.line || position.column != expectedPosition.column
+        ) {
+            return false;
+        }
+
+        if (token->type == remac::TokenType::LEXER_ERROR) {
+            return true;
+        }
+    }
+}
+
+static bool sameWhenStreamedInBlocks(std::string program) {
+    for (unsigned long blockSize = 1; blockSize <= 70; blockSize++) {
+        if (!sameWhenStreamed(program, blockSize)) {
+            return false;
+        }
+    }
+
+    return sameWhenStreamed(program, remac::SourceStream::DEFAULT_BLOCK_SIZE);
+}
+
+/**
+ * Packed tokens unpack to the same tokens, as next() returns (with the same
+    positions), and packing stops at the same error.
+ */
+static bool sameWhenPacked(std::string program) {
+    remac::Lexer lexer(program);
+    remac::Lexer packingLexer(program);
+    remac::PackedTokens packed;
+    std::optional<remac::Token> error = packingLexer.fill(&packed);
+
+    for (unsigned long i = 0; i < packed.size(); i++) {
+        std::optional<remac::Token> token = lexer.next();
+
+        if (!token.has_value() || !sameTokens({ packed.get(i) }, { *token })) {
+            return false;
+        }
+
+        remac::SourcePosition position = packed.getPosition(i);
+        remac::SourcePosition expected = lexer.locate(token->offset);
+
+        if (position.line != expected.line || position.column != expected.column) {
+            return false;
+        }
+    }
+
+    std::optional<remac::Token> last = lexer.next();
+
+    if (!error.has_value() || !last.has_value()) {
+        return error.has_value() == last.has_value();
+    }
+
+    return sameTokens({ *error }, { *last });
+}
+
+/**
+ * Lexing in parallel chunks of every size up to `maxChunkSize` gives the
+    same tokens and error, as lexing in one pass.
+ */
+static bool sameWhenParallel(std::string program, unsigned long maxChunkSize) {
+    remac::Lexer lexer(program);
+    remac::PackedTokens expected;
+    std::optional<remac::Token> expectedError = lexer.fill(&expected);
+
+    for (unsigned long chunkSize = 1; chunkSize <= maxChunkSize; chunkSize++) {
+        for (unsigned long threadCount : { 2, 3 }) {
+            remac::Lexer parallelLexer(program);
+            remac::PackedTokens tokens;
+            std::optional<remac::Token> error = parallelLexer.fillParallel(&tokens, threadCount, chunkSize);
+
+            if (tokens.size() != expected.size() || error.has_value() != expectedError.has_value()) {
+                return false;
+            }
+
+            if (error.has_value() && !sameTokens({ *error }, { *expectedError })) {
+                return false;
+            }
+
+            for (unsigned long i = 0; i < tokens.size(); i++) {
+                if (!sameTokens({ tokens.get(i) }, { expected.get(i) })) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Every edit of program (at each offset, removing up to 2 bytes and
+    inserting each of `insertions`) is relexed by lexer of program and
+    compared with relexing of whole edited code. Tokens outside of reported
+    change must be the old ones, moved by edit.
+ */
+static bool sameWhenRelexed(std::string program, std::vector<std::string> insertions) {
+    for (unsigned long offset = 0; offset <= program.size(); offset++) {
+        for (unsigned long removed = 0; removed <= 2 && offset + removed <= program.size(); removed++) {
+            for (const std::string &inserted : insertions) {
+                remac::Lexer oldLexer(program);
+                remac::PackedTokens old;
+                oldLexer.fill(&old);
+                remac::Lexer lexer(program);
+                remac::PackedTokens tokens;
+                std::optional<remac::Token> oldError = lexer.fill(&tokens);
+                remac::TokenChange change;
+                std::optional<remac::Token> error = lexer.relex(&tokens, remac::TextEdit { .offset = offset, .removed = removed, .inserted = inserted }, &change);
+
+                std::string edited = program.substr(0, offset) + inserted + program.substr(offset + removed);
+                remac::Lexer wholeLexer("");
+                remac::PackedTokens expected;
+                remac::TokenChange wholeChange;
+                wholeLexer.fill(&expected);
+                std::optional<remac::Token> expectedError = wholeLexer.relex(&expected, remac::TextEdit { .offset = 0, .removed = 0, .inserted = edited }, &wholeChange);
+
+                if (tokens.size() != expected.size() || error.has_value() != expectedError.has_value()) {
+                    return false;
+                }
+
+                if (error.has_value() && !sameTokens({ *error }, { *expectedError })) {
+                    return false;
+                }
+
+                for (unsigned long i = 0; i < tokens.size(); i++) {
+                    if (!sameTokens({ tokens.get(i) }, { expected.get(i) })) {
+                        return false;
+                    }
+                }
+
+                // Tokens outside of change are kept, unless lexing stopped at error
+                if (!oldError.has_value() && !error.has_value()) {
+                    unsigned long tail = old.size() - change.start - change.removed;
+
+                    if (change.start + change.inserted + tail != tokens.size()) {
+                        return false;
+                    }
+
+                    for (unsigned long i = 0; i < change.start; i++) {
+                        if (!sameTokens({ tokens.get(i) }, { old.get(i) })) {
+                            return false;
+                        }
+                    }
+
+                    for (unsigned long i = 0; i < tail; i++) {
+                        remac::Token moved = old.get(change.start + change.removed + i);
+                        moved.offset += inserted.size() - removed;
+
+                        if (!sameTokens({ tokens.get(change.start + change.inserted + i) }, { moved })) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Reference longest match: operator from OPERATORS, which is the longest
+    prefix of text.
+ */
+static const remac::OperatorSpelling *longestOperator(std::string_view text) {
+    const remac::OperatorSpelling *longest = nullptr;
+
+    for (const remac::OperatorSpelling &spelling : remac::OPERATORS) {
+        if (text.substr(0, spelling.text.size()) == spelling.text && (longest == nullptr || spelling.text.size() > longest->text.size())) {
+            longest = &spelling;
+        }
+    }
+
+    return longest;
+}
+
+/**
+ * Every two operators, written together and apart, are split into operators
+    by longest match.
+ */
+static bool operatorPairsLexed() {
+    for (const remac::OperatorSpelling &first : remac::OPERATORS) {
+        for (const remac::OperatorSpelling &second : remac::OPERATORS) {
+            for (std::string separator : { "", " " }) {
+                std::string operators = std::string(first.text) + separator + std::string(second.text);
+                std::vector<remac::Token> expected = { { .type = remac::TokenType::IDENTIFIER, .content = "x", .offset = 0 } };
+                unsigned long offset = 0;
+
+                while (offset < operators.size()) {
+                    if (operators[offset] == ' ') {
+                        offset++;
+                        continue;
+                    }
+
+                    const remac::OperatorSpelling *oper = longestOperator(std::string_view(operators).substr(offset));
+                    expected.push_back({ .type = remac::TokenType::OPERATOR, .content = oper->text, .offset = 1 + offset, .oper = oper->oper });
+                    offset += oper->text.size();
+                }
+
+                expected.push_back({ .type = remac::TokenType::IDENTIFIER, .content = "y", .offset = 1 + offset });
+
+                if (!sameTokens(lex(remac::Lexer("x" + operators + "y")), expected)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void test_lexer() {
+    test_module("Lexer");
+    test_condition(sameTokens(lex(remac::Lexer("Print(abc_1, 23, 4.5)")), {
+        remac::Token { remac::TokenType::IDENTIFIER, "Print", 0 },
+        remac::Token { remac::TokenType::LPAREN, "(", 5 },
+        remac::Token { remac::TokenType::IDENTIFIER, "abc_1", 6 },
+        remac::Token { remac::TokenType::ARG_SEPARATOR, ",", 11 },
+        remac::Token { remac::TokenType::INT_NUMBER, "23", 13 },
+        remac::Token { remac::TokenType::ARG_SEPARATOR, ",", 15 },
+        remac::Token { remac::TokenType::FLOAT_NUMBER, "4.5", 17 },
+        remac::Token { remac::TokenType::RPAREN, ")", 20 },
+    }));
+    test_condition(sameTokens(lex(remac::Lexer("\n\t  Print(\n  x)")), {
+        remac::Token { remac::TokenType::IDENTIFIER, "Print", 4 },
+        remac::Token { remac::TokenType::LPAREN, "(", 9 },
+        remac::Token { remac::TokenType::IDENTIFIER, "x", 13 },
+        remac::Token { remac::TokenType::RPAREN, ")", 14 },
+    }));
+    std::string indented = "\n\t  Print(\n  x)";
+    test_condition(samePosition(remac::Lexer(indented), lex(remac::Lexer(indented))[2], 3, 3));
+    // Keywords come out of lexer typed, words, that only look like them, don't
+    std::vector<remac::Token> branches = lex(remac::Lexer("if (x) { f(1) } else if (y) { f(2) } else { f(3) }"));
+    test_condition(
+        branches.size() == 28 && branches[0].keyword == remac::Keyword::KEYWORD_IF && branches[10].keyword == remac::Keyword::KEYWORD_ELSE &&
+        branches[11].type == remac::TokenType::KEYWORD && branches[11].keyword == remac::Keyword::KEYWORD_IF &&
+        branches[21].keyword == remac::Keyword::KEYWORD_ELSE && branches[27].type == remac::TokenType::RBRACE
+    );
+    std::vector<remac::Token> lookalikes = lex(remac::Lexer("Print(ifx, fo, whilee, For, e, elsewhere)"));
+    bool allIdentifiers = lookalikes.size() == 14;
+
+    for (unsigned long i = 2; i < lookalikes.size() && allIdentifiers; i += 2) {
+        allIdentifiers = lookalikes[i].type == remac::TokenType::IDENTIFIER && lookalikes[i].keyword == remac::Keyword::KEYWORD_NONE;
+    }
+
+    test_condition(allIdentifiers);
+    test_condition(lex(remac::Lexer("if (x) { f(1) } else g")).back().type == remac::TokenType::LEXER_ERROR);
+    // Keyword may be followed by another word only in "else if"
+    bool keywordPairsRejected = true;
+
+    for (std::string pair : { "if while (x) { f(1) }", "while while (x) { f(1) }", "for if (x) { f(1) }", "if if (x) { f(1) }", "while x" }) {
+        keywordPairsRejected = keywordPairsRejected && lex(remac::Lexer(pair))[1].type == remac::TokenType::LEXER_ERROR;
+    }
+
+    test_condition(keywordPairsRejected);
+    test_condition(operatorPairsLexed());
+    test_condition(lex(remac::Lexer("x ! y"))[1].type == remac::TokenType::LEXER_ERROR);
+    // Identifiers can't start with digit or underscore
+    test_condition(lex(remac::Lexer("_x"))[0].type == remac::TokenType::LEXER_ERROR);
+    test_condition(lex(remac::Lexer("Print(1abc)")).back().type == remac::TokenType::LEXER_ERROR);
+    // Unicode letters make identifiers, other non-ASCII chars don't
+    test_condition(sameTokens(lex(remac::Lexer("\xd0\x9f\xd0\xb5\xd1\x87\xd0\xb0\xd1\x82\xd1\x8c(\xd0\xbc\xd0\xb8\xd1\x80_1, x)")), {
+        { .type = remac::TokenType::IDENTIFIER, .content = "\xd0\x9f\xd0\xb5\xd1\x87\xd0\xb0\xd1\x82\xd1\x8c", .offset = 0 },
+        { .type = remac::TokenType::LPAREN, .content = "(", .offset = 12 },
+        { .type = remac::TokenType::IDENTIFIER, .content = "\xd0\xbc\xd0\xb8\xd1\x80_1", .offset = 13 },
+        { .type = remac::TokenType::ARG_SEPARATOR, .content = ",", .offset = 21 },
+        { .type = remac::TokenType::IDENTIFIER, .content = "x", .offset = 23 },
+        { .type = remac::TokenType::RPAREN, .content = ")", .offset = 24 },
+    }));
+    test_condition(lex(remac::Lexer("\xe2\x82\xac"))[0].type == remac::TokenType::LEXER_ERROR);
+    // Code is lexed up to invalid UTF-8, which is reported in place
+    std::vector<remac::Token> invalid = lex(remac::Lexer("Print(x,\n  \xc0\x80)"));
+    test_condition(invalid.size() == 5 && invalid[4].type == remac::TokenType::LEXER_ERROR && invalid[4].offset == 11);
+    test_condition(samePosition(remac::Lexer("Print(x,\n  \xc0\x80)"), invalid[4], 2, 3));
+    std::vector<remac::Token> invalidString = lex(remac::Lexer("Print(\"ab\xff\")"));
+    test_condition(invalidString.back().type == remac::TokenType::LEXER_ERROR && invalidString.back().content == "Invalid UTF-8");
+
+    // Columns are counted in chars, CRLF and single CR are both one line break
+    std::string cyrillic = "Print(\"\xd0\xb6\xd0\xb6\", x)";
+    test_condition(samePosition(remac::Lexer(cyrillic), lex(remac::Lexer(cyrillic))[4], 1, 13));
+    std::string crlf = "Print(\"a\r\nb\", x)";
+    test_condition(samePosition(remac::Lexer(crlf), lex(remac::Lexer(crlf))[4], 2, 5));
+    std::string cr = "Print(\"a\rb\", x)";
+    test_condition(samePosition(remac::Lexer(cr), lex(remac::Lexer(cr))[4], 2, 5));
+
+    remac::Lexer strings("Print(\"plain\", \"esc\\tape\")");
+    std::vector<remac::Token> stringTokens = lex(std::move(strings));
+    test_condition(stringTokens.size() == 6 && stringTokens[2].content == "plain" && stringTokens[4].content == "esc\tape");
+
+    // Escapes are decoded, runs between them may cross SIMD blocks
+    std::string run(40, 'x');
+    std::string escapes = "F(\"\\n\\r\\t\\\\\\\"\\'" + run + "\\u0416\\u20AC\\u00e9" + run + "\", 'it\\'s \"q\"')";
+    remac::Lexer escapeLexer(escapes);
+    std::vector<remac::Token> escapeTokens = lex(std::move(escapeLexer));
+    test_condition(
+        escapeTokens.size() == 6 && escapeTokens[2].content == "\n\r\t\\\"'" + run + "\xd0\x96\xe2\x82\xac\xc3\xa9" + run &&
+        escapeTokens[4].content == "it's \"q\""
+    );
+    test_condition(sameWhenStreamedInBlocks(escapes));
+    test_condition(lex(remac::Lexer("F(\"a\\qb\")")).back().offset == 4);
+    test_condition(lex(remac::Lexer("F(\"\\uD800\")")).back().type == remac::TokenType::LEXER_ERROR);
+    test_condition(lex(remac::Lexer("F(\"\\u12\")")).back().type == remac::TokenType::LEXER_ERROR);
+    test_condition(lex(remac::Lexer("F(\"abc\\\"")).back().content == "Unexpected end of program. String is left unterminated");
+
+    // Tokens point to source code, so lexing doesn't allocate at all
+    std::string program = "Main(";
+
+    for (unsigned long i = 0; i < 1000; i++) {
+        program += "some_long_identifier_name + other_long_identifier_name * 12345, ";
+    }
+
+    program += "0)";
+    remac::Lexer lexer(program);
+    unsigned long tokenCount = 0;
+    unsigned long allocations = test_allocation_count();
+    std::optional<remac::Token> token = lexer.next();
+
+    while (token.has_value() && token->type != remac::TokenType::LEXER_ERROR) {
+        ++tokenCount;
+        token = lexer.next();
+    }
+
+    allocations = test_allocation_count() - allocations;
+    test_condition(!token.has_value() && tokenCount == 6004 && allocations == 0);
+
+    // Tokens, whitespaces, CRLF and UTF-8 chars are split between blocks at every offset
+    test_condition(sameWhenStreamedInBlocks(
+        "if (Печать_1 > 2.25) {\n    Print(\"мир\r\n€\", 'x y')\n} else if (y <= 10) {\n\n\n"
+        "        F([1, 2.5], очень_длинный_идентификатор_переменной)\n} else {\n    G(a = b, \"𝄞\r\")\n}"
+    ));
+    test_condition(sameWhenStreamedInBlocks("Print(x, 1.)"));
+    test_condition(sameWhenStreamedInBlocks("Print(\"unterminated"));
+    test_condition(sameWhenStreamedInBlocks("Print(мир\xD0"));
+    test_condition(sameWhenStreamedInBlocks("Print(abc\xE2\x82x)"));
+    test_condition(sameWhenStreamedInBlocks("Print(\"a\xF0\x9F\x98"));
+
+    std::string unicodeProgram =
+        "if (Печать_1 > 2.25) {\n    Print(\"мир\r\n€\", 'x y')\n} else if (y <= 10) {\n\n\n"
+        "        F([1, 2.5], \"esc\\tape \\u0416\\\"\", очень_длинный_идентификатор_переменной)\n} else {\n    G(a = b, \"𝄞\r\")\n}";
+    test_condition(sameWhenPacked(unicodeProgram) && sameWhenPacked(program) && sameWhenPacked("Print(x, 1.)"));
+
+    // Chunks start at line starts inside of strings and identifiers, and errors are found in them
+    test_condition(sameWhenParallel(unicodeProgram, 40) && sameWhenParallel("Print(x, 1.)", 12));
+    test_condition(sameWhenParallel("Print(\"a\nb(\", \"\n\", 'c\n)\n\"', long_identifier_name, 12345678.5)", 40));
+    test_condition(sameWhenParallel("F(\"\n@\n\", [x\n, \"\n\n)\"], y z, w)", 30));
+    test_condition(sameWhenParallel("if (x) {\n\tF(1)\n} else {\n\tG(2) ]\n}", 30));
+    test_condition(sameWhenParallel("Print(\"ab\nc\", x\n)\xff", 20) && sameWhenParallel("Print(\"ab\nc\n\xd0", 20));
+    remac::Lexer parallelLexer(program);
+    remac::PackedTokens parallelTokens;
+    test_condition(!parallelLexer.fillParallel(&parallelTokens, 4, 1000).has_value() && parallelTokens.size() == 6004);
+
+    // Edits make and break identifiers, numbers, strings and escapes, so relexing meets old tokens at different distances
+    std::vector<std::string> insertions = { "", "x", " ", "\"", "1.", "\\", "(", "\xff" };
+    test_condition(sameWhenRelexed("Print(x, 1.5, \"a b\", y)", insertions));
+    test_condition(sameWhenRelexed("if (x >= 2) {\n\tF(\"esc\\tape\", [a, 3])\n} else {\n\tG(b)\n}", insertions));
+    test_condition(sameWhenRelexed("F(\"\u0416\", \u0416\u0416_1)", insertions) && sameWhenRelexed("", insertions));
+    test_condition(sameWhenRelexed("Print(x, @)", insertions));
+    test_condition(sameWhenRelexed("F(\"abc' + 'd\", 'e')", { "", "'", "\"", "x" }));
+
+    // Relexing of edit in the middle of big program stops near the edit
+    remac::SymbolTable symbols;
+    remac::Lexer relexingLexer(program);
+    remac::PackedTokens relexed;
+    remac::TokenChange change;
+    relexingLexer.setSymbols(&symbols);
+    relexingLexer.fill(&relexed);
+    unsigned long editOffset = relexed.getOffset(3002);
+    test_condition(!relexingLexer.relex(&relexed, remac::TextEdit { .offset = editOffset, .removed = 0, .inserted = "renamed_" }, &change).has_value());
+    test_condition(change.removed <= 4 && change.inserted == change.removed && relexed.size() == 6004);
+    test_condition(relexed.getContent(3002).substr(0, 8) == "renamed_" && symbols.getName(relexed.getSymbol(3002)) == relexed.getContent(3002));
+    test_condition(!relexingLexer.relex(&relexed, remac::TextEdit { .offset = editOffset, .removed = 8, .inserted = "" }, &change).has_value());
+    remac::Lexer unchangedLexer(program);
+    remac::PackedTokens unchanged;
+    unchangedLexer.fill(&unchanged);
+    bool sameAfterUndo = relexed.size() == unchanged.size();
+
+    for (unsigned long i = 0; sameAfterUndo && i < relexed.size(); i++) {
+        sameAfterUndo = sameTokens({ relexed.get(i) }, { unchanged.get(i) });
+    }
+
+    test_condition(sameAfterUndo && relexingLexer.locate(relexed.getOffset(6003)).line == unchangedLexer.locate(unchanged.getOffset(6003)).line);
+
+    // Parens and braces are matched at any depth, unmatched closing one is an error
+    std::string nested = std::string(100, '(') + "x" + std::string(100, ')');
+    test_condition(lex(remac::Lexer("F" + nested)).back().type == remac::TokenType::RPAREN);
+    std::vector<remac::Token> mismatched = lex(remac::Lexer("if (x) {" + std::string(50, '(') + "x" + std::string(49, ')') + "}"));
+    test_condition(mismatched.back().type == remac::TokenType::LEXER_ERROR && mismatched.size() == 106);
+    test_condition(lex(remac::Lexer("x)")).back().type == remac::TokenType::LEXER_ERROR);
+    std::vector<remac::Token> afterBrace = lex(remac::Lexer("if (x) { F(1) } + y"));
+    test_condition(afterBrace.size() == 12 && afterBrace[10].type == remac::TokenType::OPERATOR);
+
+    // Shallow nesting is kept inside of validator, so validation doesn't allocate
+    std::vector<remac::Token> shallow = lex(remac::Lexer("if (x) { F((1), [G(H(2))]) } else { I(3) }"));
+    allocations = test_allocation_count();
+    remac::TokenValidator validator;
+    bool valid = true;
+
+    for (const remac::Token &token : shallow) {
+        valid = valid && !validator.check(token).has_value();
+    }
+
+    test_condition(valid && test_allocation_count() == allocations);
+
+    // Recovery mode reports all errors, skipping erroneous text, and reports no errors in valid code
+    remac::Lexer recovering("Print(@x, 1.2.3, y z, \"a\xff\xbf b\", w\xc0)\xf0");
+    recovering.setRecovering(true);
+    remac::PackedTokens recovered;
+    test_condition(!recovering.fill(&recovered).has_value() && recovered.size() == 9);
+    test_condition(recovered.getContent(5) == "z" && recovered.getContent(7) == "b" && recovered.getContent(8) == ")");
+    std::vector<remac::Token> diagnostics = recovering.getDiagnostics();
+    test_condition(
+        diagnostics.size() == 6 && diagnostics[0].offset == 6 && diagnostics[1].offset == 10 && diagnostics[2].offset == 19 &&
+        diagnostics[3].offset == 24 && diagnostics[4].offset == 32 && diagnostics[5].offset == 34
+    );
+    remac::Lexer recoveringValid(program);
+    recoveringValid.setRecovering(true);
+    std::vector<remac::Token> validTokens = lex(std::move(recoveringValid));
+    test_condition(sameTokens(validTokens, lex(remac::Lexer(program))) && recoveringValid.getDiagnostics().empty());
+
+    // Token takes 10 bytes in packed buffer, and arrays are at most twice bigger, than needed
+    remac::Lexer packingLexer(program);
+    remac::PackedTokens packed;
+    test_condition(!packingLexer.fill(&packed).has_value() && packed.size() == 6004 && packed.getByteSize() <= packed.size() * 20);
+
+    // Only window of text is buffered, so streaming doesn't allocate per token
+    std::istringstream input(program);
+    remac::Lexer streamed(remac::SourceStream(input, 4096));
+    tokenCount = 0;
+    allocations = test_allocation_count();
+    token = streamed.next();
+
+    while (token.has_value() && token->type != remac::TokenType::LEXER_ERROR) {
+        ++tokenCount;
+        token = streamed.next();
+    }
+
+    allocations = test_allocation_count() - allocations;
+    test_condition(!token.has_value() && tokenCount == 6004 && allocations <= 2);
+}
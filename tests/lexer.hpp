@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_TESTLEXER
+#define REMAC_TESTLEXER 1
+
+#include "testmain.hpp"
+
+void test_lexer();
+
+#endif // REMAC_TESTLEXER
@@ -1,6 +1,18 @@
 #include "testmain.hpp"
+#include "./astformat.hpp"
+#include "./lexer.hpp"
 #include "./parser.hpp"
+#include "./scan.hpp"
+#include "./source.hpp"
+#include "./symbols.hpp"
+#include "./utf8.hpp"
 
 void test_main() {
+    test_astformat();
+    test_lexer();
     test_parser();
+    test_source();
+    test_scan();
+    test_symbols();
+    test_utf8();
 }
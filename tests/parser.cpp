@@ -1,18 +1,309 @@
 #include "parser.hpp"
+#include "allocations.hpp"
 
+#include <remac/flatast.hpp>
+#include <remac/lexer.hpp>
 #include <remac/parser.hpp>
+#include <remac/source.hpp>
+#include <remac/symbols.hpp>
+#include <remac/tokens.hpp>
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static std::vector<remac::Token> lexAll(remac::Lexer *lexer) {
+    std::vector<remac::Token> tokens;
+    std::optional<remac::Token> token = lexer->next();
+
+    while (token.has_value()) {
+        tokens.push_back(*token);
+        token = lexer->next();
+    }
+
+    return tokens;
+}
 
 void test_parser() {
     test_module("Parser");
     std::vector<remac::Token> tokens;
-    tokens.push_back(remac::Token { remac::TokenType::IDENTIFIER, "Print", 1, 1 });
-    tokens.push_back(remac::Token { remac::TokenType::LPAREN, "(", 1, 6 });
-    tokens.push_back(remac::Token { remac::TokenType::RPAREN, ")", 1, 7 });
-    remac::Parser parser(tokens);
+    tokens.push_back(remac::Token { remac::TokenType::IDENTIFIER, "Print", 0 });
+    tokens.push_back(remac::Token { remac::TokenType::LPAREN, "(", 5 });
+    tokens.push_back(remac::Token { remac::TokenType::RPAREN, ")", 6 });
+    remac::SymbolTable symbols;
+    remac::Parser parser(std::move(tokens), &symbols);
     remac::ProgramNode *program = parser.parse();
     test_condition(program->equals(new remac::ProgramNode(
         new remac::SequenceNode({
-            new remac::FunctionCallNode("Print", new remac::SequenceNode({}))
+            new remac::FunctionCallNode(&symbols, symbols.intern("Print"), new remac::SequenceNode({}))
         })
     )));
+
+    // Streamed tokens are pulled through ring, which is smaller than statement, so it grows
+    std::string code = "if (x) {\n    Print(\"a\", y, 2.5)\n} else if (y) {\n    F(a, b)\n} else {\n    G(3)\n}";
+    std::istringstream input(code);
+    remac::Lexer streamed(remac::SourceStream(input, 7));
+    remac::Parser streamedParser(&streamed, &symbols);
+    remac::Lexer whole(code);
+    remac::Parser wholeParser(lexAll(&whole), &symbols);
+    remac::Lexer packingLexer(code);
+    remac::PackedTokens packed;
+    packingLexer.setSymbols(&symbols);
+    packingLexer.fill(&packed);
+    remac::Parser packedParser(&packed, &symbols);
+    remac::ProgramNode *wholeProgram = wholeParser.parse();
+    std::string expected = wholeProgram->toString();
+    test_condition(streamedParser.parse()->toString() == expected);
+    test_condition(packedParser.parse()->toString() == expected);
+
+    // Names are symbols of table, so nodes of different tables are compared by names
+    remac::SymbolTable otherSymbols;
+    otherSymbols.intern("unrelated");
+    remac::Lexer otherLexer(code);
+    remac::Parser otherParser(&otherLexer, &otherSymbols);
+    remac::ProgramNode *otherProgram = otherParser.parse();
+    test_condition(otherProgram->toString() == expected && otherSymbols.find("y") != symbols.find("y"));
+    remac::VariableReferenceNode reference(&symbols, symbols.intern("y"));
+    remac::VariableReferenceNode otherReference(&otherSymbols, otherSymbols.intern("y"));
+    remac::VariableReferenceNode differentReference(&symbols, symbols.intern("x"));
+    test_condition(reference.equals(&otherReference) && !reference.equals(&differentReference));
+    delete otherProgram;
+
+    // Flat tree is in pre-order, and converts back to the same tree
+    remac::Lexer flatLexer(code);
+    remac::Parser flatParser(&flatLexer, &symbols);
+    remac::FlatAst *flat = flatParser.parseFlat();
+    remac::ProgramNode *unflattened = flat->toTree();
+    test_condition(unflattened->toString() == expected);
+    remac::FlatAst::Index body = flat->getChild(0, 0);
+    remac::FlatAst::Index statement = flat->getChild(body, 0);
+    remac::FlatAst::Index condition = flat->getChild(statement, 0);
+    test_condition(
+        flat->getKind(0) == remac::AstNode::NodeType::NODE_PROGRAM && flat->getChildCount(body) == 1
+        && flat->getKind(statement) == remac::AstNode::NodeType::NODE_IF_STATEMENT && flat->getChildCount(statement) == 3
+        && condition == statement + 1 && flat->getName(condition) == "x"
+    );
+    delete unflattened;
+    delete flat;
+    delete wholeProgram;
+
+    // Each kind of node keeps its operands
+    remac::SequenceNode *loopBody = new remac::SequenceNode({
+        new remac::VariableAssignmentNode(&symbols, symbols.intern("x"), new remac::OperationModNode(
+            new remac::OperationMultiplyNode(new remac::IntConstantNode(-7), new remac::FloatConstantNode(2.5)),
+            new remac::OperationDivideNode(new remac::VariableReferenceNode(&symbols, symbols.intern("y")), new remac::IntConstantNode(3))
+        )),
+        new remac::ListSliceNode(
+            new remac::ListDefinitionNode(new remac::SequenceNode({ new remac::StringConstantNode(&symbols, symbols.intern("s")) })),
+            new remac::OperationSubtractNode(new remac::IntConstantNode(1), new remac::IntConstantNode(1))
+        ),
+    });
+    remac::ProgramNode kinds(new remac::SequenceNode({
+        new remac::WhileStatementNode(new remac::VariableReferenceNode(&symbols, symbols.intern("x")), new remac::SequenceNode({})),
+        new remac::ForStatementNode(
+            new remac::SequenceNode({}),
+            new remac::OperationAddNode(new remac::IntConstantNode(1), new remac::IntConstantNode(2)),
+            new remac::SequenceNode({ new remac::FunctionCallNode(&symbols, symbols.intern("F"), new remac::SequenceNode({})) }),
+            loopBody
+        ),
+    }));
+    remac::FlatAst flatKinds(&symbols, &kinds);
+    remac::ProgramNode *kindsTree = flatKinds.toTree();
+    test_condition(kindsTree->toString() == kinds.toString() && flatKinds.size() == 29);
+    delete kindsTree;
+
+    // Missing else body stays missing
+    remac::ProgramNode withoutElse(new remac::SequenceNode({
+        new remac::IfStatementNode(new remac::IntConstantNode(0), new remac::SequenceNode({}), nullptr),
+    }));
+    remac::FlatAst flatWithoutElse(&symbols, &withoutElse);
+    remac::ProgramNode *withoutElseTree = flatWithoutElse.toTree();
+    remac::IfStatementNode *unflattenedIf = static_cast<remac::IfStatementNode *>(withoutElseTree->getBody()->getNode(0));
+    test_condition(flatWithoutElse.getChild(2, 2) == remac::FlatAst::NO_NODE && unflattenedIf->getElseBody() == nullptr);
+    delete withoutElseTree;
+
+    // Left-deep chain of 100k operands is converted without recursion both ways
+    std::string deepChain = "F(x0";
+
+    for (unsigned long i = 1; i < 100000; i++) {
+        deepChain += " + x" + std::to_string(i);
+    }
+
+    deepChain += ")";
+    remac::Lexer deepLexer(deepChain);
+    remac::Parser deepParser(&deepLexer, &symbols);
+    remac::FlatAst *deepFlat = deepParser.parseFlat();
+    // Program, its body, call, args, then 99999 additions down the left spine and x0
+    test_condition(
+        deepFlat->size() == 4 + 100000 + 99999 && deepFlat->getKind(4 + 99998) == remac::AstNode::NodeType::NODE_OPERATION_ADD &&
+        deepFlat->getName(4 + 99999) == "x0" && deepFlat->getName(deepFlat->size() - 1) == "x99999"
+    );
+    remac::ProgramNode *deepTree = deepFlat->toTree();
+    remac::AstNode *spine = static_cast<remac::FunctionCallNode *>(deepTree->getBody()->getNode(0))->getArgs()->getNode(0);
+    unsigned long depth = 0;
+
+    while (spine->getType() == remac::AstNode::NodeType::NODE_OPERATION_ADD) {
+        spine = static_cast<remac::OperationAddNode *>(spine)->getLeft();
+        depth++;
+    }
+
+    test_condition(depth == 99999 && static_cast<remac::VariableReferenceNode *>(spine)->getName() == "x0");
+    delete deepTree;
+    delete deepFlat;
+
+    // Window holds only tokens, which weren't released, and reuses their slots
+    std::string call = "F(";
+
+    for (unsigned long i = 0; i < 1000; i++) {
+        call += "argument_" + std::to_string(i) + ", ";
+    }
+
+    call += "0)";
+    remac::Lexer lexer(call);
+    remac::TokenWindow window(&lexer, 4);
+    bool same = true;
+    unsigned long index = 0;
+
+    for (; window.has(index); index++) {
+        if (index % 2 == 0 && index >= 2 && index <= 2000) {
+            same = same && window.at(index).content == "argument_" + std::to_string(index / 2 - 1);
+        }
+
+        if (index >= 2) {
+            window.release(index - 2);
+        }
+    }
+
+    test_condition(same && index == 2004 && window.getCapacity() == 4);
+
+    // Nodes in arena are allocated by chunks, and the same tree is built on heap node by node
+    remac::Lexer arenaLexer(call);
+    remac::PackedTokens arenaTokens;
+    arenaLexer.fill(&arenaTokens);
+    remac::Parser arenaParser(&arenaTokens, &symbols);
+    unsigned long allocations = test_allocation_count();
+    remac::ProgramNode *arenaProgram = arenaParser.parse();
+    unsigned long arenaAllocations = test_allocation_count() - allocations;
+    remac::Parser heapParser(&arenaTokens, &symbols);
+    heapParser.setArena(false);
+    allocations = test_allocation_count();
+    remac::ProgramNode *heapProgram = heapParser.parse();
+    unsigned long heapAllocations = test_allocation_count() - allocations;
+    test_condition(arenaProgram->toString() == heapProgram->toString() && heapAllocations > 1000 && arenaAllocations < 100);
+    delete arenaProgram;
+    delete heapProgram;
+
+    // Comparisons bind looser than arithmetic, operators of one priority are left-associative
+    remac::Lexer operationLexer("F(a - -b * 2 % c < 3 - d - e == -(f) != 1)");
+    remac::Parser operationParser(&operationLexer, &symbols);
+    remac::ProgramNode *operationProgram = operationParser.parse();
+    remac::AstNode *operationExpected = new remac::OperationNotEqualNode(
+        new remac::OperationEqualNode(
+            new remac::OperationLessNode(
+                new remac::OperationSubtractNode(
+                    new remac::VariableReferenceNode(&symbols, symbols.intern("a")),
+                    new remac::OperationModNode(
+                        new remac::OperationMultiplyNode(
+                            new remac::OperationNegateNode(new remac::VariableReferenceNode(&symbols, symbols.intern("b"))),
+                            new remac::IntConstantNode(2)
+                        ),
+                        new remac::VariableReferenceNode(&symbols, symbols.intern("c"))
+                    )
+                ),
+                new remac::OperationSubtractNode(
+                    new remac::OperationSubtractNode(new remac::IntConstantNode(3), new remac::VariableReferenceNode(&symbols, symbols.intern("d"))),
+                    new remac::VariableReferenceNode(&symbols, symbols.intern("e"))
+                )
+            ),
+            new remac::OperationNegateNode(new remac::VariableReferenceNode(&symbols, symbols.intern("f")))
+        ),
+        new remac::IntConstantNode(1)
+    );
+    remac::FunctionCallNode *operationCall = static_cast<remac::FunctionCallNode *>(operationProgram->getBody()->getNode(0));
+    test_condition(operationCall->getArgs()->getNode(0)->equals(operationExpected));
+    delete operationExpected;
+    delete operationProgram;
+
+    // Long operator chain is folded by loop, so parser's own depth doesn't grow with its length.
+    // Tree is a left spine as deep as the chain, so it's checked by walking it, not by recursive equals().
+    std::string chain = "F(x0";
+
+    for (unsigned long i = 1; i < 10000; i++) {
+        chain += i % 3 == 0 ? " * x" : " + x";
+        chain += std::to_string(i);
+    }
+
+    chain += ")";
+    remac::Lexer chainLexer(chain);
+    remac::Parser chainParser(&chainLexer, &symbols);
+    remac::ProgramNode *chainProgram = chainParser.parse();
+    remac::AstNode *chainSpine = static_cast<remac::FunctionCallNode *>(chainProgram->getBody()->getNode(0))->getArgs()->getNode(0);
+    unsigned long chainAdditions = 0;
+    bool productsOnRight = true;
+
+    while (chainSpine->getType() == remac::AstNode::NodeType::NODE_OPERATION_ADD) {
+        remac::AstNode *right = static_cast<remac::OperationAddNode *>(chainSpine)->getRight();
+        productsOnRight = productsOnRight && (
+            right->getType() == remac::AstNode::NodeType::NODE_VARIABLE_REFERENCE ||
+            right->getType() == remac::AstNode::NodeType::NODE_OPERATION_MULTIPLY
+        );
+        chainSpine = static_cast<remac::OperationAddNode *>(chainSpine)->getLeft();
+        chainAdditions++;
+    }
+
+    // Every third operator is '*', so 6666 of 9999 are additions, and x0 ends the spine
+    test_condition(
+        chainAdditions == 6666 && productsOnRight &&
+        static_cast<remac::VariableReferenceNode *>(chainSpine)->getName() == "x0"
+    );
+    delete chainProgram;
+
+    // Sequences are collected on shared stack, so calls and lists don't allocate their own vectors
+    std::string calls = "Main(";
+
+    for (unsigned long i = 0; i < 1000; i++) {
+        calls += "Func(name, 42, \"text\", G(x, 3.5)) % 7, ";
+    }
+
+    calls += "0)";
+    remac::Lexer callsLexer(calls);
+    remac::PackedTokens callsTokens;
+    callsLexer.setSymbols(&symbols);
+    callsLexer.fill(&callsTokens);
+    remac::Parser callsParser(&callsTokens, &symbols);
+    allocations = test_allocation_count();
+    remac::ProgramNode *callsProgram = callsParser.parse();
+    double allocationsPerToken = (double)(test_allocation_count() - allocations) / callsTokens.size();
+    test_condition(allocationsPerToken < 0.01);
+    delete callsProgram;
+
+    // Nodes of program, which failed to parse, are freed with arena
+    remac::Lexer failingLexer("F(1, 2 +)");
+    remac::Parser failingParser(&failingLexer, &symbols);
+    bool failed = false;
+
+    try {
+        delete failingParser.parse();
+    } catch (remac::ParserException *exc) {
+        failed = true;
+        delete exc;
+    }
+
+    test_condition(failed);
+
+    // Assignment isn't an operator of expression
+    remac::Lexer assignmentLexer("F(a = 1)");
+    remac::Parser assignmentParser(&assignmentLexer, &symbols);
+    std::string message;
+
+    try {
+        delete assignmentParser.parse();
+    } catch (remac::ParserException *exc) {
+        message = exc->message;
+        delete exc;
+    }
+
+    test_condition(message == "No assignment is allowed inside an expression");
 }
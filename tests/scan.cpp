@@ -0,0 +1,93 @@
+#include "scan.hpp"
+
+#include <remac/cpu.hpp>
+#include <remac/scan.hpp>
+#include <remac/source.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct ScanResult {
+    unsigned long whitespacesEnd;
+    unsigned long identifierEnd;
+    unsigned long stringEnd;
+    std::vector<unsigned long> lineStarts;
+
+    bool operator==(const ScanResult &other) const {
+        return this->whitespacesEnd == other.whitespacesEnd && this->identifierEnd == other.identifierEnd &&
+            this->stringEnd == other.stringEnd &&
+            this->lineStarts == other.lineStarts;
+    }
+};
+
+static ScanResult scanAt(const std::string &padded, unsigned long offset) {
+    const char *start = padded.data() + offset;
+    ScanResult result;
+    result.whitespacesEnd = remac::scanWhitespaces(start) - start;
+    result.identifierEnd = remac::scanIdentifierChars(start) - start;
+    result.stringEnd = remac::scanStringChars(start, start + std::strlen(start), '"') - start;
+    remac::scanLineStarts(start, start + std::strlen(start), &result.lineStarts);
+    return result;
+}
+
+/**
+ * Every SIMD kernel must give same results as scalar one, on runs of all
+    lengths, ending at any position of block.
+ */
+static bool kernelsAgree() {
+    const char alphabet[] = { ' ', ' ', '\n', '\t', 'a', 'z', 'A', 'Z', '_', '0', '9', '(', '@', '`', '{', '\r', '\xd0', '\xb6', '"', '\\' };
+    std::srand(42);
+    remac::SimdLevel detected = remac::detectSimdLevel();
+    bool agree = true;
+
+    for (unsigned long test = 0; test < 2000 && agree; test++) {
+        // Mostly long runs of one class, so they cross block boundaries
+        std::string code;
+        unsigned long length = std::rand() % 100;
+        bool identifiers = std::rand() % 2;
+
+        for (unsigned long i = 0; i < length; i++) {
+            if (std::rand() % 8 == 0) {
+                code.push_back(alphabet[std::rand() % sizeof(alphabet)]);
+            } else {
+                code.push_back(identifiers ? alphabet[4 + std::rand() % 7] : alphabet[std::rand() % 4]);
+            }
+        }
+
+        std::string padded = code + std::string(remac::SOURCE_PADDING, '\0');
+
+        for (unsigned long offset = 0; offset <= code.size() && agree; offset += 7) {
+            remac::setSimdLevel(remac::SimdLevel::SIMD_SCALAR);
+            ScanResult expected = scanAt(padded, offset);
+
+            for (int level = remac::SimdLevel::SIMD_SSE2; level <= detected; level++) {
+                remac::setSimdLevel((remac::SimdLevel)level);
+                agree = agree && scanAt(padded, offset) == expected;
+            }
+        }
+    }
+
+    remac::setSimdLevel(detected);
+    return agree;
+}
+
+void test_scan() {
+    test_module("Scan");
+
+    std::string whitespaces = std::string(" \t\n  \n") + std::string(40, ' ') + "x" + std::string(remac::SOURCE_PADDING, '\0');
+    ScanResult result = scanAt(whitespaces, 0);
+    test_condition(result.whitespacesEnd == 46 && result.identifierEnd == 0);
+
+    // Line starts after LF, after CR, but only once after CRLF, which may be split between blocks
+    std::string lines = "a\nb\r\nc\rd" + std::string(23, ' ') + "\r\ne\n\n" + std::string(remac::SOURCE_PADDING, '\0');
+    std::vector<unsigned long> lineStarts = { 0 };
+    remac::scanLineStarts(lines.data(), lines.data() + 36, &lineStarts);
+    test_condition(lineStarts == std::vector<unsigned long>({ 0, 2, 5, 7, 33, 35, 36 }));
+
+    std::string identifier = std::string("abc_XYZ_0123456789_abcdefghijklmnopqrstuvwxyz+") + std::string(remac::SOURCE_PADDING, '\0');
+    test_condition(scanAt(identifier, 0).identifierEnd == 45);
+
+    test_condition(kernelsAgree());
+}
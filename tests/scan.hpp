@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_TESTSCAN
+#define REMAC_TESTSCAN 1
+
+#include "testmain.hpp"
+
+void test_scan();
+
+#endif // REMAC_TESTSCAN
@@ -0,0 +1,130 @@
+#include "source.hpp"
+
+#include <remac/lexer.hpp>
+#include <remac/source.hpp>
+#include <remac/utf8.hpp>
+
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <unistd.h>
+
+static const char *TEST_FILE = "test_source.rm";
+
+static void writeFile(std::string content) {
+    std::FILE *file = std::fopen(TEST_FILE, "wb");
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::fclose(file);
+}
+
+static bool paddedWithZeros(const remac::Source &source) {
+    for (unsigned long i = 0; i < remac::SOURCE_PADDING; i++) {
+        if (source.getData()[source.getSize() + i] != '\0') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void test_source() {
+    test_module("Source");
+
+    remac::Source copied("Print(1)");
+    test_condition(copied.getCode() == "Print(1)" && paddedWithZeros(copied));
+
+    // Size of file is multiple of page size, so padding can't come from the file mapping itself
+    std::string program = "Print(" + std::string(4096 - 8, ' ') + "x)";
+    writeFile(program);
+    remac::Source mapped = remac::Source::fromFile(TEST_FILE);
+    test_condition(mapped.getCode() == program && paddedWithZeros(mapped));
+
+    remac::Lexer lexer(std::move(mapped));
+    unsigned long tokens = 0;
+    std::optional<remac::Token> token = lexer.next();
+
+    while (token.has_value() && token->type != remac::TokenType::LEXER_ERROR) {
+        ++tokens;
+        token = lexer.next();
+    }
+
+    test_condition(!token.has_value() && tokens == 4);
+
+    // Padded buffer of caller is lexed in place
+    std::string line = "Print(x)" + std::string(remac::SOURCE_PADDING, '\0');
+    remac::Source borrowed = remac::Source::fromPadded(std::string_view(line.data(), 8));
+    test_condition(borrowed.getData() == line.data() && borrowed.getCode() == "Print(x)");
+    remac::Lexer borrowedLexer(std::move(borrowed));
+    std::optional<remac::Token> first = borrowedLexer.next();
+    test_condition(first.has_value() && first->content.data() == line.data());
+
+    bool notPadded = false;
+
+    try {
+        remac::Source::fromPadded(std::string_view(line.data(), 4));
+    } catch (remac::SourceException *exc) {
+        notPadded = true;
+        delete exc;
+    }
+
+    test_condition(notPadded);
+
+    // Stream window never ends inside of UTF-8 char, so each window is valid on its own
+    std::string text = "Печать(мир, \"€𝄞\")";
+    writeFile(text);
+    std::FILE *file = std::fopen(TEST_FILE, "rb");
+    remac::SourceStream stream(fileno(file), 5);
+    std::string joined;
+    bool windowsValid = true;
+
+    do {
+        stream.advance(stream.getCode().size());
+        std::string_view window = stream.getCode();
+        windowsValid = windowsValid && remac::isValidUtf8(window.data(), window.data() + window.size());
+        windowsValid = windowsValid && window.data()[window.size()] == '\0';
+        joined += window;
+    } while (!stream.isEnded());
+
+    std::fclose(file);
+    test_condition(windowsValid && joined == text && !stream.isInvalid());
+
+    // Lines end with LF, CRLF or lone CR, and columns are counted in chars
+    remac::SourceMap map("ab\nмир x\r\n\r€y");
+    remac::SourcePosition start = map.locate(0);
+    remac::SourcePosition afterCyrillic = map.locate(10);
+    remac::SourcePosition afterCrlf = map.locate(13);
+    remac::SourcePosition afterEuro = map.locate(17);
+    test_condition(map.getLineCount() == 4 && start.line == 1 && start.column == 1);
+    test_condition(afterCyrillic.line == 2 && afterCyrillic.column == 5);
+    test_condition(afterCrlf.line == 3 && afterCrlf.column == 1);
+    test_condition(afterEuro.line == 4 && afterEuro.column == 2);
+
+    writeFile("");
+    remac::Source empty = remac::Source::fromFile(TEST_FILE);
+    test_condition(empty.getSize() == 0 && paddedWithZeros(empty));
+
+    // Pipe has no size, so it's read up to its end instead of being taken as empty file
+    int pipeFds[2];
+    test_condition(pipe(pipeFds) == 0);
+    std::string piped = "Print(1)";
+    test_condition(write(pipeFds[1], piped.data(), piped.size()) == (ssize_t)piped.size());
+    close(pipeFds[1]);
+    remac::Source fromPipe = remac::Source::fromFile("/dev/fd/" + std::to_string(pipeFds[0]));
+    close(pipeFds[0]);
+    test_condition(fromPipe.getCode() == piped && paddedWithZeros(fromPipe));
+    std::remove(TEST_FILE);
+
+    bool thrown = false;
+
+    try {
+        remac::Source::fromFile(TEST_FILE);
+    } catch (remac::SourceException *exc) {
+        thrown = true;
+        delete exc;
+    }
+
+    test_condition(thrown);
+}
@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_TESTSOURCE
+#define REMAC_TESTSOURCE 1
+
+#include "testmain.hpp"
+
+void test_source();
+
+#endif // REMAC_TESTSOURCE
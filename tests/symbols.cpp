@@ -0,0 +1,119 @@
+#include "symbols.hpp"
+
+#include <remac/lexer.hpp>
+#include <remac/source.hpp>
+#include <remac/symbols.hpp>
+#include <remac/tokens.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Symbols of IDENTIFIER and STRING tokens, in order of tokens.
+ */
+static std::vector<remac::Symbol> symbolsOf(remac::Lexer *lexer) {
+    std::vector<remac::Symbol> symbols;
+    std::optional<remac::Token> token = lexer->next();
+
+    while (token.has_value() && token->type != remac::TokenType::LEXER_ERROR) {
+        if (token->type == remac::TokenType::IDENTIFIER || token->type == remac::TokenType::STRING) {
+            symbols.push_back(token->symbol);
+        }
+
+        token = lexer->next();
+    }
+
+    return symbols;
+}
+
+static std::vector<remac::Symbol> symbolsOf(const remac::PackedTokens &tokens) {
+    std::vector<remac::Symbol> symbols;
+
+    for (unsigned long i = 0; i < tokens.size(); i++) {
+        if (tokens.getType(i) == remac::TokenType::IDENTIFIER || tokens.getType(i) == remac::TokenType::STRING) {
+            symbols.push_back(tokens.getSymbol(i));
+        }
+    }
+
+    return symbols;
+}
+
+void test_symbols() {
+    test_module("Symbols");
+    remac::SymbolTable table;
+    remac::Symbol print = table.intern("Print");
+    remac::Symbol x = table.intern("x");
+    test_condition(print == 0 && x == 1 && table.intern("Print") == print && table.size() == 2);
+    test_condition(table.getName(print) == "Print" && table.find("x") == x && table.find("y") == remac::NO_SYMBOL);
+    // Empty string literal is a name too
+    remac::Symbol empty = table.intern("");
+    test_condition(empty == 2 && table.intern(std::string_view()) == empty && table.getName(empty).empty());
+
+    // Names stay in place, when table grows
+    std::string_view printName = table.getName(print);
+    bool same = true;
+
+    for (unsigned long i = 0; i < 10000; i++) {
+        std::string name = "name_" + std::to_string(i) + std::string(i % 20, 'x');
+        same = same && table.intern(name) == i + 3;
+    }
+
+    for (unsigned long i = 0; i < 10000; i++) {
+        std::string name = "name_" + std::to_string(i) + std::string(i % 20, 'x');
+        same = same && table.find(name) == i + 3 && table.getName(i + 3) == name;
+    }
+
+    test_condition(same && table.size() == 10003 && table.getName(print).data() == printName.data());
+
+    // Lexer interns identifiers and string literals, but not keywords
+    std::string code = "if (x) {\n    Print(\"a\", x, \"a\")\n} else {\n    Print(\"esc\\tape\", y)\n}";
+    remac::SymbolTable symbols;
+    remac::Lexer lexer(code);
+    lexer.setSymbols(&symbols);
+    std::vector<remac::Symbol> expected = symbolsOf(&lexer);
+    test_condition(expected == std::vector<remac::Symbol>({ 0, 1, 2, 0, 2, 1, 3, 4 }) && symbols.size() == 5);
+    test_condition(symbols.getName(3) == "esc\tape" && symbols.find("if") == remac::NO_SYMBOL);
+
+    // The same symbols are found by all ways of lexing
+    std::istringstream input(code);
+    remac::Lexer streamed(remac::SourceStream(input, 7));
+    streamed.setSymbols(&symbols);
+    test_condition(symbolsOf(&streamed) == expected);
+
+    remac::Lexer packingLexer(code);
+    remac::PackedTokens packed;
+    packingLexer.setSymbols(&symbols);
+    packingLexer.fill(&packed);
+    test_condition(symbolsOf(packed) == expected && symbols.size() == 5);
+
+    std::string call = "Print(";
+
+    for (unsigned long i = 0; i < 1000; i++) {
+        call += "x,\n\"a\", y, \"esc\\tape\",\n";
+    }
+
+    call += "0)";
+    remac::Lexer parallelLexer(call);
+    remac::PackedTokens parallel;
+    parallelLexer.setSymbols(&symbols);
+    test_condition(!parallelLexer.fillParallel(&parallel, 3, 1000).has_value());
+    std::vector<remac::Symbol> parallelSymbols = symbolsOf(parallel);
+    bool sameSymbols = parallelSymbols.size() == 4001 && parallelSymbols[0] == 1;
+
+    for (unsigned long i = 1; i < parallelSymbols.size(); i += 4) {
+        sameSymbols = sameSymbols && parallelSymbols[i] == 0 && parallelSymbols[i + 1] == 2 && parallelSymbols[i + 2] == 4 && parallelSymbols[i + 3] == 3;
+    }
+
+    test_condition(sameSymbols && symbols.size() == 5);
+
+    // Tokens without table have no symbols, and packed buffer has no array for them
+    remac::Lexer plainLexer(code);
+    remac::PackedTokens plain;
+    plainLexer.fill(&plain);
+    unsigned long plainSize = plain.getByteSize();
+    test_condition(symbolsOf(plain) == std::vector<remac::Symbol>(expected.size(), remac::NO_SYMBOL) && plainSize < packed.getByteSize());
+}
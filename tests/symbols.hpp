@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_TESTSYMBOLS
+#define REMAC_TESTSYMBOLS 1
+
+#include "testmain.hpp"
+
+void test_symbols();
+
+#endif // REMAC_TESTSYMBOLS
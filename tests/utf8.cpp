@@ -0,0 +1,200 @@
+#include "utf8.hpp"
+
+#include <remac/cpu.hpp>
+#include <remac/utf8.hpp>
+
+#include <cstdlib>
+#include <string>
+
+/**
+ * Straightforward RFC 3629 check by decoded code points, independent of
+    tables used by remac::isValidUtf8().
+ */
+static bool referenceValid(const std::string &string) {
+    const unsigned int minimums[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    unsigned long i = 0;
+
+    while (i < string.size()) {
+        unsigned char lead = string[i];
+        unsigned long length;
+        unsigned int codePoint;
+
+        if (lead < 0x80) {
+            length = 1;
+            codePoint = lead;
+        } else if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            codePoint = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            codePoint = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            codePoint = lead & 0x07;
+        } else {
+            return false;
+        }
+
+        if (i + length > string.size()) {
+            return false;
+        }
+
+        for (unsigned long j = 1; j < length; j++) {
+            if ((string[i + j] & 0xC0) != 0x80) {
+                return false;
+            }
+
+            codePoint = (codePoint << 6) | (string[i + j] & 0x3F);
+        }
+
+        if (codePoint < minimums[length] || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            return false;
+        }
+
+        i += length;
+    }
+
+    return true;
+}
+
+static bool validAtAllLevels(const std::string &string, bool expected) {
+    remac::SimdLevel detected = remac::detectSimdLevel();
+    const char *start = string.data();
+    const char *end = start + string.size();
+    bool agree = (remac::findInvalidUtf8(start, end) == end) == expected;
+
+    for (int level = remac::SimdLevel::SIMD_SCALAR; level <= detected; level++) {
+        remac::setSimdLevel((remac::SimdLevel)level);
+        agree = agree && remac::isValidUtf8(start, end) == expected;
+    }
+
+    remac::setSimdLevel(detected);
+    return agree;
+}
+
+/**
+ * Random mix of valid chars, edge-case bytes and truncated sequences, long
+    enough to cross SIMD blocks. Every validator must agree with reference.
+ */
+static bool validatorsAgree() {
+    const char *pieces[] = {
+        "a", " ", "0", "\xd0\xb6", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf",
+        "\xc2\x80", "\xed\x9f\xbf", "\xee\x80\x80", "\xe0\xa0\x80", "\xf0\x90\x80\x80",
+        // Invalid: overlong, surrogates, too large, stray and truncated bytes
+        "\xc0\x80", "\xc1\xbf", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80",
+        "\xf5\x80\x80\x80", "\xff", "\x80", "\xbf", "\xd0", "\xe2\x82", "\xf0\x9f\x98",
+    };
+    const unsigned long validPieces = 13;
+    std::srand(1234);
+    bool agree = true;
+
+    for (unsigned long test = 0; test < 20000 && agree; test++) {
+        std::string string;
+        unsigned long length = std::rand() % 80;
+        // Most strings are almost valid, so errors land at every position of block
+        bool noisy = std::rand() % 2;
+
+        for (unsigned long i = 0; i < length; i++) {
+            if (std::rand() % 3 != 0) {
+                string += (char)('a' + std::rand() % 26);
+            } else if (noisy && std::rand() % 8 == 0) {
+                string += pieces[std::rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+            } else {
+                string += pieces[std::rand() % validPieces];
+            }
+        }
+
+        agree = validAtAllLevels(string, referenceValid(string));
+    }
+
+    return agree;
+}
+
+/**
+ * Decodes every one, two and three byte sequence (and four byte ones with
+    varying second and third byte) and checks it against reference.
+ */
+static bool decoderMatchesReference() {
+    for (unsigned int lead = 0; lead < 256; lead++) {
+        unsigned long length = lead >= 0xF0 ? 4 : (lead >= 0xE0 ? 3 : (lead >= 0x80 ? 2 : 1));
+        unsigned long tails = length == 1 ? 1 : (length == 2 ? 0x100 : 0x10000);
+
+        for (unsigned long tail = 0; tail < tails; tail++) {
+            char bytes[4] = { (char)lead, 0, 0, 0 };
+
+            if (length == 2) {
+                bytes[1] = (char)tail;
+            } else if (length > 2) {
+                bytes[1] = (char)(tail >> 8);
+                bytes[2] = (char)tail;
+                bytes[3] = (char)(tail & 1 ? 0x80 : 0x3F);
+            }
+
+            remac::DecodedChar decoded = remac::decodeUtf8(bytes);
+            bool valid = referenceValid(std::string(bytes, length));
+            char encoded[4];
+
+            if ((decoded.length == length) != valid) {
+                return false;
+            }
+
+            if (valid && (remac::encodeUtf8(decoded.codePoint, encoded) != length || std::string(encoded, length) != std::string(bytes, length))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Every scalar value survives encoding and decoding, surrogates and values
+    above U+10FFFF are not encoded.
+ */
+static bool encoderRoundTrips() {
+    for (char32_t codePoint = 0; codePoint < 0x110100; codePoint++) {
+        char bytes[4];
+        unsigned char length = remac::encodeUtf8(codePoint, bytes);
+        bool scalar = codePoint < 0xD800 || (codePoint > 0xDFFF && codePoint < 0x110000);
+
+        if (!scalar) {
+            if (length != UTF8_INVALID) {
+                return false;
+            }
+
+            continue;
+        }
+
+        remac::DecodedChar decoded = remac::decodeUtf8(bytes);
+
+        if (decoded.length != length || decoded.codePoint != codePoint || !referenceValid(std::string(bytes, length))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void test_utf8() {
+    test_module("UTF-8");
+
+    test_condition(validAtAllLevels("", true) && validAtAllLevels("Print(\"\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82\")", true));
+    test_condition(validAtAllLevels(std::string(31, 'x') + "\xe2\x82\xac" + std::string(40, 'y'), true));
+    test_condition(validAtAllLevels(std::string(31, 'x') + "\xe2\x82", false) && validAtAllLevels("\xed\xa0\x80", false));
+    test_condition(validatorsAgree());
+
+    remac::DecodedChar euro = remac::decodeUtf8("\xe2\x82\xac");
+    remac::Utf8Char zhe = remac::utfFromCodePoint(0x436);
+    test_condition(euro.codePoint == 0x20AC && euro.length == 3 && std::string(zhe.bytes) == "\xd0\xb6");
+    test_condition(decoderMatchesReference());
+
+    // Decoder with end doesn't read after it: sequence, cut by end, is invalid
+    char *exact = new char[3] { '\xe2', '\x82', '\xac' };
+    const char *twoBytes = "\xd0\xb6";
+    test_condition(remac::decodeUtf8(exact, exact + 3).length == 3 && remac::decodeUtf8(exact, exact + 2).length == UTF8_INVALID);
+    test_condition(remac::decodeUtf8(exact + 2, exact + 3).length == UTF8_INVALID && remac::decodeUtf8(twoBytes, twoBytes + 1).length == UTF8_INVALID);
+    test_condition(!remac::utfCharInString(exact, exact + 2, remac::utfFromCodePoint(0x20AC)) && remac::utfCharInString(exact, exact + 3, remac::utfFromCodePoint(0x20AC)));
+    delete[] exact;
+    test_condition(encoderRoundTrips());
+
+}
@@ -0,0 +1,9 @@
+#pragma once
+#ifndef REMAC_TESTUTF8
+#define REMAC_TESTUTF8 1
+
+#include "testmain.hpp"
+
+void test_utf8();
+
+#endif // REMAC_TESTUTF8